@@ -36,15 +36,8 @@ SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, kMatrixWidth, kMatrixHeig
 int led = 13;
 
 void drawBitmap(int16_t x, int16_t y, const gimp32x32bitmap* bitmap) {
-  for(unsigned int i=0; i < bitmap->height; i++) {
-    for(unsigned int j=0; j < bitmap->width; j++) {
-      SM_RGB pixel = { bitmap->pixel_data[(i*bitmap->width + j)*3 + 0],
-                      bitmap->pixel_data[(i*bitmap->width + j)*3 + 1],
-                      bitmap->pixel_data[(i*bitmap->width + j)*3 + 2] };
-
-      backgroundLayer.drawPixel(x + j, y + i, pixel);
-    }
-  }
+  // GIMP stores RGB pixels as 3 bytes each, the same layout as rgb24, so the whole bitmap can be copied at once
+  backgroundLayer.drawBitmap(x, y, bitmap->width, bitmap->height, (const rgb24 *)bitmap->pixel_data, bitmap->width);
 }
 
 void setup() {
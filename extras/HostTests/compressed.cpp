@@ -0,0 +1,149 @@
+/*
+ * SmartMatrix Library - Compressed Image Host Test
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// drawCompressedImage() with the bundled example images, encoded by encodeImage.py and with a forced palette, has to
+// draw the same pixels as drawBitmap() with the raw image, clipped at every edge and rotated
+// images that end early or use an index past the palette have to be rejected without reading past the end
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+#include <string.h>
+#include "pixelmatix.c"
+#include "colorwheel.c"
+#include "chrome16.c"
+#include "pixelmatix_smi.c"
+#include "colorwheel_smi.c"
+#include "chrome16_smi.c"
+#include "chrome16_pal.c"
+
+#define WIDTH 32
+#define HEIGHT 32
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, 36, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, SMARTMATRIX_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, 24, SM_BACKGROUND_OPTIONS_NONE);
+
+struct testImage {
+    const char * name;
+    const uint8_t * data;
+    uint32_t length;
+    unsigned int width;
+    unsigned int height;
+    const unsigned char * pixels;
+};
+
+#define TEST_IMAGE(data, raw) { #data, data, sizeof(data), raw.width, raw.height, raw.pixel_data }
+
+static const testImage images[] = {
+    TEST_IMAGE(pixelmatix_smi, pixelmatixlogo),
+    TEST_IMAGE(colorwheel_smi, colorwheel),
+    TEST_IMAGE(chrome16_smi, chrome16),
+    TEST_IMAGE(chrome16_pal, chrome16),
+};
+
+static const int positions[][2] = { { 0, 0 }, { 3, 5 }, { -7, -3 }, { 20, 24 }, { -2, 30 }, { 31, -31 }, { -40, 0 } };
+
+static rgb24 expected[WIDTH * HEIGHT];
+static uint8_t damaged[4096];
+static int failures = 0;
+
+static void expect(bool condition, const char * name, const char * what) {
+    if (!condition) {
+        printf("compressed: FAILED %s %s\n", name, what);
+        failures++;
+    }
+}
+
+// rotation changes take effect at the start of the next frame, 16 rows on a 32 row, 1/16 scan panel
+static void rotate(int rotation) {
+    matrix.setRotation((rotationDegrees)rotation);
+    smHostRefresh.runRows(16);
+}
+
+static bool sameAsBitmap(const testImage &image, const SMCompressedImage &compressed, int x, int y) {
+    const rgb24 marker(1, 2, 3);
+
+    backgroundLayer.fillScreen(marker);
+    backgroundLayer.drawBitmap(x, y, image.width, image.height, (const rgb24 *)image.pixels, image.width);
+    for (int i = 0; i < WIDTH * HEIGHT; i++)
+        expected[i] = backgroundLayer.readPixel(i % WIDTH, i / WIDTH);
+
+    backgroundLayer.fillScreen(marker);
+    if (!backgroundLayer.drawCompressedImage(x, y, compressed))
+        return false;
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        rgb24 pixel = backgroundLayer.readPixel(i % WIDTH, i / WIDTH);
+        if (memcmp(&pixel, &expected[i], sizeof(rgb24)))
+            return false;
+    }
+    return true;
+}
+
+int main(void) {
+    matrix.addLayer(&backgroundLayer);
+    matrix.begin();
+    backgroundLayer.enableColorCorrection(false);
+
+    int palettes = 0;
+
+    for (unsigned int i = 0; i < sizeof(images) / sizeof(images[0]); i++) {
+        const testImage &image = images[i];
+        SMCompressedImage compressed(image.data, image.length);
+
+        expect(compressed.isValid(), image.name, "not valid");
+        expect(compressed.getWidth() == image.width && compressed.getHeight() == image.height, image.name, "wrong size");
+        if (compressed.getPalette())
+            palettes++;
+
+        for (int rotation = 0; rotation < 4; rotation++) {
+            rotate(rotation);
+            for (unsigned int j = 0; j < sizeof(positions) / sizeof(positions[0]); j++)
+                expect(sameAsBitmap(image, compressed, positions[j][0], positions[j][1]), image.name, "differs from drawBitmap()");
+        }
+        rotate(0);
+
+        // a header cut short isn't valid, packets cut short draw up to the cut and fail
+        expect(!SMCompressedImage(image.data, 6).isValid(), image.name, "header cut short accepted");
+        if (compressed.getPalette())
+            expect(!SMCompressedImage(image.data, 8 + 3).isValid(), image.name, "palette cut short accepted");
+        SMCompressedImage truncated(image.data, image.length - 1);
+        expect(truncated.isValid(), image.name, "truncated header not valid");
+        expect(!backgroundLayer.drawCompressedImage(0, 0, truncated), image.name, "truncated packets accepted");
+
+        // an index past the palette in the first packet
+        if (compressed.getPalette() && compressed.getPaletteSize() < 256 && image.length <= sizeof(damaged)) {
+            memcpy(damaged, image.data, image.length);
+            damaged[compressed.getPackets() - image.data + 1] = compressed.getPaletteSize();
+            expect(!backgroundLayer.drawCompressedImage(0, 0, SMCompressedImage(damaged, image.length)), image.name,
+                "index past the palette accepted");
+        }
+    }
+
+    expect(palettes > 0 && palettes < (int)(sizeof(images) / sizeof(images[0])), "images", "don't cover both pixel formats");
+    expect(!SMCompressedImage(NULL, 0).isValid(), "NULL", "accepted");
+
+    if (failures)
+        return 1;
+    printf("compressed: ok\n");
+    return 0;
+}
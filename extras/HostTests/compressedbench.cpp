@@ -0,0 +1,110 @@
+/*
+ * SmartMatrix Library - Compressed Image Benchmark
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// compression ratio and decode speed of the bundled example images encoded by encodeImage.py, and with a forced
+// palette, next to drawBitmap() with the raw image, megapixels per second, best of several runs
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+#include <time.h>
+#include "pixelmatix.c"
+#include "colorwheel.c"
+#include "chrome16.c"
+#include "pixelmatix_smi.c"
+#include "colorwheel_smi.c"
+#include "chrome16_smi.c"
+#include "chrome16_pal.c"
+
+#define WIDTH 32
+#define HEIGHT 32
+#define REPEATS 20000
+#define RUNS 9
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, 36, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, SMARTMATRIX_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, 24, SM_BACKGROUND_OPTIONS_NONE);
+
+struct benchImage {
+    const char * name;
+    const uint8_t * data;
+    uint32_t length;
+    unsigned int width;
+    unsigned int height;
+    const unsigned char * pixels;
+};
+
+#define BENCH_IMAGE(data, raw) { #data, data, sizeof(data), raw.width, raw.height, raw.pixel_data }
+
+static const benchImage images[] = {
+    BENCH_IMAGE(pixelmatix_smi, pixelmatixlogo),
+    BENCH_IMAGE(colorwheel_smi, colorwheel),
+    BENCH_IMAGE(chrome16_smi, chrome16),
+    BENCH_IMAGE(chrome16_pal, chrome16),
+};
+
+static uint64_t nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static double megapixelsPerSecond(const benchImage &image, bool compressed) {
+    SMCompressedImage compressedImage(image.data, image.length);
+    uint64_t best = ~0ULL;
+
+    for (int run = 0; run < RUNS; run++) {
+        uint64_t start = nanoseconds();
+        for (int i = 0; i < REPEATS; i++) {
+            if (compressed)
+                backgroundLayer.drawCompressedImage(0, 0, compressedImage);
+            else
+                backgroundLayer.drawBitmap(0, 0, image.width, image.height, (const rgb24 *)image.pixels, image.width);
+        }
+        uint64_t elapsed = nanoseconds() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return (double)image.width * image.height * REPEATS * 1000 / best;
+}
+
+int main(void) {
+    matrix.addLayer(&backgroundLayer);
+    matrix.begin();
+
+    printf("compressed image %-14s %-5s %5s %5s %6s  %7s  %11s  %15s\n", "", "size", "bytes", "raw", "ratio", "palette",
+        "decode MP/s", "drawBitmap MP/s");
+    for (unsigned int i = 0; i < sizeof(images) / sizeof(images[0]); i++) {
+        const benchImage &image = images[i];
+        SMCompressedImage compressedImage(image.data, image.length);
+        int raw = image.width * image.height * 3;
+
+        if (!backgroundLayer.drawCompressedImage(0, 0, compressedImage)) {
+            printf("compressed image %s isn't valid\n", image.name);
+            return 1;
+        }
+        printf("compressed image %-14s %2ux%-2u %5u %5d %5.1f%%  %7d  %11.0f  %15.0f\n", image.name, image.width,
+            image.height, (unsigned int)image.length, raw, 100.0 * image.length / raw, compressedImage.getPaletteSize(),
+            megapixelsPerSecond(image, true), megapixelsPerSecond(image, false));
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+/*
+ * SmartMatrix Library - Display List Layer Host Test
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// the display list layer has to refresh the same rows as a background layer drawn with the same primitives, for
+// random lists of rectangles, outlines, lines of every slope, glyph runs and mono bitmaps, clipped at every edge,
+// on a non-square panel at every rotation, and again after items are moved and recolored
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH 64
+#define HEIGHT 32
+#define COLOR_DEPTH 24
+#define MAX_ITEMS 32
+#define LISTS 25
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, 36, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, SMARTMATRIX_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_BACKGROUND_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_DISPLAY_LIST_LAYER(displayListLayer, WIDTH, HEIGHT, COLOR_DEPTH, MAX_ITEMS, SM_DISPLAY_LIST_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_GLYPH_RUN(textRun, 64, 8);
+
+// 12 x 5, two bytes per row
+static const uint8_t monoBitmap[] = {
+    0xF0, 0x30, 0x88, 0x40, 0x45, 0x80, 0x22, 0x10, 0x1F, 0xF0,
+};
+
+struct testItem {
+    displayListItemTypes type;
+    int16_t x0, y0, x1, y1;
+    rgb24 color;
+};
+
+static const rgb24 marker(1, 2, 3);
+static testItem items[MAX_ITEMS];
+static int itemCount;
+static uint32_t randomState = 1;
+static int failures = 0;
+
+static int randomNumber(int range) {
+    randomState = (randomState * 1103515245) + 12345;
+    return (randomState >> 16) % range;
+}
+
+static rgb24 randomColor(void) {
+    return rgb24(randomNumber(256), randomNumber(256), randomNumber(256));
+}
+
+// rotation changes take effect at the start of the next frame, 16 rows on a 32 row, 1/16 scan panel
+static void rotate(int rotation) {
+    matrix.setRotation((rotationDegrees)rotation);
+    smHostRefresh.runRows(16);
+}
+
+static void randomItems(void) {
+    int width = matrix.getScreenWidth();
+    int height = matrix.getScreenHeight();
+
+    itemCount = 1 + randomNumber(MAX_ITEMS);
+    for (int i = 0; i < itemCount; i++) {
+        testItem &item = items[i];
+
+        item.type = (displayListItemTypes)randomNumber(5);
+        item.x0 = randomNumber(width + 40) - 20;
+        item.y0 = randomNumber(height + 40) - 20;
+        // lines end anywhere, including past the layer in both directions, rectangles are ordered
+        item.x1 = (item.type == displayListLine) ? randomNumber(width + 80) - 40 : item.x0 + randomNumber(24);
+        item.y1 = (item.type == displayListLine) ? randomNumber(height + 80) - 40 : item.y0 + randomNumber(16);
+        item.color = randomColor();
+    }
+}
+
+static void addItems(void) {
+    displayListLayer.clear();
+
+    for (int i = 0; i < itemCount; i++) {
+        const testItem &item = items[i];
+        int index = -1;
+
+        switch (item.type) {
+        case displayListRectangle:
+            index = displayListLayer.fillRectangle(item.x0, item.y0, item.x1, item.y1, item.color);
+            break;
+        case displayListRectangleOutline:
+            index = displayListLayer.drawRectangle(item.x0, item.y0, item.x1, item.y1, item.color);
+            break;
+        case displayListLine:
+            index = displayListLayer.drawLine(item.x0, item.y0, item.x1, item.y1, item.color);
+            break;
+        case displayListGlyphRun:
+            index = displayListLayer.drawGlyphRun(item.x0, item.y0, item.color, textRun);
+            break;
+        case displayListMonoBitmap:
+            index = displayListLayer.drawMonoBitmap(item.x0, item.y0, 12, 5, item.color, monoBitmap);
+            break;
+        }
+
+        if (index != i) {
+            printf("displaylist: FAILED item %d added as %d\n", i, index);
+            failures++;
+        }
+    }
+}
+
+// the same items drawn on the background layer, uncovered pixels are the marker
+static void drawReference(void) {
+    backgroundLayer.fillScreen(marker);
+
+    for (int i = 0; i < itemCount; i++) {
+        const testItem &item = items[i];
+
+        switch (item.type) {
+        case displayListRectangle:
+            backgroundLayer.fillRectangle(item.x0, item.y0, item.x1, item.y1, item.color);
+            break;
+        case displayListRectangleOutline:
+            backgroundLayer.drawRectangle(item.x0, item.y0, item.x1, item.y1, item.color);
+            break;
+        case displayListLine:
+            backgroundLayer.drawLine(item.x0, item.y0, item.x1, item.y1, item.color);
+            break;
+        case displayListGlyphRun:
+            backgroundLayer.drawGlyphRun(item.x0, item.y0, item.color, textRun);
+            break;
+        case displayListMonoBitmap:
+            backgroundLayer.drawMonoBitmap(item.x0, item.y0, 12, 5, item.color, monoBitmap);
+            break;
+        }
+    }
+}
+
+// the list is shown from the next frame
+static void show(void) {
+    displayListLayer.swapBuffers();
+    backgroundLayer.swapBuffers(true);
+    smHostRefresh.runRows(16);
+}
+
+template <typename RGB_OUT>
+static bool sameRows(void) {
+    RGB_OUT expected[WIDTH], row[WIDTH];
+
+    for (int y = 0; y < HEIGHT; y++) {
+        backgroundLayer.fillRefreshRow(y, expected);
+        for (int x = 0; x < WIDTH; x++)
+            row[x] = marker;
+        displayListLayer.fillRefreshRow(y, row);
+        if (memcmp((uint8_t *)row, (uint8_t *)expected, sizeof(row)))
+            return false;
+    }
+    return true;
+}
+
+static void check(int rotation, int list, const char * what) {
+    if (!sameRows<rgb24>() || !sameRows<rgb48>()) {
+        printf("displaylist: FAILED %s, rotation %d, list %d\n", what, rotation * 90, list);
+        failures++;
+    }
+}
+
+int main(void) {
+    matrix.addLayer(&backgroundLayer);
+    matrix.addLayer(&displayListLayer);
+    matrix.begin();
+    backgroundLayer.enableColorCorrection(false);
+    displayListLayer.enableColorCorrection(false);
+
+    textRun.layout("Hi 42", &apple5x7, false);
+
+    for (int rotation = 0; rotation < 4; rotation++) {
+        rotate(rotation);
+
+        for (int list = 0; list < LISTS; list++) {
+            randomItems();
+            addItems();
+            drawReference();
+            show();
+            check(rotation, list, "new list");
+
+            // moving an item moves its top left (or first end point) and keeps its size
+            for (int i = 0; i < itemCount; i += 3) {
+                int16_t dx = randomNumber(21) - 10, dy = randomNumber(21) - 10;
+                items[i].x0 += dx;
+                items[i].y0 += dy;
+                items[i].x1 += dx;
+                items[i].y1 += dy;
+                items[i].color = randomColor();
+                displayListLayer.setItemPosition(i, items[i].x0, items[i].y0);
+                displayListLayer.setItemColor(i, items[i].color);
+            }
+            drawReference();
+            show();
+            check(rotation, list, "moved items");
+        }
+    }
+
+    if (failures)
+        return 1;
+    printf("displaylist: ok\n");
+    return 0;
+}
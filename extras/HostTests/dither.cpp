@@ -0,0 +1,135 @@
+/*
+ * SmartMatrix Library - Host Test - Temporal Dithering
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// with SMARTMATRIX_OPTIONS_TEMPORAL_DITHERING the levels a pixel is shown at over 2^n frames, where n is the number of bits
+// the refresh depth drops, have to add up to the 16-bit value it was drawn with
+// the levels are read back from the simulated GPIO output, REFRESH_DEPTH (24 or 36) comes from the Makefile
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+
+#define WIDTH 32
+#define HEIGHT 32
+#define COLOR_DEPTH 48
+#define LATCHES_PER_ROW (REFRESH_DEPTH / 3)
+#define DROPPED_BITS (16 - LATCHES_PER_ROW)
+#define FRAMES (1 << DROPPED_BITS)
+#define ROWS_PER_FRAME (HEIGHT / 2)
+// two bytes per pixel (clock low and high), then the row address
+#define BYTES_PER_LATCH (WIDTH * 2 + 1)
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, REFRESH_DEPTH, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, SMARTMATRIX_OPTIONS_TEMPORAL_DITHERING);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_BACKGROUND_OPTIONS_NONE);
+
+static uint8_t capture[ROWS_PER_FRAME * LATCHES_PER_ROW * BYTES_PER_LATCH];
+static uint32_t levelSums[HEIGHT][WIDTH][3];
+
+// dark values, where dropping the low bits loses the most
+static rgb48 testColor(int x, int y) {
+    uint16_t value = (y * WIDTH + x) * 2 + 1;
+    return rgb48(value, value / 2, value * 3);
+}
+
+int main(void) {
+    union {
+        uint32_t word;
+        struct {
+            uint32_t GPIO_WORD_ORDER;
+        };
+    } r1, g1, b1, r2, g2, b2;
+
+    r1.word = 0;
+    r1.p0r1 = 1;
+    g1.word = 0;
+    g1.p0g1 = 1;
+    b1.word = 0;
+    b1.p0b1 = 1;
+    r2.word = 0;
+    r2.p0r2 = 1;
+    g2.word = 0;
+    g2.p0g2 = 1;
+    b2.word = 0;
+    b2.p0b2 = 1;
+
+    const uint8_t channelMasks[2][3] = { { (uint8_t)r1.word, (uint8_t)g1.word, (uint8_t)b1.word },
+        { (uint8_t)r2.word, (uint8_t)g2.word, (uint8_t)b2.word } };
+
+    matrix.addLayer(&backgroundLayer);
+    matrix.begin();
+
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++)
+            backgroundLayer.drawPixel(x, y, testColor(x, y));
+    }
+    backgroundLayer.swapBuffers(false);
+    smHostRefresh.runRows(ROWS_PER_FRAME * 3);
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        smHostRefresh.setCaptureBuffer(capture, sizeof(capture));
+        smHostRefresh.runRows(ROWS_PER_FRAME);
+
+        for (int row = 0; row < ROWS_PER_FRAME; row++) {
+            for (int latch = 0; latch < LATCHES_PER_ROW; latch++) {
+                const uint8_t * data = &capture[(row * LATCHES_PER_ROW + latch) * BYTES_PER_LATCH];
+
+                // the row address is on the r1, g1, b1, r2, g2 pins after the pixel data
+                uint8_t address = data[WIDTH * 2];
+                int y = ((address & r1.word) ? 1 : 0) | ((address & g1.word) ? 2 : 0) | ((address & b1.word) ? 4 : 0) |
+                    ((address & r2.word) ? 8 : 0) | ((address & g2.word) ? 16 : 0);
+
+                for (int x = 0; x < WIDTH; x++) {
+                    for (int half = 0; half < 2; half++) {
+                        for (int channel = 0; channel < 3; channel++) {
+                            if (data[x * 2] & channelMasks[half][channel])
+                                levelSums[y + half * ROWS_PER_FRAME][x][channel] += 1 << latch;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    int failures = 0;
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            rgb48 color = testColor(x, y);
+            const uint16_t expected[3] = { color.red, color.green, color.blue };
+
+            for (int channel = 0; channel < 3; channel++) {
+                if (levelSums[y][x][channel] != expected[channel]) {
+                    if (failures++ < 10) {
+                        printf("dither: FAILED depth %d pixel %d,%d channel %d: levels add up to %u over %d frames, drawn as %u\n",
+                            REFRESH_DEPTH, x, y, channel, levelSums[y][x][channel], FRAMES, expected[channel]);
+                    }
+                }
+            }
+        }
+    }
+
+    if (failures)
+        return 1;
+
+    printf("dither: ok (depth %d, %d frames)\n", REFRESH_DEPTH, FRAMES);
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * SmartMatrix Library - Host Benchmark - Background Fills
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// megapixels per second for background layer fills, next to the same areas drawn one drawPixel() at a time
+// best of several runs, COLOR_DEPTH (24 or 48) comes from the Makefile
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+#include <time.h>
+
+#define WIDTH 64
+#define HEIGHT 32
+#define REPEATS 5000
+#define RUNS 9
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, 36, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, SMARTMATRIX_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_BACKGROUND_OPTIONS_NONE);
+
+typedef void (*drawFunction)(int i);
+
+static void fillScreen(int i) {
+    backgroundLayer.fillScreen(SM_RGB(i, 1, 2));
+}
+
+static void fillScreenPixels(int i) {
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++)
+            backgroundLayer.drawPixel(x, y, SM_RGB(i, 1, 2));
+    }
+}
+
+static void fillRectangle(int i) {
+    backgroundLayer.fillRectangle(3, 3, 23, 23, SM_RGB(i, 1, 2));
+}
+
+static void fillRectanglePixels(int i) {
+    for (int y = 3; y <= 23; y++) {
+        for (int x = 3; x <= 23; x++)
+            backgroundLayer.drawPixel(x, y, SM_RGB(i, 1, 2));
+    }
+}
+
+static void fillCircle(int i) {
+    backgroundLayer.fillCircle(32, 16, 15, SM_RGB(i, 1, 2));
+}
+
+static uint64_t nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// pixels draw() sets, counted on a cleared layer
+static int countPixels(drawFunction draw) {
+    int count = 0;
+
+    backgroundLayer.fillScreen(SM_RGB(0, 0, 0));
+    draw(255);
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            if (backgroundLayer.readPixel(x, y).red)
+                count++;
+        }
+    }
+    return count;
+}
+
+static double megapixelsPerSecond(drawFunction draw) {
+    uint64_t best = ~0ULL;
+
+    for (int run = 0; run < RUNS; run++) {
+        uint64_t start = nanoseconds();
+        for (int i = 0; i < REPEATS; i++)
+            draw(i);
+        uint64_t elapsed = nanoseconds() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return (double)countPixels(draw) * REPEATS * 1000 / best;
+}
+
+int main(void) {
+    matrix.addLayer(&backgroundLayer);
+    matrix.begin();
+
+    printf("fill rgb%d %dx%d, MP/s           fill  drawPixel\n", COLOR_DEPTH, WIDTH, HEIGHT);
+    printf("fill rgb%d fillScreen          %6.0f  %6.0f\n", COLOR_DEPTH, megapixelsPerSecond(fillScreen),
+        megapixelsPerSecond(fillScreenPixels));
+    printf("fill rgb%d fillRectangle 21x21 %6.0f  %6.0f\n", COLOR_DEPTH, megapixelsPerSecond(fillRectangle),
+        megapixelsPerSecond(fillRectanglePixels));
+    printf("fill rgb%d fillCircle r15      %6.0f\n", COLOR_DEPTH, megapixelsPerSecond(fillCircle));
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * SmartMatrix Library - Host Benchmark - Font Glyph Lookup
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// ns per character for getBitmapFontLocation() with each bundled font's Lookup table, with the binary search used
+// for fonts without one, and with a linear search of font->Index like the library used before the tables
+// the text is printable ASCII followed by printable Latin-1, so lookups jump around the index
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+#include <time.h>
+
+extern const bitmap_font tomthumb;
+
+#define PASSES 20000
+
+static const struct {
+    const char * name;
+    const bitmap_font * font;
+} fonts[] = {
+    { "apple3x5", &apple3x5 },
+    { "apple5x7", &apple5x7 },
+    { "apple6x10", &apple6x10 },
+    { "apple8x13", &apple8x13 },
+    { "gohufont6x11", &gohufont6x11 },
+    { "gohufont6x11b", &gohufont6x11b },
+    { "tomthumb", &tomthumb },
+};
+
+static unsigned char text[256];
+static int textLength;
+
+static int linearFontLocation(unsigned char letter, const bitmap_font * font) {
+    for (int i = 0; i < font->Chars; i++) {
+        if (font->Index[i] == letter)
+            return i;
+    }
+    return -1;
+}
+
+static uint64_t nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static double timeLookups(int (*lookup)(unsigned char, const bitmap_font *), const bitmap_font * font) {
+    volatile int sink = 0;
+
+    uint64_t start = nanoseconds();
+    for (int pass = 0; pass < PASSES; pass++) {
+        int sum = 0;
+        for (int i = 0; i < textLength; i++)
+            sum += lookup(text[i], font);
+        sink = sink + sum;
+    }
+    return (nanoseconds() - start) / ((double)PASSES * textLength);
+}
+
+int main(void) {
+    for (int c = 32; c < 127; c++)
+        text[textLength++] = c;
+    for (int c = 160; c < 256; c++)
+        text[textLength++] = c;
+
+    printf("font lookup, ns/char     linear  binary   table\n");
+    for (unsigned int i = 0; i < sizeof(fonts) / sizeof(fonts[0]); i++) {
+        bitmap_font noLookup = *fonts[i].font;
+        noLookup.Lookup = NULL;
+
+        printf("font lookup %-13s %7.1f %7.1f %7.1f\n", fonts[i].name, timeLookups(linearFontLocation, fonts[i].font),
+            timeLookups(getBitmapFontLocation, &noLookup), timeLookups(getBitmapFontLocation, fonts[i].font));
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * SmartMatrix Library - Host Test - Font Glyph Lookup
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// getBitmapFontLocation() has to find the same glyph as a plain search of font->Index for every 8-bit code,
+// both through the bundled fonts' Lookup tables and through the binary search used for fonts without one
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+
+extern const bitmap_font tomthumb;
+
+static const struct {
+    const char * name;
+    const bitmap_font * font;
+} fonts[] = {
+    { "apple3x5", &apple3x5 },
+    { "apple5x7", &apple5x7 },
+    { "apple6x10", &apple6x10 },
+    { "apple8x13", &apple8x13 },
+    { "gohufont6x11", &gohufont6x11 },
+    { "gohufont6x11b", &gohufont6x11b },
+    { "tomthumb", &tomthumb },
+};
+
+static int linearFontLocation(unsigned char letter, const bitmap_font * font) {
+    for (int i = 0; i < font->Chars; i++) {
+        if (font->Index[i] == letter)
+            return i;
+    }
+    return -1;
+}
+
+int main(void) {
+    int failures = 0;
+
+    for (unsigned int i = 0; i < sizeof(fonts) / sizeof(fonts[0]); i++) {
+        const bitmap_font * font = fonts[i].font;
+
+        // same font with the table removed, so the binary search is used
+        bitmap_font noLookup = *font;
+        noLookup.Lookup = NULL;
+
+        if (!font->Lookup) {
+            printf("fonts: FAILED %s has no Lookup table\n", fonts[i].name);
+            failures++;
+        }
+
+        for (int letter = 0; letter < 256; letter++) {
+            int expected = linearFontLocation(letter, font);
+            int table = getBitmapFontLocation(letter, font);
+            int binary = getBitmapFontLocation(letter, &noLookup);
+
+            if (table != expected || binary != expected) {
+                printf("fonts: FAILED %s code %d: search %d, table %d, binary %d\n", fonts[i].name, letter, expected,
+                    table, binary);
+                failures++;
+            }
+        }
+    }
+
+    if (failures)
+        return 1;
+
+    printf("fonts: ok\n");
+    return 0;
+}
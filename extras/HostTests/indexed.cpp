@@ -0,0 +1,136 @@
+/*
+ * SmartMatrix Library - Indexed Layer Host Test
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// indexed layers at 1, 2, 4 and 8 bits per pixel have to refresh the same rows as a background layer drawn with the
+// palette colors, on a non-square panel at every rotation, for rgb24 and rgb48 refresh rows and after palette changes
+// the pattern is drawn past every edge so drawPixel() has to clip, index 0 is transparent and leaves the row alone
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH 64
+#define HEIGHT 32
+#define COLOR_DEPTH 24
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, 36, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, SMARTMATRIX_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_BACKGROUND_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_INDEXED_LAYER(indexedLayer1, WIDTH, HEIGHT, COLOR_DEPTH, SM_INDEXED_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_INDEXED_LAYER(indexedLayer2, WIDTH, HEIGHT, COLOR_DEPTH, SM_INDEXED_OPTIONS_2BPP);
+SMARTMATRIX_ALLOCATE_INDEXED_LAYER(indexedLayer4, WIDTH, HEIGHT, COLOR_DEPTH, SM_INDEXED_OPTIONS_4BPP);
+SMARTMATRIX_ALLOCATE_INDEXED_LAYER(indexedLayer8, WIDTH, HEIGHT, COLOR_DEPTH, SM_INDEXED_OPTIONS_8BPP);
+
+static const rgb24 marker(1, 2, 3);
+static int failures = 0;
+
+static uint8_t patternIndex(int x, int y, int bitsPerPixel) {
+    return ((x * 7) + (y * 13) + (x ^ y)) & ((1 << bitsPerPixel) - 1);
+}
+
+static rgb24 paletteColor(int index, int version) {
+    return rgb24((index * 37) + 5 + version, index * 11, 255 - (index * 3) - version);
+}
+
+// draws the pattern on the indexed layer and its colors on the background layer, marker where the index is 0
+template <typename LAYER>
+static void drawPattern(LAYER &indexedLayer, int bitsPerPixel, int version) {
+    int width = matrix.getScreenWidth();
+    int height = matrix.getScreenHeight();
+
+    for (int i = 0; i < (1 << bitsPerPixel); i++)
+        indexedLayer.setIndexedColor(i, paletteColor(i, version));
+
+    indexedLayer.fillScreen(0);
+    backgroundLayer.fillScreen(marker);
+    for (int y = -2; y < height + 2; y++) {
+        for (int x = -2; x < width + 2; x++) {
+            uint8_t index = patternIndex(x, y, bitsPerPixel);
+            indexedLayer.drawPixel(x, y, index);
+            if (index)
+                backgroundLayer.drawPixel(x, y, paletteColor(index, version));
+        }
+    }
+    indexedLayer.swapBuffers(true);
+    backgroundLayer.swapBuffers(true);
+}
+
+// rotation changes take effect at the start of the next frame, 16 rows on a 32 row, 1/16 scan panel
+static void rotate(int rotation) {
+    matrix.setRotation((rotationDegrees)rotation);
+    smHostRefresh.runRows(16);
+}
+
+template <typename LAYER, typename RGB_OUT>
+static bool sameRows(LAYER &indexedLayer) {
+    RGB_OUT expected[WIDTH], row[WIDTH];
+
+    for (int y = 0; y < HEIGHT; y++) {
+        backgroundLayer.fillRefreshRow(y, expected);
+        for (int x = 0; x < WIDTH; x++)
+            row[x] = marker;
+        indexedLayer.fillRefreshRow(y, row);
+        if (memcmp((uint8_t *)row, (uint8_t *)expected, sizeof(row)))
+            return false;
+    }
+    return true;
+}
+
+template <typename LAYER>
+static void checkLayer(LAYER &indexedLayer, int bitsPerPixel) {
+    indexedLayer.enableColorCorrection(false);
+
+    for (int rotation = 0; rotation < 4; rotation++) {
+        rotate(rotation);
+
+        // the second version changes the palette after the first was used, the refresh palette has to follow
+        for (int version = 0; version < 2; version++) {
+            drawPattern(indexedLayer, bitsPerPixel, version);
+            if (!sameRows<LAYER, rgb24>(indexedLayer) || !sameRows<LAYER, rgb48>(indexedLayer)) {
+                printf("indexed: FAILED %d bpp, rotation %d, palette %d\n", bitsPerPixel, rotation * 90, version);
+                failures++;
+            }
+        }
+    }
+    rotate(0);
+}
+
+int main(void) {
+    matrix.addLayer(&backgroundLayer);
+    matrix.addLayer(&indexedLayer1);
+    matrix.addLayer(&indexedLayer2);
+    matrix.addLayer(&indexedLayer4);
+    matrix.addLayer(&indexedLayer8);
+    matrix.begin();
+    backgroundLayer.enableColorCorrection(false);
+
+    checkLayer(indexedLayer1, 1);
+    checkLayer(indexedLayer2, 2);
+    checkLayer(indexedLayer4, 4);
+    checkLayer(indexedLayer8, 8);
+
+    if (failures)
+        return 1;
+    printf("indexed: ok\n");
+    return 0;
+}
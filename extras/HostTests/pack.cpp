@@ -0,0 +1,133 @@
+/*
+ * SmartMatrix Library - Host Benchmark - Bit-Plane Packing
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// cycles per pixel spent converting refresh rows to bit-plane DMA data, as measured by the profiler's packing stage,
+// next to a reference that sets one GPIO_WORD_ORDER bitfield per channel per bit plane like loadMatrixBuffers48() used to
+// cycles are host time scaled to F_CPU, so compare the two numbers with each other rather than with a Teensy
+// REFRESH_DEPTH and WIDTH come from the Makefile
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+
+#define COLOR_DEPTH 24
+#define HEIGHT 32
+#define LATCHES_PER_ROW (REFRESH_DEPTH / 3)
+#define REFERENCE_ROWS 2000
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, REFRESH_DEPTH, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, SMARTMATRIX_OPTIONS_PROFILING);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_BACKGROUND_OPTIONS_NONE);
+
+static uint32_t referenceBuffer[WIDTH * LATCHES_PER_ROW / 2];
+static uint16_t channels[WIDTH][6];
+
+static void referencePackRow(void) {
+    uint32_t * wordptr = referenceBuffer;
+
+    for (int i = 0; i < WIDTH; i++) {
+        const uint16_t * c = channels[i];
+
+        for (int j = 0; j < LATCHES_PER_ROW / 4; j++) {
+            int shift = j * 4;
+            union {
+                uint32_t word;
+                struct {
+                    uint32_t GPIO_WORD_ORDER;
+                };
+            } o, clkset;
+
+            o.word = 0;
+            o.p0r1 = c[0] >> (shift + 0);
+            o.p0g1 = c[1] >> (shift + 0);
+            o.p0b1 = c[2] >> (shift + 0);
+            o.p0r2 = c[3] >> (shift + 0);
+            o.p0g2 = c[4] >> (shift + 0);
+            o.p0b2 = c[5] >> (shift + 0);
+            o.p1r1 = c[0] >> (shift + 1);
+            o.p1g1 = c[1] >> (shift + 1);
+            o.p1b1 = c[2] >> (shift + 1);
+            o.p1r2 = c[3] >> (shift + 1);
+            o.p1g2 = c[4] >> (shift + 1);
+            o.p1b2 = c[5] >> (shift + 1);
+            o.p2r1 = c[0] >> (shift + 2);
+            o.p2g1 = c[1] >> (shift + 2);
+            o.p2b1 = c[2] >> (shift + 2);
+            o.p2r2 = c[3] >> (shift + 2);
+            o.p2g2 = c[4] >> (shift + 2);
+            o.p2b2 = c[5] >> (shift + 2);
+            o.p3r1 = c[0] >> (shift + 3);
+            o.p3g1 = c[1] >> (shift + 3);
+            o.p3b1 = c[2] >> (shift + 3);
+            o.p3r2 = c[3] >> (shift + 3);
+            o.p3g2 = c[4] >> (shift + 3);
+            o.p3b2 = c[5] >> (shift + 3);
+
+            clkset.word = 0;
+            clkset.p0clk = 1;
+            clkset.p1clk = 1;
+            clkset.p2clk = 1;
+            clkset.p3clk = 1;
+
+            wordptr[j] = o.word;
+            wordptr[j + LATCHES_PER_ROW / 4] = o.word | clkset.word;
+        }
+        wordptr += LATCHES_PER_ROW / 2;
+    }
+}
+
+int main(void) {
+    matrix.addLayer(&backgroundLayer);
+    matrix.begin();
+
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            int i = y * WIDTH + x;
+            backgroundLayer.drawPixel(x, y, rgb24(i * 7, i * 13, i * 29));
+        }
+    }
+    backgroundLayer.swapBuffers(false);
+
+    smHostRefresh.runRows(16 * 50);
+    matrix.resetProfile();
+    smHostRefresh.runRows(16 * 2000);
+
+    profileStats stats;
+    matrix.getProfileStats(profileStagePacking, &stats);
+
+    for (int i = 0; i < WIDTH; i++) {
+        for (int j = 0; j < 6; j++)
+            channels[i][j] = (i + 1) * (j + 7) * 2654435761u >> 16;
+    }
+
+    uint32_t startCycles = profileCycleCount();
+    for (int i = 0; i < REFERENCE_ROWS; i++) {
+        referencePackRow();
+        // keep the compiler from merging rows
+        asm volatile("" : : "r"(referenceBuffer) : "memory");
+    }
+    uint32_t referenceCycles = (profileCycleCount() - startCycles) / REFERENCE_ROWS;
+
+    printf("pack depth %2d width %3d: %5.2f cycles/pixel, bitfield reference %5.2f cycles/pixel\n", REFRESH_DEPTH, WIDTH,
+        stats.avgCycles / (double)(WIDTH * 2), referenceCycles / (double)(WIDTH * 2));
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * SmartMatrix Library - Host Test - Refresh Output
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// draws the same scene on background, scrolling and indexed layers and prints a checksum of the GPIO output,
+// configuration comes from the Makefile: REFRESH_DEPTH, WIDTH, HEIGHT, MATRIX_OPTIONS, ROTATION
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+
+#define COLOR_DEPTH 24
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, REFRESH_DEPTH, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, MATRIX_OPTIONS);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_BACKGROUND_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_SCROLLING_LAYER(scrollingLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_SCROLLING_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_INDEXED_LAYER(indexedLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_INDEXED_OPTIONS_NONE);
+
+int main(void) {
+    matrix.addLayer(&backgroundLayer);
+    matrix.addLayer(&scrollingLayer);
+    matrix.addLayer(&indexedLayer);
+    matrix.setRotation((rotationDegrees)ROTATION);
+    matrix.begin();
+
+    backgroundLayer.fillScreen(rgb24(10, 20, 30));
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            if ((x * 7 + y * 3) % 5)
+                backgroundLayer.drawPixel(x, y, rgb24(x * 5 + y, y * 9, x * y));
+        }
+    }
+    backgroundLayer.drawLine(0, 0, 31, 20, rgb24(255, 0, 0));
+    backgroundLayer.fillCircle(16, 16, 8, rgb24(0, 255, 0));
+    backgroundLayer.drawString(2, 2, rgb24(0, 0, 255), "Hi");
+    backgroundLayer.swapBuffers(false);
+    scrollingLayer.start("Hello World", -1);
+    indexedLayer.drawString(0, 20, 1, "ABC");
+    indexedLayer.swapBuffers(false);
+
+    // let the swaps and the first frame through, then record 200 frames of 16 rows
+    smHostRefresh.runRows(16 * 3);
+    smHostRefresh.resetCounters();
+    smHostRefresh.runRows(16 * 200);
+
+    printf("%d %d %d %d %d: checksum %08x rows %u latches %u idle %u\n", REFRESH_DEPTH, WIDTH, HEIGHT, MATRIX_OPTIONS,
+        ROTATION, smHostRefresh.getChecksum(), smHostRefresh.getRowCount(), smHostRefresh.getLatchCount(),
+        smHostRefresh.getIdleLatchCount());
+    return 0;
+}
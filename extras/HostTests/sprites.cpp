@@ -0,0 +1,203 @@
+/*
+ * SmartMatrix Library - Sprite Layer Host Test
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// the sprite layer has to refresh the same rows as a background layer with the sprites drawn one pixel at a time,
+// for every pixel format, flips, the color key, overlapping and clipped sprites, on a non-square panel at every rotation
+// hidden sprites and indexed sprites without a palette must not show, and sprites that move must leave their old rows
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH 64
+#define HEIGHT 32
+#define COLOR_DEPTH 24
+#define NUM_SPRITES 6
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, 36, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, SMARTMATRIX_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_BACKGROUND_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_SPRITE_LAYER(spriteLayer, WIDTH, HEIGHT, COLOR_DEPTH, NUM_SPRITES, SM_SPRITES_OPTIONS_NONE);
+
+struct testSprite {
+    spriteFormats format;
+    uint8_t width, height;
+    bool flipX, flipY;
+    bool colorKey;
+    bool visible;
+    bool palette;
+};
+
+// sprite 4 is hidden, sprite 5 has no palette so setSpriteImage() ignores it
+static const testSprite testSprites[NUM_SPRITES] = {
+    { spriteFormatRGB, 10, 7, false, false, true, true, false },
+    { spriteFormat1bpp, 9, 5, true, false, false, true, true },
+    { spriteFormat4bpp, 7, 6, false, true, false, true, true },
+    { spriteFormat8bpp, 5, 9, true, true, false, true, true },
+    { spriteFormatRGB, 6, 6, false, false, false, false, false },
+    { spriteFormat4bpp, 8, 8, false, false, false, true, false },
+};
+
+// top left of each sprite, overlapping each other and past every edge of the rotated screens
+static const int16_t positions[][NUM_SPRITES][2] = {
+    { { 0, 0 }, { 4, 3 }, { 8, 2 }, { 12, 1 }, { 2, 2 }, { 20, 10 } },
+    { { -4, -3 }, { 27, 28 }, { 60, 2 }, { 28, -5 }, { 30, 10 }, { 5, 5 } },
+    { { 58, 27 }, { -6, 15 }, { 29, 29 }, { -3, 25 }, { 0, 0 }, { 0, 0 } },
+    { { 25, 12 }, { 26, 13 }, { 27, 14 }, { 28, 12 }, { 26, 13 }, { 26, 13 } },
+};
+
+static const rgb24 marker(1, 2, 3);
+static const rgb24 colorKey(200, 0, 100);
+
+static rgb24 palette[256];
+static rgb24 rgbPixels[2][10 * 7];
+static uint8_t indexedPixels[NUM_SPRITES][8 * 9];
+static int failures = 0;
+
+static uint8_t bitsPerPixel(spriteFormats format) {
+    return (format == spriteFormat1bpp) ? 1 : (format == spriteFormat4bpp) ? 4 : 8;
+}
+
+// the reference pixel at x, y of the unflipped sprite, false if it's transparent
+static bool spritePixel(int sprite, int x, int y, rgb24 &color) {
+    const testSprite &test = testSprites[sprite];
+
+    if (test.format == spriteFormatRGB) {
+        color = rgbPixels[sprite ? 1 : 0][(y * test.width) + x];
+        return !(test.colorKey && !memcmp(&color, &colorKey, sizeof(rgb24)));
+    }
+
+    uint8_t index = ((x * 3) + (y * 5) + sprite) % ((1 << bitsPerPixel(test.format)) + 1);
+    if (!index || index >= (1 << bitsPerPixel(test.format)))
+        return false;
+
+    color = palette[index];
+    return true;
+}
+
+static void makeSprites(void) {
+    for (int i = 0; i < 256; i++)
+        palette[i] = rgb24(i, 255 - i, (i * 7) + 4);
+
+    for (int sprite = 0; sprite < NUM_SPRITES; sprite++) {
+        const testSprite &test = testSprites[sprite];
+
+        if (test.format == spriteFormatRGB) {
+            // every fourth pixel is the color key
+            for (int i = 0; i < test.width * test.height; i++)
+                rgbPixels[sprite ? 1 : 0][i] = (i % 4) ? rgb24(i * 3, sprite * 40, 255 - i) : colorKey;
+            spriteLayer.setSpriteImage(sprite, test.format, test.width, test.height, rgbPixels[sprite ? 1 : 0]);
+        } else {
+            // indexed rows start on a new byte, leftmost pixel in the most significant bits
+            int bits = bitsPerPixel(test.format);
+            int rowSize = ((test.width * bits) + 7) / 8;
+
+            for (int y = 0; y < test.height; y++) {
+                for (int x = 0; x < test.width; x++) {
+                    uint8_t index = ((x * 3) + (y * 5) + sprite) % ((1 << bits) + 1);
+                    if (index >= (1 << bits))
+                        index = 0;
+                    indexedPixels[sprite][(y * rowSize) + ((x * bits) / 8)] |= index << ((8 - bits) - ((x * bits) % 8));
+                }
+            }
+            spriteLayer.setSpriteImage(sprite, test.format, test.width, test.height, indexedPixels[sprite],
+                test.palette ? palette : NULL);
+        }
+
+        spriteLayer.setSpriteFlip(sprite, test.flipX, test.flipY);
+        spriteLayer.setSpriteColorKey(sprite, test.colorKey, colorKey);
+        spriteLayer.showSprite(sprite, test.visible);
+    }
+}
+
+// sprites with higher numbers on top, drawn one pixel at a time on the background layer
+static void drawReference(int position) {
+    backgroundLayer.fillScreen(marker);
+
+    for (int sprite = 0; sprite < NUM_SPRITES; sprite++) {
+        const testSprite &test = testSprites[sprite];
+        rgb24 color;
+
+        if (!test.visible || (test.format != spriteFormatRGB && !test.palette))
+            continue;
+
+        for (int y = 0; y < test.height; y++) {
+            for (int x = 0; x < test.width; x++) {
+                int spriteX = test.flipX ? (test.width - 1) - x : x;
+                int spriteY = test.flipY ? (test.height - 1) - y : y;
+
+                if (spritePixel(sprite, spriteX, spriteY, color))
+                    backgroundLayer.drawPixel(positions[position][sprite][0] + x, positions[position][sprite][1] + y, color);
+            }
+        }
+    }
+    backgroundLayer.swapBuffers(true);
+}
+
+template <typename RGB_OUT>
+static bool sameRows(void) {
+    RGB_OUT expected[WIDTH], row[WIDTH];
+
+    for (int y = 0; y < HEIGHT; y++) {
+        backgroundLayer.fillRefreshRow(y, expected);
+        for (int x = 0; x < WIDTH; x++)
+            row[x] = marker;
+        spriteLayer.fillRefreshRow(y, row);
+        if (memcmp((uint8_t *)row, (uint8_t *)expected, sizeof(row)))
+            return false;
+    }
+    return true;
+}
+
+int main(void) {
+    matrix.addLayer(&backgroundLayer);
+    matrix.addLayer(&spriteLayer);
+    matrix.begin();
+    backgroundLayer.enableColorCorrection(false);
+    spriteLayer.enableColorCorrection(false);
+
+    makeSprites();
+
+    for (int rotation = 0; rotation < 4; rotation++) {
+        matrix.setRotation((rotationDegrees)rotation);
+
+        for (unsigned int position = 0; position < sizeof(positions) / sizeof(positions[0]); position++) {
+            for (int sprite = 0; sprite < NUM_SPRITES; sprite++)
+                spriteLayer.setSpritePosition(sprite, positions[position][sprite][0], positions[position][sprite][1]);
+
+            // rotation and sprite changes are taken in at the start of the next frame, 16 rows on a 1/16 scan panel
+            smHostRefresh.runRows(16);
+            drawReference(position);
+
+            if (!sameRows<rgb24>() || !sameRows<rgb48>()) {
+                printf("sprites: FAILED rotation %d, positions %d\n", rotation * 90, position);
+                failures++;
+            }
+        }
+    }
+
+    if (failures)
+        return 1;
+    printf("sprites: ok\n");
+    return 0;
+}
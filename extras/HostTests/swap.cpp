@@ -0,0 +1,354 @@
+/*
+ * SmartMatrix Library - Host Test - Blocking Buffer Swaps
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// swapBuffers() waits for the refresh ISR, on the host build the wait has to advance the simulated refresh or it never returns
+// BACKGROUND_OPTIONS comes from the Makefile, the background layer is tested double and triple buffered
+// a random mix of drawing, swaps with and without copy, trySwap(), acquireBackBuffer() and copyRefreshToDrawing() is checked
+// against a model of the drawing buffer and the frames, on a non-square panel at every rotation:
+//   readPixel() has to match the modeled drawing buffer, the refresh rows the last frame the refresh took,
+//   and getDamageRegion() has to cover every pixel where the drawing buffer differs from the last finished frame
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH 64
+#define HEIGHT 32
+#define COLOR_DEPTH 24
+#define STEPS 600
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, 36, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, SMARTMATRIX_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, COLOR_DEPTH, BACKGROUND_OPTIONS);
+SMARTMATRIX_ALLOCATE_INDEXED_LAYER(indexedLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_INDEXED_OPTIONS_NONE);
+
+static const bool tripleBuffer = BACKGROUND_OPTIONS & SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER;
+
+static int failures = 0;
+
+static void expect(bool condition, const char * what) {
+    if (!condition) {
+        printf("swap: FAILED %s (%s buffered)\n", what, tripleBuffer ? "triple" : "double");
+        failures++;
+    }
+}
+
+// frames as the sketch sees them, in screen coordinates of the current rotation
+static rgb24 drawing[WIDTH * HEIGHT];
+static rgb24 finished[WIDTH * HEIGHT];
+static rgb24 pending[WIDTH * HEIGHT];
+static rgb24 shown[WIDTH * HEIGHT];
+static bool swapPending = false;
+static int currentRotation = 0;
+static uint32_t randomState = 1;
+
+static int randomNumber(int range) {
+    randomState = (randomState * 1103515245) + 12345;
+    return (randomState >> 16) % range;
+}
+
+static rgb24 randomColor(void) {
+    return rgb24(randomNumber(256), randomNumber(256), randomNumber(256));
+}
+
+static bool sameColor(const rgb24 &a, const rgb24 &b) {
+    return a.red == b.red && a.green == b.green && a.blue == b.blue;
+}
+
+// where x, y on the rotated screen is on the panel, worked out here rather than with the layer's strides
+static void screenToHardware(int x, int y, int &hardwareX, int &hardwareY) {
+    switch (currentRotation) {
+    case 0:             hardwareX = x;                  hardwareY = y;                  break;
+    case 1:             hardwareX = (WIDTH - 1) - y;    hardwareY = x;                  break;
+    case 2:             hardwareX = (WIDTH - 1) - x;    hardwareY = (HEIGHT - 1) - y;   break;
+    default:            hardwareX = y;                  hardwareY = (HEIGHT - 1) - x;   break;
+    }
+}
+
+// the swap queued in the model is shown once the layer no longer reports it pending
+static void syncShown(void) {
+    if (swapPending && !backgroundLayer.isSwapPending()) {
+        memcpy((uint8_t *)shown, (uint8_t *)pending, sizeof(shown));
+        swapPending = false;
+    }
+}
+
+// one refresh frame is 16 rows on a 32 row, 1/16 scan panel
+static void nextFrame(void) {
+    smHostRefresh.runRows(HEIGHT / 2);
+    syncShown();
+}
+
+// rotation changes take effect at the start of the next frame
+static void rotate(int rotation) {
+    matrix.setRotation((rotationDegrees)rotation);
+    currentRotation = rotation;
+    nextFrame();
+}
+
+static void queueSwap(void) {
+    memcpy((uint8_t *)finished, (uint8_t *)drawing, sizeof(finished));
+    memcpy((uint8_t *)pending, (uint8_t *)drawing, sizeof(pending));
+    swapPending = true;
+}
+
+static void fillRectangle(int x0, int y0, int x1, int y1, const rgb24 &color) {
+    int width = matrix.getScreenWidth();
+    int height = matrix.getScreenHeight();
+
+    backgroundLayer.fillRectangle(x0, y0, x1, y1, color);
+    for (int y = (y0 < 0) ? 0 : y0; y <= y1 && y < height; y++) {
+        for (int x = (x0 < 0) ? 0 : x0; x <= x1 && x < width; x++)
+            drawing[(y * width) + x] = color;
+    }
+}
+
+static void checkDrawing(const char * step) {
+    int width = matrix.getScreenWidth();
+    int height = matrix.getScreenHeight();
+    const SMDamageRegion &damage = backgroundLayer.getDamageRegion();
+    bool sameAsModel = true, damageCovered = true;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (!sameColor(backgroundLayer.readPixel(x, y), drawing[(y * width) + x]))
+                sameAsModel = false;
+
+            if (sameColor(drawing[(y * width) + x], finished[(y * width) + x]))
+                continue;
+
+            int hardwareX, hardwareY;
+            bool covered = false;
+
+            screenToHardware(x, y, hardwareX, hardwareY);
+            for (int i = 0; i < damage.getRectCount(); i++) {
+                const damageRect &rect = damage.getRect(i);
+                if (hardwareX >= rect.x0 && hardwareX <= rect.x1 && hardwareY >= rect.y0 && hardwareY <= rect.y1)
+                    covered = true;
+            }
+            if (!covered)
+                damageCovered = false;
+        }
+    }
+
+    if (!sameAsModel) {
+        printf("swap: drawing buffer differs after %s, rotation %d\n", step, currentRotation * 90);
+        expect(false, "drawing buffer");
+    }
+    if (!damageCovered) {
+        printf("swap: damage region misses a change after %s, rotation %d\n", step, currentRotation * 90);
+        expect(false, "damage region");
+    }
+}
+
+static void checkShown(void) {
+    int width = matrix.getScreenWidth();
+    int height = matrix.getScreenHeight();
+    rgb24 rows[HEIGHT][WIDTH];
+    bool same = true;
+
+    for (int y = 0; y < HEIGHT; y++)
+        backgroundLayer.fillRefreshRow(y, rows[y]);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int hardwareX, hardwareY;
+
+            screenToHardware(x, y, hardwareX, hardwareY);
+            if (!sameColor(rows[hardwareY][hardwareX], shown[(y * width) + x]))
+                same = false;
+        }
+    }
+
+    if (!same) {
+        printf("swap: refresh shows the wrong frame, rotation %d\n", currentRotation * 90);
+        expect(false, "shown frame");
+    }
+}
+
+static void randomSteps(void) {
+    int width = matrix.getScreenWidth();
+    int height = matrix.getScreenHeight();
+    bool drawingKnown = true;
+
+    for (int step = 0; step < STEPS; step++) {
+        int x = randomNumber(width + 8) - 4;
+        int y = randomNumber(height + 8) - 4;
+        const char * name;
+
+        // triple buffered swaps without copy leave an older frame to draw into, the sketch has to redraw or copy
+        int choice = drawingKnown ? randomNumber(20) : 14 + (randomNumber(2) * 2);
+
+        if (choice < 6) {
+            name = "drawPixel()";
+            rgb24 color = randomColor();
+            backgroundLayer.drawPixel(x, y, color);
+            if (x >= 0 && x < width && y >= 0 && y < height)
+                drawing[(y * width) + x] = color;
+        } else if (choice < 10) {
+            name = "fillRectangle()";
+            fillRectangle(x, y, x + randomNumber(12), y + randomNumber(6), randomColor());
+        } else if (choice < 11) {
+            name = "acquireBackBuffer()";
+            // written in hardware order, the layer can't know where
+            RGB_TYPE(COLOR_DEPTH) * buffer = backgroundLayer.acquireBackBuffer();
+            if (!buffer)
+                continue;
+            rgb24 color = randomColor();
+            int hardwareX, hardwareY;
+            x = randomNumber(width);
+            y = randomNumber(height);
+            screenToHardware(x, y, hardwareX, hardwareY);
+            buffer[(hardwareY * WIDTH) + hardwareX] = color;
+            drawing[(y * width) + x] = color;
+        } else if (choice < 13) {
+            name = "swapBuffers(true)";
+            queueSwap();
+            backgroundLayer.swapBuffers(true);
+            syncShown();
+            if (!tripleBuffer)
+                expect(!backgroundLayer.isSwapPending(), "swap still pending after swapBuffers(true)");
+        } else if (choice < 14) {
+            name = "swapBuffers(false)";
+            queueSwap();
+            if (tripleBuffer) {
+                backgroundLayer.swapBuffers(false);
+                drawingKnown = false;
+                continue;
+            }
+            // the new drawing buffer is the frame that was shown, once the swap is done
+            rgb24 previous[WIDTH * HEIGHT];
+            memcpy((uint8_t *)previous, (uint8_t *)shown, sizeof(previous));
+            backgroundLayer.swapBuffers(false);
+            expect(backgroundLayer.isSwapPending(), "swap not pending after swapBuffers(false)");
+            while (backgroundLayer.isSwapPending())
+                nextFrame();
+            syncShown();
+            memcpy((uint8_t *)drawing, (uint8_t *)previous, sizeof(drawing));
+        } else if (choice < 15) {
+            name = "fillScreen()";
+            fillRectangle(0, 0, width - 1, height - 1, randomColor());
+            drawingKnown = true;
+        } else if (choice < 16) {
+            name = "trySwap()";
+            bool wasPending = backgroundLayer.isSwapPending();
+            if (!backgroundLayer.trySwap()) {
+                expect(!tripleBuffer && wasPending, "trySwap() failed without a pending swap");
+                continue;
+            }
+            queueSwap();
+            if (tripleBuffer) {
+                drawingKnown = false;
+                continue;
+            }
+            // double buffered, the sketch waits before drawing again, the frame that was shown is drawn into
+            rgb24 previous[WIDTH * HEIGHT];
+            memcpy((uint8_t *)previous, (uint8_t *)shown, sizeof(previous));
+            while (backgroundLayer.isSwapPending())
+                nextFrame();
+            memcpy((uint8_t *)drawing, (uint8_t *)previous, sizeof(drawing));
+        } else if (choice < 17) {
+            name = "copyRefreshToDrawing()";
+            // double buffered, the shown buffer becomes the drawing buffer when a swap completes, so wait for it
+            if (!tripleBuffer) {
+                while (backgroundLayer.isSwapPending())
+                    nextFrame();
+            }
+            backgroundLayer.copyRefreshToDrawing();
+            memcpy((uint8_t *)drawing, (uint8_t *)shown, sizeof(drawing));
+            drawingKnown = true;
+        } else {
+            name = "next frame";
+            nextFrame();
+            checkShown();
+        }
+
+        checkDrawing(name);
+        if (failures)
+            return;
+    }
+}
+
+int main(void) {
+    matrix.addLayer(&backgroundLayer);
+    matrix.addLayer(&indexedLayer);
+    matrix.begin();
+    backgroundLayer.enableColorCorrection(false);
+    indexedLayer.enableColorCorrection(false);
+
+    for (int i = 0; i < 4; i++) {
+        rgb24 color(i * 40, 2, 3);
+        rgb24 row[WIDTH];
+
+        // with copy swapBuffers() waits until the frame is shown and the drawing buffer holds it again,
+        // triple buffered it returns at once and the frame is shown from the next refresh frame
+        backgroundLayer.fillScreen(color);
+        backgroundLayer.swapBuffers(true);
+        if (tripleBuffer)
+            nextFrame();
+        expect(!backgroundLayer.isSwapPending(), "background swap still pending after swapBuffers(true)");
+
+        backgroundLayer.fillRefreshRow(5, row);
+        expect(row[7].red == color.red && row[7].green == color.green, "background frame not shown after swapBuffers()");
+        expect(backgroundLayer.readPixel(7, 5).red == color.red, "background drawing buffer not copied");
+
+        indexedLayer.fillScreen(0);
+        indexedLayer.drawPixel(7, 5, 1);
+        indexedLayer.setIndexedColor(1, color);
+        indexedLayer.swapBuffers(i & 1);
+        if (!(i & 1))
+            indexedLayer.swapBuffers(true);
+
+        for (int x = 0; x < WIDTH; x++)
+            row[x] = rgb24(0, 0, 0);
+        indexedLayer.fillRefreshRow(5, row);
+        expect(row[7].red == color.red && row[7].blue == color.blue, "indexed frame not shown after swapBuffers()");
+    }
+
+    // without copy swapBuffers() returns at once, the next call waits for the previous swap (or replaces it)
+    backgroundLayer.swapBuffers(false);
+    expect(backgroundLayer.isSwapPending(), "background swap not pending after swapBuffers(false)");
+    backgroundLayer.swapBuffers(false);
+    expect(backgroundLayer.isSwapPending(), "background swap not pending after second swapBuffers(false)");
+
+    for (int rotation = 0; rotation < 4 && !failures; rotation++) {
+        rotate(rotation);
+
+        // start from a known frame
+        fillRectangle(0, 0, matrix.getScreenWidth() - 1, matrix.getScreenHeight() - 1, randomColor());
+        queueSwap();
+        backgroundLayer.swapBuffers(true);
+        while (backgroundLayer.isSwapPending())
+            nextFrame();
+        syncShown();
+
+        randomSteps();
+    }
+    rotate(0);
+
+    if (failures)
+        return 1;
+
+    printf("swap: ok (%s buffered)\n", tripleBuffer ? "triple" : "double");
+    return 0;
+}
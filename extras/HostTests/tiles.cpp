@@ -0,0 +1,185 @@
+/*
+ * SmartMatrix Library - Tile Layer Host Test
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// the tile layer has to refresh the same rows as a background layer drawn one pixel at a time from the tiles, for
+// each tile format and size, with canvases smaller and larger than the screen scrolled to positions that wrap around
+// in both directions, on a non-square panel at every rotation
+
+#include "SmartMatrix3.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH 64
+#define HEIGHT 32
+#define COLOR_DEPTH 24
+#define NUM_TILES 4
+#define SCROLLS 20
+
+SMARTMATRIX_ALLOCATE_BUFFERS(matrix, WIDTH, HEIGHT, 36, 4, SMARTMATRIX_HUB75_32ROW_MOD16SCAN, SMARTMATRIX_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, WIDTH, HEIGHT, COLOR_DEPTH, SM_BACKGROUND_OPTIONS_NONE);
+// 40 x 24 canvas of 8 pixel tiles, and 96 x 64 of 16 pixel tiles
+SMARTMATRIX_ALLOCATE_TILE_LAYER(smallTileLayer, WIDTH, HEIGHT, COLOR_DEPTH, 5, 3, 8, SM_TILES_OPTIONS_NONE);
+SMARTMATRIX_ALLOCATE_TILE_LAYER(largeTileLayer, WIDTH, HEIGHT, COLOR_DEPTH, 6, 4, 16, SM_TILES_OPTIONS_NONE);
+
+static const rgb24 marker(1, 2, 3);
+
+static rgb24 palette[256];
+static rgb24 rgbTiles[NUM_TILES * 16 * 16];
+static uint8_t indexedTiles[NUM_TILES * 16 * 16];
+static uint32_t randomState = 1;
+static int failures = 0;
+
+static int randomNumber(int range) {
+    randomState = (randomState * 1103515245) + 12345;
+    return (randomState >> 16) % range;
+}
+
+// rotation and scroll changes take effect at the start of the next frame, 16 rows on a 32 row, 1/16 scan panel
+static void nextFrame(void) {
+    smHostRefresh.runRows(16);
+}
+
+// the reference index of pixel x, y of a tile, index 0 is transparent
+static uint8_t tileIndex(int tile, int x, int y, int levels) {
+    return ((x * 5) + (y * 3) + (tile * 7) + (x * y)) % levels;
+}
+
+static void makeTiles(tileFormats format, int tileSize) {
+    int levels = (format == tileFormat4bpp) ? 16 : 256;
+
+    memset(indexedTiles, 0x00, sizeof(indexedTiles));
+    for (int tile = 0; tile < NUM_TILES; tile++) {
+        for (int y = 0; y < tileSize; y++) {
+            for (int x = 0; x < tileSize; x++) {
+                // tiles one after the other, tileSize rows each, 4bpp with the leftmost pixel in the high nibble
+                int pixel = (tile * tileSize * tileSize) + (y * tileSize) + x;
+                uint8_t index = tileIndex(tile, x, y, levels);
+
+                rgbTiles[pixel] = rgb24(index, (tile * 60) + y, 255 - x);
+                if (format == tileFormat8bpp)
+                    indexedTiles[pixel] = index;
+                else
+                    indexedTiles[pixel / 2] |= (pixel & 1) ? index : index << 4;
+            }
+        }
+    }
+}
+
+template <typename LAYER>
+static void drawReference(LAYER &tileLayer, tileFormats format, int tileSize, int mapWidth, int mapHeight) {
+    int width = matrix.getScreenWidth();
+    int height = matrix.getScreenHeight();
+    int canvasWidth = mapWidth * tileSize;
+    int canvasHeight = mapHeight * tileSize;
+
+    backgroundLayer.fillScreen(marker);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int canvasX = ((tileLayer.getScrollX() + x) % canvasWidth + canvasWidth) % canvasWidth;
+            int canvasY = ((tileLayer.getScrollY() + y) % canvasHeight + canvasHeight) % canvasHeight;
+            int tile = tileLayer.getTile(canvasX / tileSize, canvasY / tileSize);
+            int tileX = canvasX % tileSize, tileY = canvasY % tileSize;
+
+            if (format == tileFormatRGB) {
+                backgroundLayer.drawPixel(x, y, rgbTiles[(tile * tileSize * tileSize) + (tileY * tileSize) + tileX]);
+            } else {
+                uint8_t index = tileIndex(tile, tileX, tileY, (format == tileFormat4bpp) ? 16 : 256);
+                if (index)
+                    backgroundLayer.drawPixel(x, y, palette[index]);
+            }
+        }
+    }
+    backgroundLayer.swapBuffers(true);
+}
+
+template <typename LAYER, typename RGB_OUT>
+static bool sameRows(LAYER &tileLayer) {
+    RGB_OUT expected[WIDTH], row[WIDTH];
+
+    for (int y = 0; y < HEIGHT; y++) {
+        backgroundLayer.fillRefreshRow(y, expected);
+        for (int x = 0; x < WIDTH; x++)
+            row[x] = marker;
+        tileLayer.fillRefreshRow(y, row);
+        if (memcmp((uint8_t *)row, (uint8_t *)expected, sizeof(row)))
+            return false;
+    }
+    return true;
+}
+
+template <typename LAYER>
+static void checkLayer(LAYER &tileLayer, int tileSize, int mapWidth, int mapHeight) {
+    static const tileFormats formats[] = { tileFormat4bpp, tileFormat8bpp, tileFormatRGB };
+    static const char * formatNames[] = { "4bpp", "8bpp", "rgb" };
+
+    tileLayer.enableColorCorrection(false);
+    for (int y = 0; y < mapHeight; y++) {
+        for (int x = 0; x < mapWidth; x++)
+            tileLayer.setTile(x, y, randomNumber(NUM_TILES));
+    }
+
+    for (int f = 0; f < 3; f++) {
+        makeTiles(formats[f], tileSize);
+        tileLayer.setTiles(formats[f], (formats[f] == tileFormatRGB) ? (const void *)rgbTiles : indexedTiles, palette);
+
+        for (int rotation = 0; rotation < 4; rotation++) {
+            matrix.setRotation((rotationDegrees)rotation);
+
+            // the first position is the origin, the rest anywhere including far outside the canvas both ways
+            for (int scroll = 0; scroll < SCROLLS; scroll++) {
+                int32_t x = scroll ? randomNumber(1000) - 500 : 0;
+                int32_t y = scroll ? randomNumber(1000) - 500 : 0;
+
+                tileLayer.setScroll(x, y);
+                nextFrame();
+                drawReference(tileLayer, formats[f], tileSize, mapWidth, mapHeight);
+
+                if (!sameRows<LAYER, rgb24>(tileLayer) || !sameRows<LAYER, rgb48>(tileLayer)) {
+                    printf("tiles: FAILED %d pixel %s tiles, rotation %d, scroll %d, %d\n", tileSize, formatNames[f],
+                        rotation * 90, (int)x, (int)y);
+                    failures++;
+                }
+            }
+        }
+    }
+}
+
+int main(void) {
+    matrix.addLayer(&backgroundLayer);
+    matrix.addLayer(&smallTileLayer);
+    matrix.addLayer(&largeTileLayer);
+    matrix.begin();
+    backgroundLayer.enableColorCorrection(false);
+
+    for (int i = 0; i < 256; i++)
+        palette[i] = rgb24(i, (i * 5) + 1, 255 - i);
+
+    checkLayer(smallTileLayer, 8, 5, 3);
+    checkLayer(largeTileLayer, 16, 6, 4);
+
+    if (failures)
+        return 1;
+    printf("tiles: ok\n");
+    return 0;
+}
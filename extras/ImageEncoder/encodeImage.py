@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+#
+# SmartMatrix Library - Compressed Image Encoder
+#
+# Converts a GIMP "C source" image dump (like the Bitmaps example images), or any image Pillow can open, into the
+# run length encoded format read by SMCompressedImage and SMLayerBackground::drawCompressedImage(), see
+# src/MatrixCompressedImage.h for the format.  Writes a C file with the image as a const uint8_t array.
+#
+# usage: encodeImage.py input.c|input.png [-o output.c] [-n name] [--no-palette | --palette]
+
+import argparse
+import ast
+import os
+import re
+import sys
+
+RUN = 0x80
+MAX_COUNT = 128
+
+
+def read_gimp_source(path):
+    text = open(path).read()
+    size = re.search(r'\w+\s*=\s*{\s*(\d+)\s*,\s*(\d+)\s*,\s*(\d+)\s*,', text)
+    if not size:
+        raise ValueError('%s is not a GIMP C source image' % path)
+    width, height, bytesPerPixel = (int(v) for v in size.groups())
+    if bytesPerPixel != 3:
+        raise ValueError('only RGB (3 bytes per pixel) GIMP images are supported')
+
+    # the pixel data is a run of C string literals after the size
+    data = b''
+    for literal in re.findall(r'"((?:[^"\\]|\\.)*)"', text[size.end():]):
+        data += ast.literal_eval('b"' + literal + '"')
+
+    return width, height, [tuple(data[i:i + 3]) for i in range(0, width * height * 3, 3)]
+
+
+def read_image(path):
+    from PIL import Image
+    image = Image.open(path).convert('RGB')
+    return image.width, image.height, list(image.getdata())
+
+
+def encode_packets(values, threshold):
+    # values repeated at least threshold times become runs, everything else is stored in literal packets
+    packets = []
+    literal = []
+    i = 0
+
+    def flush():
+        while literal:
+            part = literal[:MAX_COUNT]
+            del literal[:MAX_COUNT]
+            packets.append(bytes([len(part) - 1]) + b''.join(part))
+
+    while i < len(values):
+        count = 1
+        while i + count < len(values) and count < MAX_COUNT and values[i + count] == values[i]:
+            count += 1
+
+        if count >= threshold:
+            flush()
+            packets.append(bytes([RUN | (count - 1)]) + values[i])
+        else:
+            literal.extend(values[i:i + count])
+        i += count
+
+    flush()
+    return b''.join(packets)
+
+
+def encode(width, height, pixels, usePalette, forcePalette=False):
+    header = width.to_bytes(2, 'little') + height.to_bytes(2, 'little')
+    data = b'SM' + bytes([0x00]) + header + encode_packets([bytes(color) for color in pixels], 2)
+
+    # a palette only helps if it costs less than it saves, unless it's forced
+    colors = sorted(set(pixels))
+    if usePalette and len(colors) <= 256:
+        lookup = dict((color, i) for i, color in enumerate(colors))
+        palette = bytes([len(colors) - 1]) + b''.join(bytes(color) for color in colors)
+        # a two pixel run costs as much as the literal it replaces plus the literal it splits
+        indexed = b'SM' + bytes([0x01]) + header + palette + encode_packets([bytes([lookup[color]]) for color in pixels], 3)
+        if forcePalette or len(indexed) < len(data):
+            data = indexed
+
+    return data
+
+
+def write_source(path, name, width, height, data):
+    with open(path, 'w') as out:
+        out.write('// %s: %dx%d image, %d bytes compressed from %d, draw with SMCompressedImage(%s, sizeof(%s))\n' %
+            (name, width, height, len(data), width * height * 3, name, name))
+        out.write('const uint8_t %s[%d] = {\n' % (name, len(data)))
+        for i in range(0, len(data), 16):
+            out.write('    ' + ' '.join('0x%02x,' % b for b in data[i:i + 16]) + '\n')
+        out.write('};\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Encode an image for SMLayerBackground::drawCompressedImage()')
+    parser.add_argument('input', help='GIMP C source image (.c), or an image file if Pillow is installed')
+    parser.add_argument('-o', '--output', help='C file to write, defaults to the input name with _smi.c')
+    parser.add_argument('-n', '--name', help='array name, defaults to the input file name')
+    palette = parser.add_mutually_exclusive_group()
+    palette.add_argument('--no-palette', action='store_true', help='store colors even if a palette would be smaller')
+    palette.add_argument('--palette', action='store_true', help='use a palette if there are 256 colors or fewer, even if '
+        'storing colors would be smaller')
+    args = parser.parse_args()
+
+    base = os.path.splitext(args.input)[0]
+    name = args.name or re.sub(r'\W', '_', os.path.basename(base)) + '_smi'
+    output = args.output or base + '_smi.c'
+
+    if args.input.endswith('.c'):
+        width, height, pixels = read_gimp_source(args.input)
+    else:
+        width, height, pixels = read_image(args.input)
+
+    data = encode(width, height, pixels, not args.no_palette, args.palette)
+    write_source(output, name, width, height, data)
+    print('%s: %dx%d, %d bytes (%.1f%% of %d raw)' % (output, width, height, len(data),
+        100.0 * len(data) / (width * height * 3), width * height * 3))
+
+
+if __name__ == '__main__':
+    sys.exit(main())
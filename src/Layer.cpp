@@ -21,6 +21,7 @@
  * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdlib.h>
 #include "Layer.h"
 
 void SM_Layer::setRotation(rotationDegrees newrotation) {
@@ -33,8 +34,292 @@ void SM_Layer::setRotation(rotationDegrees newrotation) {
         localWidth = matrixHeight;
         localHeight = matrixWidth;
     }
+
+    if (rotation == rotation0) {
+        hardwareOrigin = 0;
+        hardwareStrideX = 1;
+        hardwareStrideY = matrixWidth;
+        localOrigin = 0;
+        localStrideX = 1;
+        localStrideY = localWidth;
+    } else if (rotation == rotation180) {
+        hardwareOrigin = (matrixHeight * matrixWidth) - 1;
+        hardwareStrideX = -1;
+        hardwareStrideY = -matrixWidth;
+        localOrigin = (matrixHeight * matrixWidth) - 1;
+        localStrideX = -1;
+        localStrideY = -localWidth;
+    } else if (rotation == rotation90) {
+        // localX runs down the hardware rows, localY runs right to left
+        hardwareOrigin = matrixWidth - 1;
+        hardwareStrideX = matrixWidth;
+        hardwareStrideY = -1;
+        localOrigin = (matrixWidth - 1) * localWidth;
+        localStrideX = -localWidth;
+        localStrideY = 1;
+    } else { /* if (rotation == rotation270)*/
+        // localX runs up the hardware rows, localY runs left to right
+        hardwareOrigin = (matrixHeight - 1) * matrixWidth;
+        hardwareStrideX = -matrixWidth;
+        hardwareStrideY = 1;
+        localOrigin = matrixHeight - 1;
+        localStrideX = localWidth;
+        localStrideY = -1;
+    }
+}
+
+// defaults for a layer that draws nothing, every layer type overrides these
+void SM_Layer::frameRefreshCallback(void) {
+}
+
+void SM_Layer::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]) {
+}
+
+void SM_Layer::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]) {
 }
 
 void SM_Layer::setRefreshRate(uint8_t newRefreshRate) {
     refreshRate = newRefreshRate;
 }
+
+void SM_Layer::setRefreshDepth(uint8_t newRefreshDepth) {
+    refreshDepth = newRefreshDepth;
+}
+
+void SM_Layer::setOpacity(uint8_t newOpacity) {
+    opacity = newOpacity;
+    dirtyRows = SM_ALL_ROWS_DIRTY;
+}
+
+void SM_Layer::setBlendMode(blendModes newBlendMode) {
+    blendMode = newBlendMode;
+    dirtyRows = SM_ALL_ROWS_DIRTY;
+}
+
+uint8_t SM_Layer::getOpacity(void) {
+    return opacity;
+}
+
+blendModes SM_Layer::getBlendMode(void) {
+    return blendMode;
+}
+
+uint32_t SM_Layer::getDirtyRows(void) {
+    return SM_ALL_ROWS_DIRTY;
+}
+
+// algorithm from http://www.netgraphics.sk/bresenham-algorithm-for-a-line, lines are drawn from left to right,
+// and steep lines from the top point, stepping along the major axis from major0 to major1
+// pixel i is at major0 + i, minor0 + minorStep * k, where k is the number of times the error term has gone negative:
+// the smallest k >= 0 with (major1 - major0) - (i * dMinor) + (k * dMajor) >= 0
+// both coordinates only move one way, so the visible pixels are a single range of i, which is found without stepping
+bool SM_Layer::clipLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, clippedLine & line) {
+    int32_t major0, minor0, major1, minor1;
+
+    // if point x0, y0 is on the right side of point x1, y1, change them
+    if (x0 > x1) {
+        int16_t temp;
+        temp = x0; x0 = x1; x1 = temp;
+        temp = y0; y0 = y1; y1 = temp;
+    }
+
+    // check for line completely outside the bounding box of the layer
+    if (x1 < 0 || x0 >= localWidth || (y0 < 0 && y1 < 0) || (y0 >= localHeight && y1 >= localHeight))
+        return false;
+
+    // line and y axis angle is less then 45 degrees, so y is guiding, from the top point
+    line.steep = abs(y1 - y0) > abs(x1 - x0);
+    if (!line.steep) {
+        major0 = x0; minor0 = y0; major1 = x1; minor1 = y1;
+    } else if (y0 > y1) {
+        major0 = y1; minor0 = x1; major1 = y0; minor1 = x0;
+    } else {
+        major0 = y0; minor0 = x0; major1 = y1; minor1 = x1;
+    }
+
+    int32_t steps = major1 - major0;
+    int32_t sum0 = steps, dMajor = 2 * steps, dMinor = abs(2 * (minor1 - minor0));
+    int minorStep = ((minor1 - minor0) > 0) ? 1 : -1;
+    int32_t majorSize = line.steep ? localHeight : localWidth;
+    int32_t minorSize = line.steep ? localWidth : localHeight;
+
+    // visible range of i along the major axis
+    int32_t first = (major0 < 0) ? -major0 : 0;
+    int32_t last = (steps < majorSize - 1 - major0) ? steps : majorSize - 1 - major0;
+
+    // visible range of k along the minor axis
+    int32_t kLow, kHigh;
+    if (minorStep > 0) {
+        kLow = -minor0;
+        kHigh = minorSize - 1 - minor0;
+    } else {
+        kLow = minor0 - (minorSize - 1);
+        kHigh = minor0;
+    }
+    if (kLow < 0)
+        kLow = 0;
+    if (kHigh < kLow)
+        return false;
+
+    if (!dMinor) {
+        // k is always 0
+        if (kLow > 0)
+            return false;
+    } else {
+        // k >= kLow once (i * dMinor) > ((kLow - 1) * dMajor) + sum0
+        if (kLow > 0) {
+            int32_t iLow = ((((int64_t)(kLow - 1) * dMajor) + sum0) / dMinor) + 1;
+            if (iLow > first)
+                first = iLow;
+        }
+        // k <= kHigh while (i * dMinor) <= (kHigh * dMajor) + sum0
+        int64_t iHigh = (((int64_t)kHigh * dMajor) + sum0) / dMinor;
+        if (iHigh < last)
+            last = iHigh;
+    }
+
+    if (first > last)
+        return false;
+
+    // start the error term at the first visible pixel
+    int32_t k = 0;
+    int64_t overshoot = ((int64_t)first * dMinor) - sum0;
+    if (overshoot > 0)
+        k = (overshoot + dMajor - 1) / dMajor;
+
+    line.minorStep = minorStep;
+    line.major0 = major0 + first;
+    line.minor0 = minor0 + (minorStep * k);
+    line.steps = last - first;
+    line.sum = (int32_t)(((int64_t)k * dMajor) - overshoot);
+    line.dMajor = dMajor;
+    line.dMinor = dMinor;
+    return true;
+}
+
+void SM_Layer::mapHardwareRow(uint16_t hardwareY, int16_t & position, bool & positionIsY, bool & reversed) {
+    if (rotation == rotation0) {
+        position = hardwareY;
+        positionIsY = true;
+        reversed = false;
+    } else if (rotation == rotation180) {
+        position = (matrixHeight - 1) - hardwareY;
+        positionIsY = true;
+        reversed = true;
+    } else if (rotation == rotation90) {
+        position = hardwareY;
+        positionIsY = false;
+        reversed = true;
+    } else {
+        position = (matrixHeight - 1) - hardwareY;
+        positionIsY = false;
+        reversed = false;
+    }
+}
+
+bool SM_Layer::getHardwareRows(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t & firstRow, int16_t & lastRow) {
+    firstRow = 0;
+    lastRow = -1;
+
+    if (x1 < 0 || y1 < 0 || x0 >= localWidth || y0 >= localHeight || x1 < x0 || y1 < y0)
+        return false;
+
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 >= localWidth)
+        x1 = localWidth - 1;
+    if (y1 >= localHeight)
+        y1 = localHeight - 1;
+
+    // opposite corners are on the first and last hardware rows
+    int row0 = (hardwareOrigin + (x0 * hardwareStrideX) + (y0 * hardwareStrideY)) / matrixWidth;
+    int row1 = (hardwareOrigin + (x1 * hardwareStrideX) + (y1 * hardwareStrideY)) / matrixWidth;
+
+    firstRow = (row0 < row1) ? row0 : row1;
+    lastRow = (row0 < row1) ? row1 : row0;
+    return true;
+}
+
+uint32_t SM_Layer::clearDirtyRows(void) {
+    uint32_t rows = dirtyRows;
+    dirtyRows = 0;
+    return rows;
+}
+
+// hardware rows covered by a row in local (rotated) coordinates, with 90/270 rotation a local row crosses every hardware row
+uint32_t SM_Layer::getLocalRowDirtyMask(uint16_t localY) {
+    if (rotation == rotation0)
+        return SM_DIRTY_ROW(localY);
+    else if (rotation == rotation180)
+        return SM_DIRTY_ROW((matrixHeight - 1) - localY);
+    else
+        return SM_ALL_ROWS_DIRTY;
+}
+
+// sets up to 8 pixels starting at dst, moving step pixels for each bit of coverage from MSB to LSB
+template <typename RGB_OUT>
+static inline void fillCoverageByte(uint8_t coverage, const RGB_OUT & color, RGB_OUT * dst, int step) {
+    int i;
+
+    if (!coverage)
+        return;
+
+    if (coverage == 0xFF) {
+        for (i = 0; i < 8; i++)
+            dst[i * step] = color;
+        return;
+    }
+
+    for (i = 0; coverage; i++, coverage <<= 1) {
+        if (coverage & 0x80)
+            dst[i * step] = color;
+    }
+}
+
+template <typename RGB_OUT>
+void SM_Layer::fillRefreshRowFromBitmapImpl(const uint8_t bitmap[], uint16_t hardwareY, const RGB_OUT & color, RGB_OUT refreshRow[]) {
+    // local pixel shown at hardwareX = 0
+    int32_t firstPixel = localOrigin + (hardwareY * localStrideY);
+    const uint8_t * src;
+    int i, j;
+
+    if (localStrideX == 1 || localStrideX == -1) {
+        // a bitmap row is a hardware row: each bitmap byte is the coverage for 8 pixels, filled right to left if the row is reversed
+        RGB_OUT * dst = refreshRow;
+        int step = localStrideX;
+
+        if (step < 0) {
+            firstPixel -= matrixWidth - 1;
+            dst = &refreshRow[matrixWidth - 1];
+        }
+        src = &bitmap[firstPixel / 8];
+
+        for (i = 0; i < matrixWidth; i += 8, dst += 8 * step)
+            fillCoverageByte(*src++, color, dst, step);
+    } else {
+        // a bitmap column is a hardware row: gather a byte of coverage from the same bit in 8 bitmap rows
+        int srcStride = localStrideX / 8;
+        uint8_t bitmask = 0x80 >> (firstPixel % 8);
+
+        src = &bitmap[firstPixel / 8];
+
+        for (i = 0; i < matrixWidth; i += 8) {
+            uint8_t coverage = 0;
+            for (j = 0; j < 8; j++, src += srcStride) {
+                if (*src & bitmask)
+                    coverage |= 0x80 >> j;
+            }
+            fillCoverageByte(coverage, color, &refreshRow[i], 1);
+        }
+    }
+}
+
+void SM_Layer::fillRefreshRowFromBitmap(const uint8_t bitmap[], uint16_t hardwareY, const rgb48 & color, rgb48 refreshRow[]) {
+    fillRefreshRowFromBitmapImpl(bitmap, hardwareY, color, refreshRow);
+}
+
+void SM_Layer::fillRefreshRowFromBitmap(const uint8_t bitmap[], uint16_t hardwareY, const rgb24 & color, rgb24 refreshRow[]) {
+    fillRefreshRowFromBitmapImpl(bitmap, hardwareY, color, refreshRow);
+}
@@ -26,26 +26,98 @@
 
 #include "MatrixCommon.h"
 
+// dirty rows are tracked as a mask of hardware rows modulo 32, rows that share a bit are refreshed together
+#define SM_DIRTY_ROW(hardwareY)     ((uint32_t)1 << ((hardwareY) % 32))
+#define SM_ALL_ROWS_DIRTY           0xFFFFFFFF
+
+// body of loops that wait for the refresh ISRs to clear a flag, the host build (MatrixHost.h) advances the simulated refresh here
+#ifndef SM_WAIT_FOR_REFRESH
+#define SM_WAIT_FOR_REFRESH()
+#endif
+
+// the pixels of a drawLine() line that are inside the layer, see SM_Layer::clipLine()
+// pixels step one at a time along the major axis (local x, or local y if steep), the minor axis moves minorStep (+/-1)
+// each time the error term goes negative: sum -= dMinor every step, and when sum < 0, sum += dMajor
+typedef struct clippedLine {
+    bool steep;
+    int8_t minorStep;
+    // first visible pixel, and the number of visible pixels after it
+    int16_t major0, minor0;
+    int16_t steps;
+    // error term at the first visible pixel
+    int32_t sum;
+    int32_t dMajor, dMinor;
+} clippedLine;
+
 class SM_Layer {
     public:
         virtual void frameRefreshCallback();
 
         // fills refreshRow with matrixWidth values - hardwareY is < matrixHeight, not localHeight
+        // only the pixels the layer draws are written, the rest are left as they are (transparent)
+        // must not change the layer's state: a translucent or non-normal blend mode layer is filled twice per row
+        // (into a cleared row and a set row) so the pixels it draws can be told apart from the ones it leaves
         virtual void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]);
         virtual void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]);
 
         void setRotation(rotationDegrees newrotation);
         virtual void setRefreshRate(uint8_t newRefreshRate);
+        // set by addLayer(), bits per pixel the matrix refreshes with (24, 36, or 48)
+        void setRefreshDepth(uint8_t newRefreshDepth);
+
+        // applied when the layer is composited onto the layers below it, default is opaque normal blending
+        void setOpacity(uint8_t newOpacity);
+        void setBlendMode(blendModes newBlendMode);
+        uint8_t getOpacity(void);
+        blendModes getBlendMode(void);
+
+        // returns SM_DIRTY_ROW() bits for hardware rows that changed since the last call, and clears them
+        // layers that don't track changes always return SM_ALL_ROWS_DIRTY
+        virtual uint32_t getDirtyRows(void);
 
         SM_Layer * nextLayer;
 
     protected:
+        // for layers stored as a 1-bit bitmap in local coordinates (MSB is leftmost pixel, localWidth/8 bytes per row):
+        // sets pixels in refreshRow to color where the bitmap has a bit set, working through a byte of coverage at a time
+        void fillRefreshRowFromBitmap(const uint8_t bitmap[], uint16_t hardwareY, const rgb48 & color, rgb48 refreshRow[]);
+        void fillRefreshRowFromBitmap(const uint8_t bitmap[], uint16_t hardwareY, const rgb24 & color, rgb24 refreshRow[]);
+
+        // Bresenham line from x0, y0 to x1, y1 clipped to localWidth x localHeight, returns false if no pixels are visible
+        // the visible pixels are the same ones a pixel by pixel line would draw, with the same error term
+        bool clipLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, clippedLine & line);
+
+        // the local row (or column with 90/270 rotation) shown on hardware row hardwareY: position is its local y (or x),
+        // local x (or y) runs along the hardware row from hardwareX = 0, or from hardwareX = matrixWidth - 1 if reversed
+        void mapHardwareRow(uint16_t hardwareY, int16_t & position, bool & positionIsY, bool & reversed);
+
+        // hardware rows covered by the local rectangle x0, y0 to x1, y1 (x0 <= x1, y0 <= y1) after clipping it to the layer,
+        // returns false with lastRow < firstRow if it's not on the layer
+        bool getHardwareRows(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t & firstRow, int16_t & lastRow);
+
+        uint32_t clearDirtyRows(void);
+        uint32_t getLocalRowDirtyMask(uint16_t localY);
+
+        volatile uint32_t dirtyRows = 0;
+
+        uint8_t opacity = 255;
+        blendModes blendMode = blendNormal;
+
         rotationDegrees rotation;
         uint16_t matrixWidth, matrixHeight;
         uint16_t localWidth, localHeight;
+
+        // set by setRotation() so rotation isn't resolved for every pixel
+        // hardware pixel index (hardwareY * matrixWidth + hardwareX) = hardwareOrigin + localX * hardwareStrideX + localY * hardwareStrideY
+        int32_t hardwareOrigin, hardwareStrideX, hardwareStrideY;
+        // local pixel index (localY * localWidth + localX) = localOrigin + hardwareX * localStrideX + hardwareY * localStrideY
+        int32_t localOrigin, localStrideX, localStrideY;
         uint8_t refreshRate;
+        uint8_t refreshDepth = 48;
         
     private:
+        template <typename RGB_OUT>
+        void fillRefreshRowFromBitmapImpl(const uint8_t bitmap[], uint16_t hardwareY, const RGB_OUT & color, RGB_OUT refreshRow[]);
 };
 
 #endif
@@ -27,9 +27,18 @@
 #include "Layer.h"
 #include "MatrixCommon.h"
 #include "MatrixFontCommon.h"
+#include "MatrixGlyphRun.h"
+#include "MatrixColorPipeline.h"
+#include "MatrixDamageRegion.h"
+#include "MatrixCompressedImage.h"
 
 #define SM_BACKGROUND_OPTIONS_NONE     0
 
+// a third buffer lets the sketch keep drawing while a finished frame waits for the next refresh frame
+#define SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER     (1 << 0)
+
+#define SM_BACKGROUND_BUFFER_COUNT(options)     (((options) & SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER) ? 3 : 2)
+
 template <typename RGB, unsigned int optionFlags>
 class SMLayerBackground : public SM_Layer {
     public:
@@ -37,9 +46,19 @@ class SMLayerBackground : public SM_Layer {
         void frameRefreshCallback();
         void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]);
         void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]);
+        uint32_t getDirtyRows(void);
 
         void swapBuffers(bool copy = true);
         bool isSwapPending();
+        // non-blocking swap: with triple buffering always queues the frame, replacing (and counting as dropped)
+        //   a queued frame that was never shown, otherwise returns false if the previous swap is still pending
+        bool trySwap(void);
+        // pointer to a buffer that is free to draw into, or NULL if there is none until the pending swap completes
+        RGB *acquireBackBuffer(void);
+        uint32_t getDroppedFrames(void);
+        // area of the drawing buffer in hardware (unrotated) coordinates that may differ from the last finished frame,
+        //   what changes on screen at the next swap, and all that swapBuffers(true) and copyRefreshToDrawing() copy
+        const SMDamageRegion & getDamageRegion(void);
         void copyRefreshToDrawing(void);
         void drawPixel(int16_t x, int16_t y, const RGB& color);
         void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
@@ -64,7 +83,27 @@ class SMLayerBackground : public SM_Layer {
         void drawChar(int16_t x, int16_t y, const RGB& charColor, char character);
         void drawString(int16_t x, int16_t y, const RGB& charColor, const char text[]);
         void drawString(int16_t x, int16_t y, const RGB& charColor, const RGB& backColor, const char text[]);
+        void drawGlyphRun(int16_t x, int16_t y, const RGB& charColor, const SMGlyphRun &run);
         void drawMonoBitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, const RGB& bitmapColor, const uint8_t *bitmap);
+        // draws the width x height area at bitmapX, bitmapY of a bitmap bitmapWidth pixels wide with its top left at x, y
+        //   the area is clipped to the layer once and copied a row at a time, and must be inside the bitmap
+        // pixels matching colorKey are skipped, rgb565 pixels have red in the top 5 bits and blue in the bottom 5 bits
+        void drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const rgb24 *bitmap, uint16_t bitmapWidth,
+            uint16_t bitmapX = 0, uint16_t bitmapY = 0);
+        void drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const rgb24 *bitmap, uint16_t bitmapWidth,
+            uint16_t bitmapX, uint16_t bitmapY, const rgb24 &colorKey);
+        void drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const rgb48 *bitmap, uint16_t bitmapWidth,
+            uint16_t bitmapX = 0, uint16_t bitmapY = 0);
+        void drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height, const rgb48 *bitmap, uint16_t bitmapWidth,
+            uint16_t bitmapX, uint16_t bitmapY, const rgb48 &colorKey);
+        void drawBitmap565(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint16_t *bitmap, uint16_t bitmapWidth,
+            uint16_t bitmapX = 0, uint16_t bitmapY = 0);
+        void drawBitmap565(int16_t x, int16_t y, uint16_t width, uint16_t height, const uint16_t *bitmap, uint16_t bitmapWidth,
+            uint16_t bitmapX, uint16_t bitmapY, uint16_t colorKey);
+        // decodes the image in one pass straight into the drawing buffer with its top left at x, y, clipped to the layer
+        //   returns false if it isn't a valid image, or if the packets run past the end of it or use an index past the palette,
+        //   pixels decoded before the bad data are left drawn
+        bool drawCompressedImage(int16_t x, int16_t y, const SMCompressedImage &image);
 
         // reads pixel from drawing buffer, not refresh buffer
         const RGB readPixel(int16_t x, int16_t y);
@@ -76,35 +115,71 @@ class SMLayerBackground : public SM_Layer {
 
         void setFont(fontChoices newFont);
         void setBrightness(uint8_t brightness);
+        // color that full white is shown as, to balance panels with uneven channels (applied with color correction)
+        void setWhitePoint(const rgb24 & whitePoint);
         void enableColorCorrection(bool enabled);
+        void enableProportionalText(bool enabled);
 
     private:
         bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+        bool proportionalText = false;
 
         RGB *currentDrawBufferPtr;
         RGB *currentRefreshBufferPtr;
 
         RGB *backgroundBuffer;
 
+        // hardware rows where the drawing and refresh buffers may differ, these change on screen at the next swap
+        uint32_t drawnRows = 0;
+        // the same area in pixels (hardware coordinates), only this is copied between buffers
+        SMDamageRegion drawnRegion;
+
         RGB *getCurrentRefreshRow(uint16_t y);
 
+        void copyRows(RGB *dest, const RGB *source, uint32_t rowMask);
+        void copyRegion(RGB *dest, const RGB *source, const SMDamageRegion &region);
+        void damageRows(uint32_t rowMask);
+        void damageAll(void);
+        void damageArea(int32_t index0, int32_t index1);
+        void damageBox(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+
         void getBackgroundRefreshPixel(uint16_t x, uint16_t y, RGB &refreshPixel);
         bool getForegroundRefreshPixel(uint16_t x, uint16_t y, RGB &xyPixel);
 
         // drawing functions not meant for user
-        void drawHardwareHLine(uint16_t x0, uint16_t x1, uint16_t y, const RGB& color);
-        void drawHardwareVLine(uint16_t x, uint16_t y0, uint16_t y1, const RGB& color);
-        void bresteepline(int16_t x3, int16_t y3, int16_t x4, int16_t y4, const RGB& color);
+        void drawHardwareSpan(int32_t index, int32_t stride, uint16_t count, const RGB& color);
+        bool isOffLayer(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+        bool isOnLayer(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+        void drawOutlinePixel(int16_t x, int16_t y, int32_t index, bool clip, const RGB& color);
+        template <typename SRC>
+        void drawBitmapImpl(int16_t x, int16_t y, uint16_t width, uint16_t height, const SRC *bitmap, uint16_t bitmapWidth,
+            uint16_t bitmapX, uint16_t bitmapY, const SRC *colorKey);
+        static void loadBitmapPixel(RGB &pixel, const rgb24 &source);
+        static void loadBitmapPixel(RGB &pixel, const rgb48 &source);
+        static void loadBitmapPixel(RGB &pixel, const uint16_t &source);
+        static bool isColorKey(const rgb24 &source, const rgb24 *colorKey);
+        static bool isColorKey(const rgb48 &source, const rgb48 *colorKey);
+        static bool isColorKey(const uint16_t &source, const uint16_t *colorKey);
         void fillFlatSideTriangleInt(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, const RGB& color);
         // todo: move somewhere else
         static bool getBitmapPixelAtXY(uint8_t x, uint8_t y, uint8_t width, uint8_t height, const uint8_t *bitmap);
 
-        uint8_t backgroundBrightness = 255;
+        // gamma, brightness, and white point for color corrected refresh, tables rebuilt only after a change
+        SMColorPipeline colorPipeline;
+
+        static const bool tripleBuffer = (optionFlags & SM_BACKGROUND_OPTIONS_TRIPLE_BUFFER);
 
         // keeping track of drawing buffers
         static unsigned char currentDrawBuffer;
         static unsigned char currentRefreshBuffer;
+        // with triple buffering, holds either the newest finished frame (swapPending set) or a free buffer
+        static unsigned char spareBuffer;
         static volatile bool swapPending;
+        // triple buffering: the buffer holding the frame most recently passed to trySwap()
+        static unsigned char lastFinishedBuffer;
+        // triple buffering: rows where each buffer may differ from the newest finished frame
+        static uint32_t bufferStaleRows[3];
+        static volatile uint32_t droppedFrames;
         static bool swapWithCopy;
         void handleBufferSwap(void);
 };
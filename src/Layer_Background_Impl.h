@@ -23,14 +23,20 @@
 
 #include <stdlib.h>     
 
-static color_chan_t backgroundColorCorrectionLUT[256];
-
 template <typename RGB, unsigned int optionFlags>
 unsigned char SMLayerBackground<RGB, optionFlags>::currentDrawBuffer = 0;
 template <typename RGB, unsigned int optionFlags>
 unsigned char SMLayerBackground<RGB, optionFlags>::currentRefreshBuffer = 1;
 template <typename RGB, unsigned int optionFlags>
+unsigned char SMLayerBackground<RGB, optionFlags>::spareBuffer = 2;
+template <typename RGB, unsigned int optionFlags>
 volatile bool SMLayerBackground<RGB, optionFlags>::swapPending = false;
+template <typename RGB, unsigned int optionFlags>
+unsigned char SMLayerBackground<RGB, optionFlags>::lastFinishedBuffer = 1;
+template <typename RGB, unsigned int optionFlags>
+uint32_t SMLayerBackground<RGB, optionFlags>::bufferStaleRows[3];
+template <typename RGB, unsigned int optionFlags>
+volatile uint32_t SMLayerBackground<RGB, optionFlags>::droppedFrames = 0;
 static bitmap_font *font = (bitmap_font *) &apple3x5;
 
 
@@ -48,7 +54,14 @@ template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::frameRefreshCallback(void) {
     handleBufferSwap();
 
-    calculateBackgroundLUT(backgroundColorCorrectionLUT, backgroundBrightness);
+    colorPipeline.setChannelBits(this->refreshDepth / 3);
+    if (colorPipeline.update() && this->ccEnabled)
+        this->dirtyRows = SM_ALL_ROWS_DIRTY;
+}
+
+template <typename RGB, unsigned int optionFlags>
+uint32_t SMLayerBackground<RGB, optionFlags>::getDirtyRows(void) {
+    return this->clearDirtyRows();
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -60,9 +73,7 @@ void SMLayerBackground<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb
         for(i=0; i<this->matrixWidth; i++) {
             currentPixel = currentRefreshBufferPtr[(hardwareY * this->matrixWidth) + i];
             // load background pixel with color correction
-            refreshRow[i] = rgb48(backgroundColorCorrectionLUT[currentPixel.red],
-                backgroundColorCorrectionLUT[currentPixel.green],
-                backgroundColorCorrectionLUT[currentPixel.blue]);
+            colorPipeline.correct(currentPixel, refreshRow[i]);
         }
     } else {
         for(i=0; i<this->matrixWidth; i++) {
@@ -82,9 +93,7 @@ void SMLayerBackground<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb
         for(i=0; i<this->matrixWidth; i++) {
             currentPixel = currentRefreshBufferPtr[(hardwareY * this->matrixWidth) + i];
             // load background pixel with color correction
-            refreshRow[i] = rgb48(backgroundColorCorrectionLUT[currentPixel.red],
-                backgroundColorCorrectionLUT[currentPixel.green],
-                backgroundColorCorrectionLUT[currentPixel.blue]);
+            colorPipeline.correct(currentPixel, refreshRow[i]);
         }
     } else {
         for(i=0; i<this->matrixWidth; i++) {
@@ -100,28 +109,18 @@ extern volatile int framesInterpolated;
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, const RGB& color) {
-    int hwx, hwy;
-
     // check for out of bounds coordinates
     if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
         return;
 
     // map pixel into hardware buffer before writing
-    if (this->rotation == rotation0) {
-        hwx = x;
-        hwy = y;
-    } else if (this->rotation == rotation180) {
-        hwx = (this->matrixWidth - 1) - x;
-        hwy = (this->matrixHeight - 1) - y;
-    } else if (this->rotation == rotation90) {
-        hwx = (this->matrixWidth - 1) - y;
-        hwy = x;
-    } else { /* if (rotation == rotation270)*/
-        hwx = y;
-        hwy = (this->matrixHeight - 1) - x;
-    }
+    int32_t index = this->hardwareOrigin + (x * this->hardwareStrideX) + (y * this->hardwareStrideY);
+
+    currentDrawBufferPtr[index] = color;
 
-    currentDrawBufferPtr[(hwy * this->matrixWidth) + hwx] = color;
+    int row = index / this->matrixWidth;
+    drawnRows |= SM_DIRTY_ROW(row);
+    drawnRegion.addPixel(index - (row * this->matrixWidth), row);
 }
 
 #define SWAPint(X,Y) { \
@@ -130,23 +129,38 @@ void SMLayerBackground<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, const
         Y = temp ; \
     }
 
-// x0, x1, and y must be in bounds (0-this->localWidth/Height-1), x1 > x0
+// sets count pixels starting at hardware pixel index, moving stride pixels each step (a hardwareStrideX/Y value)
+// all pixels must be in bounds
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::drawHardwareHLine(uint16_t x0, uint16_t x1, uint16_t y, const RGB& color) {
+void SMLayerBackground<RGB, optionFlags>::drawHardwareSpan(int32_t index, int32_t stride, uint16_t count, const RGB& color) {
     int i;
+    int row = index / this->matrixWidth;
+    int column = index - (row * this->matrixWidth);
 
-    for (i = x0; i <= x1; i++) {
-        currentDrawBufferPtr[(y * this->matrixWidth) + i] = color;
+    if (stride == 1 || stride == -1) {
+        // span along a hardware row
+        drawnRows |= SM_DIRTY_ROW(row);
+        drawnRegion.add(column, row, column + (stride * (count - 1)), row);
+    } else {
+        // span down a hardware column
+        int rowStep = stride / this->matrixWidth;
+        drawnRegion.add(column, row, column, row + (rowStep * (count - 1)));
+        for (i = 0; i < count; i++, row += rowStep)
+            drawnRows |= SM_DIRTY_ROW(row);
     }
-}
 
-// x, y0, and y1 must be in bounds (0-this->localWidth/Height-1), y1 > y0
-template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::drawHardwareVLine(uint16_t x, uint16_t y0, uint16_t y1, const RGB& color) {
-    int i;
+    // spans along a row are contiguous in the buffer, fill them from the lowest address with word stores
+    if (stride == 1) {
+        fillPixelSpan(&currentDrawBufferPtr[index], count, color);
+        return;
+    }
+    if (stride == -1) {
+        fillPixelSpan(&currentDrawBufferPtr[index - (count - 1)], count, color);
+        return;
+    }
 
-    for (i = y0; i <= y1; i++) {
-        currentDrawBufferPtr[(i * this->matrixWidth) + x] = color;
+    for (i = 0; i < count; i++, index += stride) {
+        currentDrawBufferPtr[index] = color;
     }
 }
 
@@ -167,16 +181,8 @@ void SMLayerBackground<RGB, optionFlags>::drawFastHLine(int16_t x0, int16_t x1,
     if (x1 >= this->localWidth)
         x1 = this->localWidth - 1;
 
-    // map to hardware drawline function
-    if (this->rotation == rotation0) {
-        drawHardwareHLine(x0, x1, y, color);
-    } else if (this->rotation == rotation180) {
-        drawHardwareHLine((this->matrixWidth - 1) - x1, (this->matrixWidth - 1) - x0, (this->matrixHeight - 1) - y, color);
-    } else if (this->rotation == rotation90) {
-        drawHardwareVLine((this->matrixWidth - 1) - y, x0, x1, color);
-    } else { /* if (rotation == rotation270)*/
-        drawHardwareVLine(y, (this->matrixHeight - 1) - x1, (this->matrixHeight - 1) - x0, color);
-    }
+    // walk the hardware buffer from x0 in the direction local x maps to
+    drawHardwareSpan(this->hardwareOrigin + (x0 * this->hardwareStrideX) + (y * this->hardwareStrideY), this->hardwareStrideX, x1 - x0 + 1, color);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -196,93 +202,142 @@ void SMLayerBackground<RGB, optionFlags>::drawFastVLine(int16_t x, int16_t y0, i
     if (y1 >= this->localHeight)
         y1 = this->localHeight - 1;
 
-    // map to hardware drawline function
-    if (this->rotation == rotation0) {
-        drawHardwareVLine(x, y0, y1, color);
-    } else if (this->rotation == rotation180) {
-        drawHardwareVLine((this->matrixWidth - 1) - x, (this->matrixHeight - 1) - y1, (this->matrixHeight - 1) - y0, color);
-    } else if (this->rotation == rotation90) {
-        drawHardwareHLine((this->matrixWidth - 1) - y1, (this->matrixWidth - 1) - y0, x, color);
-    } else { /* if (rotation == rotation270)*/
-        drawHardwareHLine(y0, y1, (this->matrixHeight - 1) - x, color);
-    }
+    // walk the hardware buffer from y0 in the direction local y maps to
+    drawHardwareSpan(this->hardwareOrigin + (x * this->hardwareStrideX) + (y0 * this->hardwareStrideY), this->hardwareStrideY, y1 - y0 + 1, color);
 }
 
+// marks the hardware rectangle with corners at buffer indexes index0 and index1 as drawn
 template <typename RGB, unsigned int optionFlags>
-void SMLayerBackground<RGB, optionFlags>::bresteepline(int16_t x3, int16_t y3, int16_t x4, int16_t y4, const RGB& color) {
-    // if point x3, y3 is on the right side of point x4, y4, change them
-    if ((x3 - x4) > 0) {
-        bresteepline(x4, y4, x3, y3, color);
+void SMLayerBackground<RGB, optionFlags>::damageArea(int32_t index0, int32_t index1) {
+    int hardwareY0 = index0 / this->matrixWidth;
+    int hardwareY1 = index1 / this->matrixWidth;
+    int hardwareX0 = index0 - (hardwareY0 * this->matrixWidth);
+    int hardwareX1 = index1 - (hardwareY1 * this->matrixWidth);
+
+    if (hardwareY0 > hardwareY1)
+        SWAPint(hardwareY0, hardwareY1);
+    if (hardwareX0 > hardwareX1)
+        SWAPint(hardwareX0, hardwareX1);
+
+    drawnRegion.add(hardwareX0, hardwareY0, hardwareX1, hardwareY1);
+
+    if (hardwareY1 - hardwareY0 >= 31) {
+        drawnRows = SM_ALL_ROWS_DIRTY;
         return;
     }
+    for (int i = hardwareY0; i <= hardwareY1; i++)
+        drawnRows |= SM_DIRTY_ROW(i);
+}
 
-    int x = x3, y = y3, sum = x4 - x3,  Dx = 2 * (x4 - x3), Dy = abs(2 * (y4 - y3));
-    int prirastokDy = ((y4 - y3) > 0) ? 1 : -1;
+// marks the part of the local box from x0, y0 to x1, y1 (x0 <= x1, y0 <= y1) that's on the layer as drawn
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::damageBox(int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+    if (isOffLayer(x0, y0, x1, y1))
+        return;
 
-    for (int i = 0; i <= x4 - x3; i++) {
-        drawPixel(y, x, color);
-        x++;
-        sum -= Dy;
-        if (sum < 0) {
-            y = y + prirastokDy;
-            sum += Dx;
-        }
-    }
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 >= this->localWidth)
+        x1 = this->localWidth - 1;
+    if (y1 >= this->localHeight)
+        y1 = this->localHeight - 1;
+
+    damageArea(this->hardwareOrigin + (x0 * this->hardwareStrideX) + (y0 * this->hardwareStrideY),
+        this->hardwareOrigin + (x1 * this->hardwareStrideX) + (y1 * this->hardwareStrideY));
+}
+
+// true if the box from x0, y0 to x1, y1 (x0 <= x1, y0 <= y1) has no pixels on the layer, shapes inside it can be skipped
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerBackground<RGB, optionFlags>::isOffLayer(int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+    return (x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight);
+}
+
+// true if the box from x0, y0 to x1, y1 (x0 <= x1, y0 <= y1) is entirely on the layer, shapes inside it don't need clipping
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerBackground<RGB, optionFlags>::isOnLayer(int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+    return (x0 >= 0 && y0 >= 0 && x1 < this->localWidth && y1 < this->localHeight);
+}
+
+// sets the pixel at local x, y, which is at hardware buffer index, skipped if clip is set and the pixel is off the layer
+// outlines step index with the hardware strides and damage their bounding box once, instead of per pixel like drawPixel()
+template <typename RGB, unsigned int optionFlags>
+inline void SMLayerBackground<RGB, optionFlags>::drawOutlinePixel(int16_t x, int16_t y, int32_t index, bool clip, const RGB& color) {
+    if (clip && (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight))
+        return;
+
+    currentDrawBufferPtr[index] = color;
 }
 
 // algorithm from http://www.netgraphics.sk/bresenham-algorithm-for-a-line
+// clipped to the layer before drawing, so lines mostly off screen cost only the pixels that are visible
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2, const RGB& color) {
-    // if point x1, y1 is on the right side of point x2, y2, change them
-    if ((x1 - x2) > 0) {
-        drawLine(x2, y2, x1, y1, color);
+    clippedLine line;
+
+    if (!this->clipLine(x1, y1, x2, y2, line))
         return;
-    }
-    // test inclination of line
-    // function Math.abs(y) defines absolute value y
-    if (abs(y2 - y1) > abs(x2 - x1)) {
-        // line and y axis angle is less then 45 degrees
-        // thats why go on the next procedure
-        bresteepline(y1, x1, y2, x2, color); return;
-    }
-    // line and x axis angle is less then 45 degrees, so x is guiding
-    // auxiliary variables
-    int x = x1, y = y1, sum = x2 - x1, Dx = 2 * (x2 - x1), Dy = abs(2 * (y2 - y1));
-    int prirastokDy = ((y2 - y1) > 0) ? 1 : -1;
-    // draw line
-    for (int i = 0; i <= x2 - x1; i++) {
-        drawPixel(x, y, color);
-        x++;
-        sum -= Dy;
+
+    int32_t x = line.steep ? line.minor0 : line.major0;
+    int32_t y = line.steep ? line.major0 : line.minor0;
+    int32_t sum = line.sum;
+
+    // rotation is resolved into the strides, the loop only walks the hardware buffer
+    int32_t majorStride = line.steep ? this->hardwareStrideY : this->hardwareStrideX;
+    int32_t minorStride = line.minorStep * (line.steep ? this->hardwareStrideX : this->hardwareStrideY);
+    int32_t index = this->hardwareOrigin + (x * this->hardwareStrideX) + (y * this->hardwareStrideY);
+    int32_t firstIndex = index;
+
+    for (int32_t i = 0; i < line.steps; i++) {
+        currentDrawBufferPtr[index] = color;
+        index += majorStride;
+        sum -= line.dMinor;
         if (sum < 0) {
-            y = y + prirastokDy;
-            sum += Dx;
+            index += minorStride;
+            sum += line.dMajor;
         }
     }
+    currentDrawBufferPtr[index] = color;
+
+    damageArea(firstIndex, index);
 }
 
 // algorithm from http://en.wikipedia.org/wiki/Midpoint_circle_algorithm
+// rotation is resolved into the strides, each octant point is an offset from the center's hardware index
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawCircle(int16_t x0, int16_t y0, uint16_t radius, const RGB& color)
 {
     int a = radius, b = 0;
     int radiusError = 1 - a;
 
+    if (isOffLayer(x0 - radius, y0 - radius, x0 + radius, y0 + radius))
+        return;
+
     if (radius == 0) {
         drawPixel(x0, y0, color);
         return;
     }
 
+    // only circles that cross the edge of the layer need each point checked
+    bool clip = !isOnLayer(x0 - radius, y0 - radius, x0 + radius, y0 + radius);
+    int32_t strideX = this->hardwareStrideX;
+    int32_t strideY = this->hardwareStrideY;
+    int32_t center = this->hardwareOrigin + (x0 * strideX) + (y0 * strideY);
+
     while (a >= b)
     {
-        drawPixel(a + x0, b + y0, color);
-        drawPixel(b + x0, a + y0, color);
-        drawPixel(-a + x0, b + y0, color);
-        drawPixel(-b + x0, a + y0, color);
-        drawPixel(-a + x0, -b + y0, color);
-        drawPixel(-b + x0, -a + y0, color);
-        drawPixel(a + x0, -b + y0, color);
-        drawPixel(b + x0, -a + y0, color);
+        int32_t aX = a * strideX, aY = a * strideY;
+        int32_t bX = b * strideX, bY = b * strideY;
+
+        drawOutlinePixel(a + x0, b + y0, center + aX + bY, clip, color);
+        drawOutlinePixel(b + x0, a + y0, center + bX + aY, clip, color);
+        drawOutlinePixel(-a + x0, b + y0, center - aX + bY, clip, color);
+        drawOutlinePixel(-b + x0, a + y0, center - bX + aY, clip, color);
+        drawOutlinePixel(-a + x0, -b + y0, center - aX - bY, clip, color);
+        drawOutlinePixel(-b + x0, -a + y0, center - bX - aY, clip, color);
+        drawOutlinePixel(a + x0, -b + y0, center + aX - bY, clip, color);
+        drawOutlinePixel(b + x0, -a + y0, center + bX - aY, clip, color);
 
         b++;
         if (radiusError < 0)
@@ -293,6 +348,9 @@ void SMLayerBackground<RGB, optionFlags>::drawCircle(int16_t x0, int16_t y0, uin
             radiusError += 2 * (b - a + 1);
         }
     }
+
+    // every row and column of the bounding box has a point on the circle
+    damageBox(x0 - radius, y0 - radius, x0 + radius, y0 + radius);
 }
 
 // algorithm from drawCircle rearranged with hlines drawn between points on the radius
@@ -302,7 +360,7 @@ void SMLayerBackground<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uin
     int a = radius, b = 0;
     int radiusError = 1 - a;
 
-    if (radius == 0)
+    if (radius == 0 || isOffLayer(x0 - radius, y0 - radius, x0 + radius, y0 + radius))
         return;
 
     // only draw one line per row, skipping the top and bottom
@@ -352,7 +410,7 @@ void SMLayerBackground<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uin
     int a = radius, b = 0;
     int radiusError = 1 - a;
 
-    if (radius == 0)
+    if (radius == 0 || isOffLayer(x0 - radius, y0 - radius, x0 + radius, y0 + radius))
         return;
 
     // only draw one line per row, skipping the top and bottom
@@ -386,22 +444,41 @@ void SMLayerBackground<RGB, optionFlags>::fillCircle(int16_t x0, int16_t y0, uin
 // from https://web.archive.org/web/20120225095359/http://homepage.smc.edu/kennedy_john/belipse.pdf
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawEllipse(int16_t x0, int16_t y0, uint16_t radiusX, uint16_t radiusY, const RGB& color) {
-    int16_t twoASquare = 2 * radiusX * radiusX;
-    int16_t twoBSquare = 2 * radiusY * radiusY;
+    if (isOffLayer(x0 - radiusX, y0 - radiusY, x0 + radiusX, y0 + radiusY))
+        return;
+
+    // a zero radius would never end the stepping below, the ellipse is a straight line
+    if (radiusX == 0 || radiusY == 0) {
+        drawLine(x0 - radiusX, y0 - radiusY, x0 + radiusX, y0 + radiusY, color);
+        return;
+    }
+
+    // only ellipses that cross the edge of the layer need each point checked
+    bool clip = !isOnLayer(x0 - radiusX, y0 - radiusY, x0 + radiusX, y0 + radiusY);
+    int32_t strideX = this->hardwareStrideX;
+    int32_t strideY = this->hardwareStrideY;
+    int32_t center = this->hardwareOrigin + (x0 * strideX) + (y0 * strideY);
+
+    // 32-bit terms, the stopping values reach 2 * radiusX * radiusY^2 and overflowed 16 bits from radii around 26
+    int32_t twoASquare = 2 * radiusX * radiusX;
+    int32_t twoBSquare = 2 * radiusY * radiusY;
     
-    int16_t x = radiusX;
-    int16_t y = 0;
-    int16_t changeX = radiusY * radiusY * (1 - (2 * radiusX));
-    int16_t changeY = radiusX * radiusX;
-    int16_t ellipseError = 0;
-    int16_t stoppingX = twoBSquare * radiusX;
-    int16_t stoppingY = 0;
+    int32_t x = radiusX;
+    int32_t y = 0;
+    int32_t changeX = radiusY * radiusY * (1 - (2 * radiusX));
+    int32_t changeY = radiusX * radiusX;
+    int32_t ellipseError = 0;
+    int32_t stoppingX = twoBSquare * radiusX;
+    int32_t stoppingY = 0;
     
     while (stoppingX >= stoppingY) {    // first set of points, y' > -1
-        drawPixel(x0 + x, y0 + y, color);
-        drawPixel(x0 - x, y0 + y, color);
-        drawPixel(x0 - x, y0 - y, color);
-        drawPixel(x0 + x, y0 - y, color);
+        int32_t xX = x * strideX, xY = x * strideY;
+        int32_t yX = y * strideX, yY = y * strideY;
+
+        drawOutlinePixel(x0 + x, y0 + y, center + xX + yY, clip, color);
+        drawOutlinePixel(x0 - x, y0 + y, center - xX + yY, clip, color);
+        drawOutlinePixel(x0 - x, y0 - y, center - xX - yY, clip, color);
+        drawOutlinePixel(x0 + x, y0 - y, center + xX - yY, clip, color);
         
         y++;
         stoppingY += twoASquare;
@@ -427,10 +504,13 @@ void SMLayerBackground<RGB, optionFlags>::drawEllipse(int16_t x0, int16_t y0, ui
     stoppingY = twoASquare * radiusY;
     
     while (stoppingX <= stoppingY) {    // second set of points, y' < -1
-        drawPixel(x0 + x, y0 + y, color);
-        drawPixel(x0 - x, y0 + y, color);
-        drawPixel(x0 - x, y0 - y, color);
-        drawPixel(x0 + x, y0 - y, color);
+        int32_t xX = x * strideX, xY = x * strideY;
+        int32_t yX = y * strideX, yY = y * strideY;
+
+        drawOutlinePixel(x0 + x, y0 + y, center + xX + yY, clip, color);
+        drawOutlinePixel(x0 - x, y0 + y, center - xX + yY, clip, color);
+        drawOutlinePixel(x0 - x, y0 - y, center - xX - yY, clip, color);
+        drawOutlinePixel(x0 + x, y0 - y, center + xX - yY, clip, color);
         
         x++;
         stoppingX += twoBSquare;
@@ -444,6 +524,9 @@ void SMLayerBackground<RGB, optionFlags>::drawEllipse(int16_t x0, int16_t y0, ui
             changeY += twoASquare;
         }
     }
+
+    // every row and column of the bounding box has a point on the ellipse
+    damageBox(x0 - radiusX, y0 - radiusY, x0 + radiusX, y0 + radiusY);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -461,6 +544,9 @@ void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t
     if (y1 < y0)
         SWAPint(y1, y0);
 
+    if (isOffLayer(x0, y0, x1, y1))
+        return;
+
     // decrease large radius that would break shape
     if(radius > (x1-x0)/2)
         radius = (x1-x0)/2;
@@ -474,6 +560,9 @@ void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t
         fillRectangle(x0, y0, x1, y1, outlineColor, fillColor);
     }
 
+    // only rectangles that cross the edge of the layer need each corner point checked
+    bool clip = !isOnLayer(x0, y0, x1, y1);
+
     // draw straight part of outline
     drawFastHLine(x0 + radius, x1 - radius, y0, outlineColor);
     drawFastHLine(x0 + radius, x1 - radius, y1, outlineColor);
@@ -490,15 +579,26 @@ void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t
     bool hlineDrawn = true;
     bool vlineDrawn = true;
 
+    // rotation is resolved into the strides, corner points are offsets from the hardware index of their corner's center
+    int32_t strideX = this->hardwareStrideX;
+    int32_t strideY = this->hardwareStrideY;
+    int32_t topLeft = this->hardwareOrigin + (x0 * strideX) + (y0 * strideY);
+    int32_t topRight = this->hardwareOrigin + (x1 * strideX) + (y0 * strideY);
+    int32_t bottomLeft = this->hardwareOrigin + (x0 * strideX) + (y1 * strideY);
+    int32_t bottomRight = this->hardwareOrigin + (x1 * strideX) + (y1 * strideY);
+
     while (a >= b)
     {
+        int32_t aX = a * strideX, aY = a * strideY;
+        int32_t bX = b * strideX, bY = b * strideY;
+
         // this pair sweeps from far left towards right
-        drawPixel(-a + x0, -b + y0, outlineColor);
-        drawPixel(-a + x0, b + y1, outlineColor);
+        drawOutlinePixel(-a + x0, -b + y0, topLeft - aX - bY, clip, outlineColor);
+        drawOutlinePixel(-a + x0, b + y1, bottomLeft - aX + bY, clip, outlineColor);
 
         // this pair sweeps from far right towards left
-        drawPixel(a + x1, -b + y0, outlineColor);
-        drawPixel(a + x1, b + y1, outlineColor);
+        drawOutlinePixel(a + x1, -b + y0, topRight + aX - bY, clip, outlineColor);
+        drawOutlinePixel(a + x1, b + y1, bottomRight + aX + bY, clip, outlineColor);
 
         if (!vlineDrawn) {
             drawFastVLine(-a + x0, (-b + 1) + y0, (b - 1) + y1, fillColor);
@@ -507,12 +607,12 @@ void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t
         }
 
         // this pair sweeps from very top towards bottom
-        drawPixel(-b + x0, -a + y0, outlineColor);
-        drawPixel(b + x1, -a + y0, outlineColor);
+        drawOutlinePixel(-b + x0, -a + y0, topLeft - bX - aY, clip, outlineColor);
+        drawOutlinePixel(b + x1, -a + y0, topRight + bX - aY, clip, outlineColor);
 
         // this pair sweeps from bottom up
-        drawPixel(-b + x0, a + y1, outlineColor);
-        drawPixel(b + x1, a + y1, outlineColor);
+        drawOutlinePixel(-b + x0, a + y1, bottomLeft - bX + aY, clip, outlineColor);
+        drawOutlinePixel(b + x1, a + y1, bottomRight + bX + aY, clip, outlineColor);
 
         if (!hlineDrawn) {
             drawFastHLine((-b + 1) + x0, (b - 1) + x1, -a + y0, fillColor);
@@ -533,6 +633,12 @@ void SMLayerBackground<RGB, optionFlags>::fillRoundRectangle(int16_t x0, int16_t
 
     // draw rectangle in center
     fillRectangle(x0 - a, y0 - a, x1 + a, y1 + a, fillColor);
+
+    // the sides and center are damaged as they're drawn, the corner points need their boxes damaged
+    damageBox(x0 - radius, y0 - radius, x0, y0);
+    damageBox(x1, y0 - radius, x1 + radius, y0);
+    damageBox(x0 - radius, y1, x0, y1 + radius);
+    damageBox(x1, y1, x1 + radius, y1 + radius);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -544,6 +650,9 @@ void SMLayerBackground<RGB, optionFlags>::drawRoundRectangle(int16_t x0, int16_t
     if (y1 < y0)
         SWAPint(y1, y0);
 
+    if (isOffLayer(x0, y0, x1, y1))
+        return;
+
     // decrease large radius that would break shape
     if(radius > (x1-x0)/2)
         radius = (x1-x0)/2;
@@ -553,6 +662,9 @@ void SMLayerBackground<RGB, optionFlags>::drawRoundRectangle(int16_t x0, int16_t
     int a = radius, b = 0;
     int radiusError = 1 - a;
 
+    // only rectangles that cross the edge of the layer need each corner point checked
+    bool clip = !isOnLayer(x0, y0, x1, y1);
+
     // draw straight part of outline
     drawFastHLine(x0 + radius, x1 - radius, y0, outlineColor);
     drawFastHLine(x0 + radius, x1 - radius, y1, outlineColor);
@@ -565,23 +677,34 @@ void SMLayerBackground<RGB, optionFlags>::drawRoundRectangle(int16_t x0, int16_t
     y0 += radius;
     y1 -= radius;
 
+    // rotation is resolved into the strides, corner points are offsets from the hardware index of their corner's center
+    int32_t strideX = this->hardwareStrideX;
+    int32_t strideY = this->hardwareStrideY;
+    int32_t topLeft = this->hardwareOrigin + (x0 * strideX) + (y0 * strideY);
+    int32_t topRight = this->hardwareOrigin + (x1 * strideX) + (y0 * strideY);
+    int32_t bottomLeft = this->hardwareOrigin + (x0 * strideX) + (y1 * strideY);
+    int32_t bottomRight = this->hardwareOrigin + (x1 * strideX) + (y1 * strideY);
+
     while (a >= b)
     {
+        int32_t aX = a * strideX, aY = a * strideY;
+        int32_t bX = b * strideX, bY = b * strideY;
+
         // this pair sweeps from far left towards right
-        drawPixel(-a + x0, -b + y0, outlineColor);
-        drawPixel(-a + x0, b + y1, outlineColor);
+        drawOutlinePixel(-a + x0, -b + y0, topLeft - aX - bY, clip, outlineColor);
+        drawOutlinePixel(-a + x0, b + y1, bottomLeft - aX + bY, clip, outlineColor);
 
         // this pair sweeps from far right towards left
-        drawPixel(a + x1, -b + y0, outlineColor);
-        drawPixel(a + x1, b + y1, outlineColor);
+        drawOutlinePixel(a + x1, -b + y0, topRight + aX - bY, clip, outlineColor);
+        drawOutlinePixel(a + x1, b + y1, bottomRight + aX + bY, clip, outlineColor);
 
         // this pair sweeps from very top towards bottom
-        drawPixel(-b + x0, -a + y0, outlineColor);
-        drawPixel(b + x1, -a + y0, outlineColor);
+        drawOutlinePixel(-b + x0, -a + y0, topLeft - bX - aY, clip, outlineColor);
+        drawOutlinePixel(b + x1, -a + y0, topRight + bX - aY, clip, outlineColor);
 
         // this pair sweeps from bottom up
-        drawPixel(-b + x0, a + y1, outlineColor);
-        drawPixel(b + x1, a + y1, outlineColor);
+        drawOutlinePixel(-b + x0, a + y1, bottomLeft - bX + aY, clip, outlineColor);
+        drawOutlinePixel(b + x1, a + y1, bottomRight + bX + aY, clip, outlineColor);
 
         b++;
         if (radiusError < 0) {
@@ -591,6 +714,12 @@ void SMLayerBackground<RGB, optionFlags>::drawRoundRectangle(int16_t x0, int16_t
             radiusError += 2 * (b - a + 1);
         }
     }
+
+    // the sides are damaged as they're drawn, the corner points need their boxes damaged
+    damageBox(x0 - radius, y0 - radius, x0, y0);
+    damageBox(x1, y0 - radius, x1 + radius, y0);
+    damageBox(x0 - radius, y1, x0, y1 + radius);
+    damageBox(x1, y1, x1 + radius, y1 + radius);
 }
 
 // Code from http://www.sunshine2k.de/coding/java/TriangleRasterization/TriangleRasterization.html
@@ -600,9 +729,9 @@ void SMLayerBackground<RGB, optionFlags>::fillFlatSideTriangleInt(int16_t x1, in
     int16_t t1x, t2x, t1y, t2y;
     bool changed1 = false;
     bool changed2 = false;
-    int8_t signx1, signx2, signy1, signy2, dx1, dy1, dx2, dy2;
+    int16_t signx1, signx2, signy1, signy2, dx1, dy1, dx2, dy2;
     int i;
-    int8_t e1, e2;
+    int32_t e1, e2;
 
     t1x = t2x = x1; t1y = t2y = y1; // Starting points
 
@@ -638,6 +767,10 @@ void SMLayerBackground<RGB, optionFlags>::fillFlatSideTriangleInt(int16_t x1, in
 
     for (i = 0; i <= dx1; i++)
     {
+        // both edges move towards the flat side, so once a row is past the layer the rest are too
+        if ((signy1 > 0 && t1y >= this->localHeight) || (signy1 < 0 && t1y < 0))
+            break;
+
         drawFastHLine(t1x, t2x, t1y, color);
 
         while (dx1 > 0 && e1 >= 0)
@@ -683,6 +816,11 @@ void SMLayerBackground<RGB, optionFlags>::fillFlatSideTriangleInt(int16_t x1, in
 // Code from http://www.sunshine2k.de/coding/java/TriangleRasterization/TriangleRasterization.html
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::fillTriangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3, const RGB& fillColor) {
+    // check for triangle completely outside the layer
+    if ((y1 < 0 && y2 < 0 && y3 < 0) || (y1 >= this->localHeight && y2 >= this->localHeight && y3 >= this->localHeight) ||
+      (x1 < 0 && x2 < 0 && x3 < 0) || (x1 >= this->localWidth && x2 >= this->localWidth && x3 >= this->localWidth))
+        return;
+
     // Sort vertices
     if (y1 > y2) {
         SWAPint(y1, y2);
@@ -746,13 +884,42 @@ void SMLayerBackground<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0,
     if (y0 > y1) {
         SWAPint(y0, y1);
     };
-// Putting the x coordinates in order saves multiple swaps in drawFastHLine
     if (x0 > x1) {
         SWAPint(x0, x1);
     };
 
-    for (i = y0; i <= y1; i++) {
-        drawFastHLine(x0, x1, i, color);
+    // check for completely out of bounds rectangle
+    if (x1 < 0 || y1 < 0 || x0 >= this->localWidth || y0 >= this->localHeight)
+        return;
+
+    // truncate if partially out of bounds
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 >= this->localWidth)
+        x1 = this->localWidth - 1;
+    if (y1 >= this->localHeight)
+        y1 = this->localHeight - 1;
+
+    // any rotation maps the rectangle to a rectangle in the hardware buffer, fill it one hardware row at a time
+    int32_t index0 = this->hardwareOrigin + (x0 * this->hardwareStrideX) + (y0 * this->hardwareStrideY);
+    int32_t index1 = this->hardwareOrigin + (x1 * this->hardwareStrideX) + (y1 * this->hardwareStrideY);
+    int hardwareY0 = index0 / this->matrixWidth;
+    int hardwareY1 = index1 / this->matrixWidth;
+    int hardwareX0 = index0 - (hardwareY0 * this->matrixWidth);
+    int hardwareX1 = index1 - (hardwareY1 * this->matrixWidth);
+
+    if (hardwareY0 > hardwareY1)
+        SWAPint(hardwareY0, hardwareY1);
+    if (hardwareX0 > hardwareX1)
+        SWAPint(hardwareX0, hardwareX1);
+
+    drawnRegion.add(hardwareX0, hardwareY0, hardwareX1, hardwareY1);
+
+    for (i = hardwareY0; i <= hardwareY1; i++) {
+        drawnRows |= SM_DIRTY_ROW(i);
+        fillPixelSpan(&currentDrawBufferPtr[(i * this->matrixWidth) + hardwareX0], hardwareX1 - hardwareX0 + 1, color);
     }
 }
 
@@ -780,6 +947,11 @@ void SMLayerBackground<RGB, optionFlags>::setFont(fontChoices newFont) {
     font = (bitmap_font *)fontLookup(newFont);
 }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::enableProportionalText(bool enabled) {
+    proportionalText = enabled;
+}
+
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawChar(int16_t x, int16_t y, const RGB& charColor, char character) {
     int xcnt, ycnt;
@@ -795,38 +967,59 @@ void SMLayerBackground<RGB, optionFlags>::drawChar(int16_t x, int16_t y, const R
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawString(int16_t x, int16_t y, const RGB& charColor, const char text[]) {
-    int xcnt, ycnt, i = 0, offset = 0;
+    int xcnt, ycnt, offset = 0;
+    uint8_t advance, firstColumn;
     char character;
 
     while ((character = text[offset++]) != '\0') {
+        advance = getBitmapFontCharAdvance(character, font, proportionalText, &firstColumn);
         for (ycnt = 0; ycnt < font->Height; ycnt++) {
-            for (xcnt = 0; xcnt < font->Width; xcnt++) {
-                if (getBitmapFontPixelAtXY(character, xcnt, ycnt, font)) {
+            for (xcnt = 0; xcnt < advance; xcnt++) {
+                if (getBitmapFontPixelAtXY(character, firstColumn + xcnt, ycnt, font)) {
                     drawPixel(x + xcnt, y + ycnt, charColor);
                 }
             }
         }
-        x += font->Width;
+        x += advance;
     }
 }
 
 // draw string while clearing background
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::drawString(int16_t x, int16_t y, const RGB& charColor, const RGB& backColor, const char text[]) {
-    int xcnt, ycnt, i = 0, offset = 0;
+    int xcnt, ycnt, offset = 0;
+    uint8_t advance, firstColumn;
     char character;
 
     while ((character = text[offset++]) != '\0') {
+        advance = getBitmapFontCharAdvance(character, font, proportionalText, &firstColumn);
         for (ycnt = 0; ycnt < font->Height; ycnt++) {
-            for (xcnt = 0; xcnt < font->Width; xcnt++) {
-                if (getBitmapFontPixelAtXY(character, xcnt, ycnt, font)) {
+            for (xcnt = 0; xcnt < advance; xcnt++) {
+                if (getBitmapFontPixelAtXY(character, firstColumn + xcnt, ycnt, font)) {
                     drawPixel(x + xcnt, y + ycnt, charColor);
                 } else {
                     drawPixel(x + xcnt, y + ycnt, backColor);
                 }
             }
         }
-        x += font->Width;
+        x += advance;
+    }
+}
+
+// draw text laid out ahead of time, eight pixels of the run are read at once and blank bytes skipped
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawGlyphRun(int16_t x, int16_t y, const RGB& charColor, const SMGlyphRun &run) {
+    int xcnt, ycnt, i;
+
+    for (ycnt = 0; ycnt < run.getHeight(); ycnt++) {
+        for (xcnt = 0; xcnt < run.getWidth(); xcnt += 8) {
+            uint8_t pixels = run.getByte(xcnt, ycnt);
+
+            for (i = 0; pixels; i++, pixels <<= 1) {
+                if (pixels & 0x80)
+                    drawPixel(x + xcnt + i, y + ycnt, charColor);
+            }
+        }
     }
 }
 
@@ -844,6 +1037,226 @@ void SMLayerBackground<RGB, optionFlags>::drawMonoBitmap(int16_t x, int16_t y, u
     }
 }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height,
+  const rgb24 *bitmap, uint16_t bitmapWidth, uint16_t bitmapX, uint16_t bitmapY) {
+    drawBitmapImpl(x, y, width, height, bitmap, bitmapWidth, bitmapX, bitmapY, (const rgb24 *)NULL);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height,
+  const rgb24 *bitmap, uint16_t bitmapWidth, uint16_t bitmapX, uint16_t bitmapY, const rgb24 &colorKey) {
+    drawBitmapImpl(x, y, width, height, bitmap, bitmapWidth, bitmapX, bitmapY, &colorKey);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height,
+  const rgb48 *bitmap, uint16_t bitmapWidth, uint16_t bitmapX, uint16_t bitmapY) {
+    drawBitmapImpl(x, y, width, height, bitmap, bitmapWidth, bitmapX, bitmapY, (const rgb48 *)NULL);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawBitmap(int16_t x, int16_t y, uint16_t width, uint16_t height,
+  const rgb48 *bitmap, uint16_t bitmapWidth, uint16_t bitmapX, uint16_t bitmapY, const rgb48 &colorKey) {
+    drawBitmapImpl(x, y, width, height, bitmap, bitmapWidth, bitmapX, bitmapY, &colorKey);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawBitmap565(int16_t x, int16_t y, uint16_t width, uint16_t height,
+  const uint16_t *bitmap, uint16_t bitmapWidth, uint16_t bitmapX, uint16_t bitmapY) {
+    drawBitmapImpl(x, y, width, height, bitmap, bitmapWidth, bitmapX, bitmapY, (const uint16_t *)NULL);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::drawBitmap565(int16_t x, int16_t y, uint16_t width, uint16_t height,
+  const uint16_t *bitmap, uint16_t bitmapWidth, uint16_t bitmapX, uint16_t bitmapY, uint16_t colorKey) {
+    drawBitmapImpl(x, y, width, height, bitmap, bitmapWidth, bitmapX, bitmapY, &colorKey);
+}
+
+template <typename RGB, unsigned int optionFlags> template <typename SRC>
+void SMLayerBackground<RGB, optionFlags>::drawBitmapImpl(int16_t x, int16_t y, uint16_t width, uint16_t height,
+  const SRC *bitmap, uint16_t bitmapWidth, uint16_t bitmapX, uint16_t bitmapY, const SRC *colorKey) {
+    int32_t x0 = x, y0 = y;
+    int32_t x1 = x0 + width - 1, y1 = y0 + height - 1;
+    int i, j;
+
+    if (!width || !height || isOffLayer(x0, y0, x1, y1))
+        return;
+
+    // clip once, moving the source area with the destination
+    if (x0 < 0) {
+        bitmapX -= x0;
+        x0 = 0;
+    }
+    if (y0 < 0) {
+        bitmapY -= y0;
+        y0 = 0;
+    }
+    if (x1 >= this->localWidth)
+        x1 = this->localWidth - 1;
+    if (y1 >= this->localHeight)
+        y1 = this->localHeight - 1;
+
+    int count = x1 - x0 + 1;
+    int32_t stride = this->hardwareStrideX;
+    int32_t index = this->hardwareOrigin + (x0 * stride) + (y0 * this->hardwareStrideY);
+    const SRC *source = &bitmap[(bitmapY * bitmapWidth) + bitmapX];
+
+    damageArea(index, this->hardwareOrigin + (x1 * stride) + (y1 * this->hardwareStrideY));
+
+    for (j = y0; j <= y1; j++, index += this->hardwareStrideY, source += bitmapWidth) {
+        RGB *dest = &currentDrawBufferPtr[index];
+
+        // source rows laid out like the hardware row can be copied directly (only types of the same size are the same type)
+        if (stride == 1 && !colorKey && sizeof(SRC) == sizeof(RGB)) {
+            memcpy((uint8_t *)dest, source, count * sizeof(RGB));
+            continue;
+        }
+
+        for (i = 0; i < count; i++, dest += stride) {
+            if (colorKey && isColorKey(source[i], colorKey))
+                continue;
+
+            loadBitmapPixel(*dest, source[i]);
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerBackground<RGB, optionFlags>::drawCompressedImage(int16_t x, int16_t y, const SMCompressedImage &image) {
+    if (!image.isValid())
+        return false;
+
+    int32_t width = image.getWidth();
+    int32_t height = image.getHeight();
+
+    // part of the image on the layer, in image coordinates
+    int32_t visibleX0 = (x < 0) ? -x : 0;
+    int32_t visibleY0 = (y < 0) ? -y : 0;
+    int32_t visibleX1 = (x + width > this->localWidth) ? this->localWidth - 1 - x : width - 1;
+    int32_t visibleY1 = (y + height > this->localHeight) ? this->localHeight - 1 - y : height - 1;
+
+    if (visibleX0 > visibleX1 || visibleY0 > visibleY1)
+        return true;
+
+    int32_t strideX = this->hardwareStrideX;
+    damageArea(this->hardwareOrigin + ((x + visibleX0) * strideX) + ((y + visibleY0) * this->hardwareStrideY),
+        this->hardwareOrigin + ((x + visibleX1) * strideX) + ((y + visibleY1) * this->hardwareStrideY));
+
+    const uint8_t *palette = image.getPalette();
+    const uint8_t *packets = image.getPackets();
+    const uint8_t *packetsEnd = packets + image.getPacketBytes();
+    uint16_t paletteSize = image.getPaletteSize();
+    int pixelSize = palette ? 1 : 3;
+
+    // hardware index of image column 0 on the current row, only visible columns are written
+    int32_t rowIndex = this->hardwareOrigin + (x * strideX) + (y * this->hardwareStrideY);
+    int32_t column = 0, row = 0;
+    RGB color;
+
+    while (row <= visibleY1) {
+        if (packets >= packetsEnd)
+            return false;
+
+        int32_t count = *packets++;
+        bool run = count & SM_COMPRESSED_IMAGE_RUN;
+        count = (count & ~SM_COMPRESSED_IMAGE_RUN) + 1;
+
+        // the whole packet has to be in the image, and every index in it has to be in the palette
+        int32_t packetBytes = (run ? 1 : count) * pixelSize;
+        if (packetsEnd - packets < packetBytes)
+            return false;
+
+        if (palette && paletteSize < 256) {
+            for (int32_t i = 0; i < packetBytes; i++) {
+                if (packets[i] >= paletteSize)
+                    return false;
+            }
+        }
+
+        if (run) {
+            const uint8_t *pixel = palette ? &palette[*packets * 3] : packets;
+            color = rgb24(pixel[0], pixel[1], pixel[2]);
+            packets += pixelSize;
+        }
+
+        // the packet's pixels a row at a time
+        while (count && row <= visibleY1) {
+            int32_t pixels = (width - column < count) ? width - column : count;
+            int32_t first = (column < visibleX0) ? visibleX0 : column;
+            int32_t last = (column + pixels - 1 > visibleX1) ? visibleX1 : column + pixels - 1;
+
+            if (row >= visibleY0 && first <= last) {
+                if (run && strideX == 1) {
+                    fillPixelSpan(&currentDrawBufferPtr[rowIndex + first], last - first + 1, color);
+                } else if (run && strideX == -1) {
+                    fillPixelSpan(&currentDrawBufferPtr[rowIndex - last], last - first + 1, color);
+                } else if (run) {
+                    for (int32_t i = first; i <= last; i++)
+                        currentDrawBufferPtr[rowIndex + (i * strideX)] = color;
+                } else if (!palette && strideX == 1 && sizeof(RGB) == 3) {
+                    // literal colors are stored the same way as an rgb24 row
+                    memcpy((uint8_t *)&currentDrawBufferPtr[rowIndex + first], &packets[(first - column) * 3], (last - first + 1) * 3);
+                } else {
+                    const uint8_t *source = &packets[(first - column) * pixelSize];
+                    for (int32_t i = first; i <= last; i++, source += pixelSize) {
+                        const uint8_t *pixel = palette ? &palette[*source * 3] : source;
+                        currentDrawBufferPtr[rowIndex + (i * strideX)] = rgb24(pixel[0], pixel[1], pixel[2]);
+                    }
+                }
+            }
+
+            if (!run)
+                packets += pixels * pixelSize;
+
+            count -= pixels;
+            column += pixels;
+            if (column == width) {
+                column = 0;
+                row++;
+                rowIndex += this->hardwareStrideY;
+            }
+        }
+    }
+
+    return true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::loadBitmapPixel(RGB &pixel, const rgb24 &source) {
+    pixel = source;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::loadBitmapPixel(RGB &pixel, const rgb48 &source) {
+    pixel = source;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::loadBitmapPixel(RGB &pixel, const uint16_t &source) {
+    // expand 5 and 6 bit channels to 8 bits, repeating the top bits so full brightness stays full brightness
+    uint8_t red = (source >> 11) & 0x1F;
+    uint8_t green = (source >> 5) & 0x3F;
+    uint8_t blue = source & 0x1F;
+
+    pixel = rgb24((red << 3) | (red >> 2), (green << 2) | (green >> 4), (blue << 3) | (blue >> 2));
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerBackground<RGB, optionFlags>::isColorKey(const rgb24 &source, const rgb24 *colorKey) {
+    return source.red == colorKey->red && source.green == colorKey->green && source.blue == colorKey->blue;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerBackground<RGB, optionFlags>::isColorKey(const rgb48 &source, const rgb48 *colorKey) {
+    return source.red == colorKey->red && source.green == colorKey->green && source.blue == colorKey->blue;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerBackground<RGB, optionFlags>::isColorKey(const uint16_t &source, const uint16_t *colorKey) {
+    return source == *colorKey;
+}
+
 template <typename RGB, unsigned int optionFlags>
 bool SMLayerBackground<RGB, optionFlags>::isSwapPending(void) {
     return swapPending;
@@ -854,6 +1267,22 @@ void SMLayerBackground<RGB, optionFlags>::handleBufferSwap(void) {
     if (!swapPending)
         return;
 
+    if (tripleBuffer) {
+        // show the newest finished frame, the buffer it replaces becomes the spare
+        unsigned char oldRefreshBuffer = currentRefreshBuffer;
+
+        currentRefreshBuffer = spareBuffer;
+        spareBuffer = oldRefreshBuffer;
+
+        currentRefreshBufferPtr = &backgroundBuffer[currentRefreshBuffer * (this->matrixWidth * this->matrixHeight)];
+
+        // rows where the old frame differs from the newest frame are now different on screen
+        this->dirtyRows |= bufferStaleRows[oldRefreshBuffer];
+
+        swapPending = false;
+        return;
+    }
+
     unsigned char newDrawBuffer = currentRefreshBuffer;
 
     currentRefreshBuffer = currentDrawBuffer;
@@ -862,78 +1291,246 @@ void SMLayerBackground<RGB, optionFlags>::handleBufferSwap(void) {
     currentRefreshBufferPtr = &backgroundBuffer[currentRefreshBuffer * (this->matrixWidth * this->matrixHeight)];
     currentDrawBufferPtr = &backgroundBuffer[currentDrawBuffer * (this->matrixWidth * this->matrixHeight)];
 
+    // rows where the buffers differ are now different on screen
+    this->dirtyRows |= drawnRows;
+
     swapPending = false;
 }
 
 // waits until previous swap is complete
 // waits until current swap is complete if copy is enabled
+// with triple buffering never waits, and copy loads the new drawing buffer with the frame just finished
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::swapBuffers(bool copy) {
-    while (swapPending);
+    if (tripleBuffer) {
+        RGB *finishedBufferPtr = currentDrawBufferPtr;
+
+        trySwap();
+
+        if (copy) {
+            // the finished frame is only read by refresh, so it's safe to copy from even if it's being shown
+            copyRows(currentDrawBufferPtr, finishedBufferPtr, bufferStaleRows[currentDrawBuffer]);
+            bufferStaleRows[currentDrawBuffer] = 0;
+            drawnRegion.clear();
+        }
+        return;
+    }
+
+    while (swapPending)
+        SM_WAIT_FOR_REFRESH();
 
     swapPending = true;
 
+    // the buffers still differ only in drawnRegion after the swap, so only that needs copying
     if (copy) {
-        while (swapPending);
-        memcpy(currentDrawBufferPtr, currentRefreshBufferPtr, sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+        while (swapPending)
+            SM_WAIT_FOR_REFRESH();
+        copyRegion(currentDrawBufferPtr, currentRefreshBufferPtr, drawnRegion);
+        drawnRows = 0;
+        drawnRegion.clear();
     }
 }
 
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerBackground<RGB, optionFlags>::trySwap(void) {
+    if (!tripleBuffer) {
+        if (swapPending)
+            return false;
+
+        swapPending = true;
+        return true;
+    }
+
+    // rows that may differ from the previous finished frame, narrowed down to the rows that really do so
+    //   rows redrawn in a stale buffer stop being marked dirty once they match again
+    uint32_t candidateRows = drawnRows | bufferStaleRows[currentDrawBuffer];
+    uint32_t changedRows = 0;
+    if (candidateRows) {
+        RGB *finishedBufferPtr = &backgroundBuffer[lastFinishedBuffer * (this->matrixWidth * this->matrixHeight)];
+
+        for (int i = 0; i < this->matrixHeight; i++) {
+            uint32_t rowBit = SM_DIRTY_ROW(i);
+            if (!(candidateRows & rowBit) || (changedRows & rowBit))
+                continue;
+
+            if (memcmp(&currentDrawBufferPtr[i * this->matrixWidth], &finishedBufferPtr[i * this->matrixWidth],
+                sizeof(RGB) * this->matrixWidth))
+                changedRows |= rowBit;
+        }
+    }
+
+    noInterrupts();
+
+    // a finished frame still waiting to be shown is replaced by this one
+    if (swapPending)
+        droppedFrames++;
+
+    // every other buffer is now stale where this frame changed
+    for (int i = 0; i < 3; i++)
+        bufferStaleRows[i] |= changedRows;
+    bufferStaleRows[currentDrawBuffer] = 0;
+
+    lastFinishedBuffer = currentDrawBuffer;
+    currentDrawBuffer = spareBuffer;
+    spareBuffer = lastFinishedBuffer;
+    currentDrawBufferPtr = &backgroundBuffer[currentDrawBuffer * (this->matrixWidth * this->matrixHeight)];
+
+    swapPending = true;
+
+    interrupts();
+
+    // the new drawing buffer holds an older frame, rows that differ are tracked in bufferStaleRows
+    drawnRows = 0;
+    drawnRegion.clear();
+    damageRows(bufferStaleRows[currentDrawBuffer]);
+    return true;
+}
+
+// return pointer to a buffer that can be drawn into without waiting, NULL if there is none yet
+// changes made through the pointer can't be tracked, so every row is refreshed after the next swap
+template <typename RGB, unsigned int optionFlags>
+RGB *SMLayerBackground<RGB, optionFlags>::acquireBackBuffer(void) {
+    if (!tripleBuffer && swapPending)
+        return NULL;
+
+    damageAll();
+    return currentDrawBufferPtr;
+}
+
+template <typename RGB, unsigned int optionFlags>
+uint32_t SMLayerBackground<RGB, optionFlags>::getDroppedFrames(void) {
+    return droppedFrames;
+}
+
 template <typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::copyRefreshToDrawing() {
-    memcpy(currentDrawBufferPtr, currentRefreshBufferPtr, sizeof(RGB) * (this->matrixWidth * this->matrixHeight));
+    if (tripleBuffer) {
+        // the buffer being shown may become the spare during the copy, but nothing draws into it until the next swap
+        // rows where the drawing buffer or the shown frame differ from the newest finished frame
+        unsigned char shownBuffer = currentRefreshBuffer;
+        copyRows(currentDrawBufferPtr, &backgroundBuffer[shownBuffer * (this->matrixWidth * this->matrixHeight)],
+            drawnRows | bufferStaleRows[currentDrawBuffer] | bufferStaleRows[shownBuffer]);
+        bufferStaleRows[currentDrawBuffer] = bufferStaleRows[shownBuffer];
+        drawnRows = 0;
+        drawnRegion.clear();
+        damageRows(bufferStaleRows[currentDrawBuffer]);
+        return;
+    }
+
+    copyRegion(currentDrawBufferPtr, currentRefreshBufferPtr, drawnRegion);
+    drawnRows = 0;
+    drawnRegion.clear();
+}
+
+template <typename RGB, unsigned int optionFlags>
+const SMDamageRegion & SMLayerBackground<RGB, optionFlags>::getDamageRegion(void) {
+    return drawnRegion;
+}
+
+// copies hardware rows with their SM_DIRTY_ROW() bit set in rowMask, runs of rows with one memcpy
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::copyRows(RGB *dest, const RGB *source, uint32_t rowMask) {
+    int i = 0;
+
+    while (i < this->matrixHeight) {
+        if (!(rowMask & SM_DIRTY_ROW(i))) {
+            i++;
+            continue;
+        }
+
+        int firstRow = i;
+        while (i < this->matrixHeight && (rowMask & SM_DIRTY_ROW(i)))
+            i++;
+
+        memcpy((uint8_t *)&dest[firstRow * this->matrixWidth], &source[firstRow * this->matrixWidth],
+            sizeof(RGB) * this->matrixWidth * (i - firstRow));
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::copyRegion(RGB *dest, const RGB *source, const SMDamageRegion &region) {
+    for (int i = 0; i < region.getRectCount(); i++) {
+        const damageRect & rect = region.getRect(i);
+        uint16_t width = rect.x1 - rect.x0 + 1;
+
+        // full width rects are contiguous in the buffer
+        if (width == this->matrixWidth) {
+            memcpy((uint8_t *)&dest[rect.y0 * this->matrixWidth], &source[rect.y0 * this->matrixWidth],
+                sizeof(RGB) * this->matrixWidth * (rect.y1 - rect.y0 + 1));
+            continue;
+        }
+
+        for (int y = rect.y0; y <= rect.y1; y++) {
+            int32_t index = (y * this->matrixWidth) + rect.x0;
+            memcpy((uint8_t *)&dest[index], &source[index], sizeof(RGB) * width);
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::damageRows(uint32_t rowMask) {
+    if (rowMask == SM_ALL_ROWS_DIRTY) {
+        damageAll();
+        return;
+    }
+
+    for (int i = 0; i < this->matrixHeight; i++) {
+        if (rowMask & SM_DIRTY_ROW(i))
+            drawnRegion.add(0, i, this->matrixWidth - 1, i);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::damageAll(void) {
+    drawnRows = SM_ALL_ROWS_DIRTY;
+    drawnRegion.clear();
+    drawnRegion.add(0, 0, this->matrixWidth - 1, this->matrixHeight - 1);
 }
 
 // return pointer to start of currentDrawBuffer, so application can do efficient loading of bitmaps
+// changes made through the pointer can't be tracked, so every row is refreshed after the next swap
 template <typename RGB, unsigned int optionFlags>
 RGB *SMLayerBackground<RGB, optionFlags>::backBuffer(void) {
+    damageAll();
     return currentDrawBufferPtr;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::setBackBuffer(RGB *newBuffer) {
   currentDrawBufferPtr = newBuffer;
+  damageAll();
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::setBrightness(uint8_t brightness) {
-    backgroundBrightness = brightness;
+    colorPipeline.setBrightness(brightness);
+}
+
+template<typename RGB, unsigned int optionFlags>
+void SMLayerBackground<RGB, optionFlags>::setWhitePoint(const rgb24 & whitePoint) {
+    colorPipeline.setWhitePoint(whitePoint);
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerBackground<RGB, optionFlags>::enableColorCorrection(bool enabled) {
     this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    this->dirtyRows = SM_ALL_ROWS_DIRTY;
 }
 
 // reads pixel from drawing buffer, not refresh buffer
 template<typename RGB, unsigned int optionFlags>
 const RGB SMLayerBackground<RGB, optionFlags>::readPixel(int16_t x, int16_t y) {
-    int hwx, hwy;
-
     // check for out of bounds coordinates
     if (x < 0 || y < 0 || x >= this->localWidth || y >= this->localHeight)
         return (RGB){0, 0, 0};
 
     // map pixel into hardware buffer before reading
-    if (this->rotation == rotation0) {
-        hwx = x;
-        hwy = y;
-    } else if (this->rotation == rotation180) {
-        hwx = (this->matrixWidth - 1) - x;
-        hwy = (this->matrixHeight - 1) - y;
-    } else if (this->rotation == rotation90) {
-        hwx = (this->matrixWidth - 1) - y;
-        hwy = x;
-    } else { /* if (rotation == rotation270)*/
-        hwx = y;
-        hwy = (this->matrixHeight - 1) - x;
-    }
-
-    return currentDrawBufferPtr[(hwy * this->matrixWidth) + hwx];
+    return currentDrawBufferPtr[this->hardwareOrigin + (x * this->hardwareStrideX) + (y * this->hardwareStrideY)];
 }
 
 template<typename RGB, unsigned int optionFlags>
 RGB *SMLayerBackground<RGB, optionFlags>::getRealBackBuffer() {
+  damageAll();
   return &backgroundBuffer[currentDrawBuffer * (this->matrixWidth * this->matrixHeight)];
 }
 
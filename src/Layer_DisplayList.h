@@ -0,0 +1,136 @@
+/*
+ * SmartMatrix Library - Display List Layer Class
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LAYER_DISPLAY_LIST_H_
+#define _LAYER_DISPLAY_LIST_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+#include "MatrixGlyphRun.h"
+
+#define SM_DISPLAY_LIST_OPTIONS_NONE    0
+
+typedef enum displayListItemTypes {
+    displayListRectangle,
+    displayListRectangleOutline,
+    displayListLine,
+    displayListGlyphRun,
+    displayListMonoBitmap
+} displayListItemTypes;
+
+// a primitive in the display list, in local coordinates
+// rectangles: x0, y0 to x1, y1 inclusive - lines: end points - glyph runs and bitmaps: top left, with data pointing to the
+// SMGlyphRun or drawMonoBitmap() format bitmap, which isn't copied and is read again every time a row is refreshed
+template <typename RGB>
+struct SMDisplayListItem {
+    uint8_t type;
+    int16_t x0, y0, x1, y1;
+    RGB color;
+    const void * data;
+};
+
+// an item as the refresh uses it: color corrected, with bitmap bounds filled in, and lines clipped to the layer
+typedef struct displayListEntry {
+    uint8_t type;
+    int16_t x0, y0, x1, y1;
+    rgb48 color;
+    const void * data;
+    clippedLine line;
+    // hardware rows the item covers, lastRow < firstRow if it's not on the layer
+    int16_t firstRow, lastRow;
+} displayListEntry;
+
+// holds primitives instead of pixels, each hardware row is drawn from the items that cross it as the row is refreshed
+// swapBuffers() copies the list and sorts the items into per-row bins, so refreshing a row only visits items on that row
+// RAM used is about 2 * maxItems * (height + sizeof(displayListEntry)) bytes, and doesn't depend on the width
+template <typename RGB, unsigned int optionFlags>
+class SMLayerDisplayList : public SM_Layer {
+    public:
+        SMLayerDisplayList(SMDisplayListItem<RGB> * items, displayListEntry * entries, uint8_t * bins, uint16_t * binStarts,
+            uint8_t maxItems, uint16_t width, uint16_t height);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]);
+        uint32_t getDirtyRows(void);
+
+        // functions that add an item return its index, or -1 if the list is full
+        // items are drawn in order, later items on top, pixels not covered by any item are transparent
+        void clear(void);
+        int fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
+        int drawRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
+        int drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color);
+        // the run is drawn as it is when the list is swapped, and needs to stay in memory while it's on screen
+        int drawGlyphRun(int16_t x, int16_t y, const RGB& charColor, const SMGlyphRun &run);
+        int drawMonoBitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, const RGB& bitmapColor, const uint8_t *bitmap);
+
+        // changes to items already in the list, shown after the next swapBuffers()
+        void setItemPosition(uint8_t index, int16_t x, int16_t y);
+        void setItemColor(uint8_t index, const RGB& color);
+        uint8_t getItemCount(void);
+
+        // shows the list as it is now from the next frame on, the list stays as it is so it can be changed and swapped again
+        // doesn't wait, a list swapped before the previous one is shown replaces it
+        void swapBuffers(void);
+        bool isSwapPending(void);
+
+        void enableColorCorrection(bool enabled);
+
+    private:
+        int addItem(uint8_t type, int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color, const void * data);
+
+        void prepareEntries(uint8_t frame);
+        void binEntries(uint8_t frame);
+        void findEntryRows(displayListEntry & entry);
+
+        template <typename RGB_OUT>
+        void fillDisplayListRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[]);
+        template <typename RGB_OUT>
+        void fillEntryRow(const displayListEntry & entry, int16_t position, bool positionIsY, bool reversed, RGB_OUT refreshRow[]);
+        template <typename RGB_OUT>
+        void fillRowSpan(RGB_OUT refreshRow[], int16_t start, int16_t end, bool reversed, const RGB_OUT & color);
+
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+
+        // list the sketch edits
+        SMDisplayListItem<RGB> * drawItems;
+        uint8_t maxItems;
+        uint8_t itemCount = 0;
+
+        // two frames of entries and bins, one used by refresh and one filled by swapBuffers()
+        // the bin for hardware row y of a frame is bins[binStarts[y]] to bins[binStarts[y + 1] - 1], item indexes in drawing order
+        displayListEntry * frameEntries;
+        uint8_t * frameBins;
+        uint16_t * frameBinStarts;
+        uint8_t frameEntryCount[2];
+        // hardware rows with items in the frame, as SM_DIRTY_ROW() bits
+        uint32_t frameRows[2];
+        // rotation the frame was binned for, bins are rebuilt by refresh if the rotation changes
+        uint8_t frameRotation[2];
+
+        volatile unsigned char refreshFrame = 0;
+        volatile bool swapPending = false;
+};
+
+#include "Layer_DisplayList_Impl.h"
+
+#endif
@@ -0,0 +1,404 @@
+/*
+ * SmartMatrix Library - Display List Layer Class
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerDisplayList<RGB, optionFlags>::SMLayerDisplayList(SMDisplayListItem<RGB> * items, displayListEntry * entries, uint8_t * bins,
+  uint16_t * binStarts, uint8_t maxItems, uint16_t width, uint16_t height) {
+    // there are two frames of 2 * maxItems entries, maxItems * height bins, and height + 1 bin starts
+    drawItems = items;
+    frameEntries = entries;
+    frameBins = bins;
+    frameBinStarts = binStarts;
+    this->maxItems = maxItems;
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+
+    for (int i = 0; i < 2; i++) {
+        frameEntryCount[i] = 0;
+        frameRows[i] = 0;
+        // not a rotation, so the frame is binned the first time it's refreshed
+        frameRotation[i] = 0xFF;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::frameRefreshCallback(void) {
+    if (swapPending) {
+        unsigned char oldFrame = refreshFrame;
+        refreshFrame = !refreshFrame;
+        // rows that had items before or have items now
+        this->dirtyRows |= frameRows[oldFrame] | frameRows[refreshFrame];
+        swapPending = false;
+    }
+
+    // bins depend on the rotation, which is only changed before this callback
+    if (frameRotation[refreshFrame] != this->rotation) {
+        binEntries(refreshFrame);
+        this->dirtyRows = SM_ALL_ROWS_DIRTY;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+uint32_t SMLayerDisplayList<RGB, optionFlags>::getDirtyRows(void) {
+    return this->clearDirtyRows();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]) {
+    fillDisplayListRefreshRow(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]) {
+    fillDisplayListRefreshRow(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SMLayerDisplayList<RGB, optionFlags>::fillDisplayListRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    const displayListEntry * entries = &frameEntries[refreshFrame * maxItems];
+    const uint8_t * bins = &frameBins[refreshFrame * maxItems * this->matrixHeight];
+    const uint16_t * binStarts = &frameBinStarts[refreshFrame * (this->matrixHeight + 1)];
+    int16_t position;
+    bool positionIsY, reversed;
+    int i;
+
+    this->mapHardwareRow(hardwareY, position, positionIsY, reversed);
+
+    for (i = binStarts[hardwareY]; i < binStarts[hardwareY + 1]; i++)
+        fillEntryRow(entries[bins[i]], position, positionIsY, reversed, refreshRow);
+}
+
+// sets local pixels start to end along the row, clipped to the layer
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SMLayerDisplayList<RGB, optionFlags>::fillRowSpan(RGB_OUT refreshRow[], int16_t start, int16_t end, bool reversed, const RGB_OUT & color) {
+    if (start < 0)
+        start = 0;
+    if (end >= this->matrixWidth)
+        end = this->matrixWidth - 1;
+    if (start > end)
+        return;
+
+    if (reversed) {
+        int16_t temp = start;
+        start = (this->matrixWidth - 1) - end;
+        end = (this->matrixWidth - 1) - temp;
+    }
+
+    fillPixelSpan(&refreshRow[start], end - start + 1, color);
+}
+
+// draws the part of an entry on local row position (or column if !positionIsY), the entry is known to cross it
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SMLayerDisplayList<RGB, optionFlags>::fillEntryRow(const displayListEntry & entry, int16_t position, bool positionIsY,
+  bool reversed, RGB_OUT refreshRow[]) {
+    RGB_OUT color;
+    int i;
+
+    color = entry.color;
+
+    // item bounds across the row (a) and along it (b)
+    int16_t a0 = positionIsY ? entry.y0 : entry.x0;
+    int16_t a1 = positionIsY ? entry.y1 : entry.x1;
+    int16_t b0 = positionIsY ? entry.x0 : entry.y0;
+    int16_t b1 = positionIsY ? entry.x1 : entry.y1;
+
+    if (entry.type == displayListRectangle) {
+        fillRowSpan(refreshRow, b0, b1, reversed, color);
+    } else if (entry.type == displayListRectangleOutline) {
+        if (position == a0 || position == a1) {
+            fillRowSpan(refreshRow, b0, b1, reversed, color);
+        } else {
+            fillRowSpan(refreshRow, b0, b0, reversed, color);
+            fillRowSpan(refreshRow, b1, b1, reversed, color);
+        }
+    } else if (entry.type == displayListLine) {
+        const clippedLine & line = entry.line;
+
+        if (positionIsY == line.steep) {
+            // the row is one step along the major axis, with one pixel: the first i with the minor axis moved k times
+            int32_t overshoot = ((position - line.major0) * line.dMinor) - line.sum;
+            int32_t k = (overshoot > 0) ? ((overshoot + line.dMajor - 1) / line.dMajor) : 0;
+            int16_t minor = line.minor0 + (line.minorStep * k);
+
+            fillRowSpan(refreshRow, minor, minor, reversed, color);
+        } else {
+            // the row is one step along the minor axis, with the pixels that moved the minor axis k times
+            int32_t k = (position - line.minor0) * line.minorStep;
+            int32_t first = 0, last = line.steps;
+
+            if (line.dMinor) {
+                if (k > 0)
+                    first = ((((k - 1) * line.dMajor) + line.sum) / line.dMinor) + 1;
+                int32_t end = ((k * line.dMajor) + line.sum) / line.dMinor;
+                if (end < last)
+                    last = end;
+            }
+
+            fillRowSpan(refreshRow, line.major0 + first, line.major0 + last, reversed, color);
+        }
+    } else if (entry.type == displayListGlyphRun) {
+        const SMGlyphRun * run = (const SMGlyphRun *)entry.data;
+
+        if (positionIsY) {
+            // a row of the run, eight pixels at a time starting from the first on the layer
+            int16_t x = (entry.x0 < 0) ? -entry.x0 : 0;
+            int16_t width = entry.x1 - entry.x0 + 1;
+
+            for (; x < width && entry.x0 + x < this->matrixWidth; x += 8) {
+                uint8_t pixels = run->getByte(x, position - entry.y0);
+
+                for (i = 0; pixels; i++, pixels <<= 1) {
+                    if (pixels & 0x80)
+                        fillRowSpan(refreshRow, entry.x0 + x + i, entry.x0 + x + i, reversed, color);
+                }
+            }
+        } else {
+            // a column of the run
+            for (i = 0; i <= entry.y1 - entry.y0; i++) {
+                if (run->getPixel(position - entry.x0, i))
+                    fillRowSpan(refreshRow, entry.y0 + i, entry.y0 + i, reversed, color);
+            }
+        }
+    } else if (entry.type == displayListMonoBitmap) {
+        // drawMonoBitmap() format, (width / 8) + 1 bytes per row with the MSB leftmost
+        const uint8_t * bitmap = (const uint8_t *)entry.data;
+        int16_t width = entry.x1 - entry.x0 + 1;
+        int16_t rowSize = (width / 8) + 1;
+
+        if (positionIsY) {
+            const uint8_t * src = &bitmap[(position - entry.y0) * rowSize];
+
+            for (i = 0; i < width; i++) {
+                if (src[i / 8] & (0x80 >> (i % 8)))
+                    fillRowSpan(refreshRow, entry.x0 + i, entry.x0 + i, reversed, color);
+            }
+        } else {
+            int16_t x = position - entry.x0;
+
+            for (i = 0; i <= entry.y1 - entry.y0; i++) {
+                if (bitmap[(i * rowSize) + (x / 8)] & (0x80 >> (x % 8)))
+                    fillRowSpan(refreshRow, entry.y0 + i, entry.y0 + i, reversed, color);
+            }
+        }
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+int SMLayerDisplayList<RGB, optionFlags>::addItem(uint8_t type, int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color,
+  const void * data) {
+    if (itemCount >= maxItems)
+        return -1;
+
+    SMDisplayListItem<RGB> & item = drawItems[itemCount];
+    item.type = type;
+    item.x0 = x0;
+    item.y0 = y0;
+    item.x1 = x1;
+    item.y1 = y1;
+    item.color = color;
+    item.data = data;
+
+    return itemCount++;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::clear(void) {
+    itemCount = 0;
+}
+
+template <typename RGB, unsigned int optionFlags>
+int SMLayerDisplayList<RGB, optionFlags>::fillRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
+    return addItem(displayListRectangle, (x0 < x1) ? x0 : x1, (y0 < y1) ? y0 : y1, (x0 < x1) ? x1 : x0, (y0 < y1) ? y1 : y0, color, NULL);
+}
+
+template <typename RGB, unsigned int optionFlags>
+int SMLayerDisplayList<RGB, optionFlags>::drawRectangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
+    return addItem(displayListRectangleOutline, (x0 < x1) ? x0 : x1, (y0 < y1) ? y0 : y1, (x0 < x1) ? x1 : x0, (y0 < y1) ? y1 : y0, color, NULL);
+}
+
+template <typename RGB, unsigned int optionFlags>
+int SMLayerDisplayList<RGB, optionFlags>::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, const RGB& color) {
+    return addItem(displayListLine, x0, y0, x1, y1, color, NULL);
+}
+
+template <typename RGB, unsigned int optionFlags>
+int SMLayerDisplayList<RGB, optionFlags>::drawGlyphRun(int16_t x, int16_t y, const RGB& charColor, const SMGlyphRun &run) {
+    // size is taken from the run when the list is swapped
+    return addItem(displayListGlyphRun, x, y, x, y, charColor, &run);
+}
+
+template <typename RGB, unsigned int optionFlags>
+int SMLayerDisplayList<RGB, optionFlags>::drawMonoBitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, const RGB& bitmapColor,
+  const uint8_t *bitmap) {
+    return addItem(displayListMonoBitmap, x, y, x + width - 1, y + height - 1, bitmapColor, bitmap);
+}
+
+// moves the item so its first point (top left, or the start of a line) is at x, y
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::setItemPosition(uint8_t index, int16_t x, int16_t y) {
+    if (index >= itemCount)
+        return;
+
+    SMDisplayListItem<RGB> & item = drawItems[index];
+    int16_t dx = x - item.x0;
+    int16_t dy = y - item.y0;
+
+    item.x0 += dx;
+    item.y0 += dy;
+    item.x1 += dx;
+    item.y1 += dy;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::setItemColor(uint8_t index, const RGB& color) {
+    if (index >= itemCount)
+        return;
+
+    drawItems[index].color = color;
+}
+
+template <typename RGB, unsigned int optionFlags>
+uint8_t SMLayerDisplayList<RGB, optionFlags>::getItemCount(void) {
+    return itemCount;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::swapBuffers(void) {
+    // refresh doesn't take the spare frame while it's being filled, a frame that was swapped but not shown yet is replaced
+    swapPending = false;
+
+    unsigned char frame = !refreshFrame;
+    prepareEntries(frame);
+    binEntries(frame);
+
+    swapPending = true;
+}
+
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerDisplayList<RGB, optionFlags>::isSwapPending(void) {
+    return swapPending;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+}
+
+// copies the list into a frame's entries, with the colors the refresh uses
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::prepareEntries(uint8_t frame) {
+    displayListEntry * entries = &frameEntries[frame * maxItems];
+    int i;
+
+    for (i = 0; i < itemCount; i++) {
+        const SMDisplayListItem<RGB> & item = drawItems[i];
+        displayListEntry & entry = entries[i];
+
+        entry.type = item.type;
+        entry.x0 = item.x0;
+        entry.y0 = item.y0;
+        entry.x1 = item.x1;
+        entry.y1 = item.y1;
+        entry.data = item.data;
+
+        if (ccEnabled)
+            colorCorrection(item.color, entry.color);
+        else
+            entry.color = item.color;
+
+        if (item.type == displayListGlyphRun) {
+            const SMGlyphRun * run = (const SMGlyphRun *)item.data;
+            entry.x1 = item.x0 + run->getWidth() - 1;
+            entry.y1 = item.y0 + run->getHeight() - 1;
+        }
+    }
+
+    frameEntryCount[frame] = itemCount;
+}
+
+// finds the hardware rows an entry covers at the current rotation, and clips lines to the layer
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::findEntryRows(displayListEntry & entry) {
+    int16_t x0 = entry.x0, y0 = entry.y0, x1 = entry.x1, y1 = entry.y1;
+
+    if (entry.type == displayListLine) {
+        clippedLine & line = entry.line;
+
+        if (!this->clipLine(entry.x0, entry.y0, entry.x1, entry.y1, line)) {
+            entry.firstRow = 0;
+            entry.lastRow = -1;
+            return;
+        }
+
+        // bounds of the visible part, from the first and last visible pixel
+        int32_t overshoot = (line.steps * line.dMinor) - line.sum;
+        int32_t k = (overshoot > 0) ? ((overshoot + line.dMajor - 1) / line.dMajor) : 0;
+        int16_t minorEnd = line.minor0 + (line.minorStep * k);
+        int16_t minorLow = (minorEnd < line.minor0) ? minorEnd : line.minor0;
+        int16_t minorHigh = (minorEnd < line.minor0) ? line.minor0 : minorEnd;
+
+        x0 = line.steep ? minorLow : line.major0;
+        x1 = line.steep ? minorHigh : line.major0 + line.steps;
+        y0 = line.steep ? line.major0 : minorLow;
+        y1 = line.steep ? line.major0 + line.steps : minorHigh;
+    }
+
+    this->getHardwareRows(x0, y0, x1, y1, entry.firstRow, entry.lastRow);
+}
+
+// sorts a frame's entries into a bin for each hardware row, counting the entries on each row first
+template <typename RGB, unsigned int optionFlags>
+void SMLayerDisplayList<RGB, optionFlags>::binEntries(uint8_t frame) {
+    displayListEntry * entries = &frameEntries[frame * maxItems];
+    uint8_t * bins = &frameBins[frame * maxItems * this->matrixHeight];
+    uint16_t * binStarts = &frameBinStarts[frame * (this->matrixHeight + 1)];
+    uint32_t rows = 0;
+    int i, j;
+
+    frameRotation[frame] = this->rotation;
+
+    memset(binStarts, 0, (this->matrixHeight + 1) * sizeof(uint16_t));
+
+    for (i = 0; i < frameEntryCount[frame]; i++) {
+        findEntryRows(entries[i]);
+        for (j = entries[i].firstRow; j <= entries[i].lastRow; j++) {
+            binStarts[j]++;
+            rows |= SM_DIRTY_ROW(j);
+        }
+    }
+
+    // binStarts[j] is where bin j ends, then each bin is filled from the end so the entries stay in drawing order,
+    // which leaves binStarts[j] at the start of the bin
+    for (j = 1; j < this->matrixHeight; j++)
+        binStarts[j] += binStarts[j - 1];
+    binStarts[this->matrixHeight] = binStarts[this->matrixHeight - 1];
+
+    for (i = frameEntryCount[frame] - 1; i >= 0; i--) {
+        for (j = entries[i].firstRow; j <= entries[i].lastRow; j++)
+            bins[--binStarts[j]] = i;
+    }
+
+    frameRows[frame] = rows;
+}
@@ -28,9 +28,18 @@
 #include "MatrixCommon.h"
 
 #define SM_INDEXED_OPTIONS_NONE     0
+// bits stored per pixel, 1 if none of these are set - index 0 is always transparent
+#define SM_INDEXED_OPTIONS_2BPP     (1 << 0)
+#define SM_INDEXED_OPTIONS_4BPP     (1 << 1)
+#define SM_INDEXED_OPTIONS_8BPP     (1 << 2)
+
+#define SM_INDEXED_BITS_PER_PIXEL(options)  (((options) & SM_INDEXED_OPTIONS_8BPP) ? 8 : \
+                                             ((options) & SM_INDEXED_OPTIONS_4BPP) ? 4 : \
+                                             ((options) & SM_INDEXED_OPTIONS_2BPP) ? 2 : 1)
 
 // font
 #include "MatrixFontCommon.h"
+#include "MatrixGlyphRun.h"
 
 template <typename RGB, unsigned int optionFlags>
 class SMLayerIndexed : public SM_Layer {
@@ -39,6 +48,7 @@ class SMLayerIndexed : public SM_Layer {
         void frameRefreshCallback();
         void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]);
         void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]);
+        uint32_t getDirtyRows(void);
 
 
         void enableColorCorrection(bool enabled);
@@ -52,22 +62,35 @@ class SMLayerIndexed : public SM_Layer {
         // todo: handle index (draw transparent)
         void drawChar(int16_t x, int16_t y, uint8_t index, char character);
         void drawString(int16_t x, int16_t y, uint8_t index, const char text []);
+        void drawGlyphRun(int16_t x, int16_t y, uint8_t index, const SMGlyphRun &run);
+        void enableProportionalText(bool enabled);
         void drawMonoBitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, uint8_t index, uint8_t *bitmap);
 
     private:
         // todo: move somewhere else
         static bool getBitmapPixelAtXY(uint8_t x, uint8_t y, uint8_t width, uint8_t height, const uint8_t *bitmap);
 
-        template <typename RGB_OUT>
-        bool getPixel(uint16_t hardwareX, uint16_t hardwareY, RGB_OUT &xyPixel);
+        static const int bitsPerPixel = SM_INDEXED_BITS_PER_PIXEL(optionFlags);
+        static const int pixelsPerByte = 8 / bitsPerPixel;
+        static const uint8_t indexMask = (1 << bitsPerPixel) - 1;
 
-        // bitmap size is 32 rows (supporting maximum dimension of screen height in all rotations), by 32 bits
+        // bitmap is localWidth * localHeight pixels, bitsPerPixel each with the leftmost pixel in the most significant bits
         // double buffered to prevent flicker while drawing
         uint8_t * indexedBitmap;
 
         void handleBufferCopy(void);
 
-        RGB color;
+        template <typename RGB_OUT>
+        void fillIndexedRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[]);
+        template <typename RGB_OUT>
+        const RGB_OUT * getRefreshPalette(void);
+
+        RGB palette[1 << bitsPerPixel];
+
+        // palette with color correction applied, as rgb24 or rgb48 to match the refresh, rebuilt after the palette changes
+        rgb48 refreshPalette[1 << bitsPerPixel];
+        // bits per pixel of refreshPalette entries, 0 if it needs rebuilding
+        volatile uint8_t refreshPaletteDepth = 0;
         unsigned char currentframe = 0;
         char text[textLayerMaxStringLength];
 
@@ -80,6 +103,7 @@ class SMLayerIndexed : public SM_Layer {
         bool majorScrollFontChange = false;
 
         bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+        bool proportionalText = false;
         ScrollMode scrollmode = bounceForward;
         unsigned char framesperscroll = 4;
 
@@ -90,6 +114,9 @@ class SMLayerIndexed : public SM_Layer {
 
         volatile bool copyPending = false;
 
+        // hardware rows drawn since the last copy to the refresh buffer
+        uint32_t drawnRows = 0;
+
         bitmap_font *layerFont = (bitmap_font *) &apple3x5;
 };
 
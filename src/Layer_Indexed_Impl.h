@@ -26,7 +26,7 @@
 const unsigned char indexedDrawBuffer = 0;
 const unsigned char indexedRefreshBuffer = 1;
 
-#define INDEXED_BUFFER_ROW_SIZE     (this->localWidth / 8)
+#define INDEXED_BUFFER_ROW_SIZE     (this->localWidth / pixelsPerByte)
 #define INDEXED_BUFFER_SIZE         (INDEXED_BUFFER_ROW_SIZE * this->localHeight)
 
 template <typename RGB, unsigned int optionFlags>
@@ -35,7 +35,9 @@ SMLayerIndexed<RGB, optionFlags>::SMLayerIndexed(uint8_t * bitmap, uint16_t widt
     indexedBitmap = bitmap;
     this->matrixWidth = width;
     this->matrixHeight = height;
-    this->color = rgb48(0xffff, 0xffff, 0xffff);
+
+    for (int i = 0; i < (1 << bitsPerPixel); i++)
+        palette[i] = rgb48(0xffff, 0xffff, 0xffff);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -43,118 +45,104 @@ void SMLayerIndexed<RGB, optionFlags>::frameRefreshCallback(void) {
     handleBufferCopy();
 }
 
-// returns true and copies color to xyPixel if pixel is opaque, returns false if not
-template<typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
-bool SMLayerIndexed<RGB, optionFlags>::getPixel(uint16_t hardwareX, uint16_t hardwareY, RGB_OUT &xyPixel) {
-    uint16_t localScreenX, localScreenY;
-
-    // convert hardware x/y to the pixel in the local screen
-    switch( this->rotation ) {
-      case rotation0 :
-        localScreenX = hardwareX;
-        localScreenY = hardwareY;
-        break;
-      case rotation180 :
-        localScreenX = (this->matrixWidth - 1) - hardwareX;
-        localScreenY = (this->matrixHeight - 1) - hardwareY;
-        break;
-      case  rotation90 :
-        localScreenX = hardwareY;
-        localScreenY = (this->matrixWidth - 1) - hardwareX;
-        break;
-      case  rotation270 :
-        localScreenX = (this->matrixHeight - 1) - hardwareY;
-        localScreenY = hardwareX;
-        break;
-      default:
-        // TODO: Should throw an error
-        return false;
-    };
-
-    uint8_t bitmask = 0x80 >> (localScreenX % 8);
-
-    if (indexedBitmap[(indexedRefreshBuffer * INDEXED_BUFFER_SIZE) + (localScreenY * INDEXED_BUFFER_ROW_SIZE) + (localScreenX/8)] & bitmask) {
-        xyPixel = color;
-        return true;
-    }
-
-    return false;
+template <typename RGB, unsigned int optionFlags>
+uint32_t SMLayerIndexed<RGB, optionFlags>::getDirtyRows(void) {
+    return this->clearDirtyRows();
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]) {
-    RGB currentPixel;
-    int i;
+    fillIndexedRefreshRow(hardwareY, refreshRow);
+}
 
-    if(this->ccEnabled) {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
+template <typename RGB, unsigned int optionFlags>
+void SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]) {
+    fillIndexedRefreshRow(hardwareY, refreshRow);
+}
 
-            colorCorrection(currentPixel, refreshRow[i]);
-        }
-    } else {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
+// refresh only uses one of rgb24 or rgb48, so the cache holds whichever was last asked for
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+const RGB_OUT * SMLayerIndexed<RGB, optionFlags>::getRefreshPalette(void) {
+    RGB_OUT * cache = (RGB_OUT *)refreshPalette;
+    int i;
 
-            // load background pixel without color correction
-            refreshRow[i] = currentPixel;
+    if (refreshPaletteDepth != sizeof(RGB_OUT) * 8) {
+        for (i = 0; i < (1 << bitsPerPixel); i++) {
+            if(this->ccEnabled)
+                colorCorrection(palette[i], cache[i]);
+            else
+                cache[i] = palette[i];
         }
+        refreshPaletteDepth = sizeof(RGB_OUT) * 8;
     }
+
+    return cache;
 }
 
-template <typename RGB, unsigned int optionFlags>
-void SMLayerIndexed<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]) {
-    RGB currentPixel;
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SMLayerIndexed<RGB, optionFlags>::fillIndexedRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    const RGB_OUT * currentPalette = getRefreshPalette<RGB_OUT>();
+    const uint8_t * bitmap = &indexedBitmap[indexedRefreshBuffer * INDEXED_BUFFER_SIZE];
     int i;
 
-    if(this->ccEnabled) {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
+    if (bitsPerPixel == 1) {
+        this->fillRefreshRowFromBitmap(bitmap, hardwareY, currentPalette[1], refreshRow);
+        return;
+    }
 
-            colorCorrection(currentPixel, refreshRow[i]);
-        }
-    } else {
-        for(i=0; i<this->matrixWidth; i++) {
-            if(!getPixel(i, hardwareY, currentPixel))
-                continue;
+    // walk the local bitmap from the pixel shown at hardwareX = 0, pixelsPerByte is a power of two so this is shifts and masks
+    uint32_t localPixel = this->localOrigin + (hardwareY * this->localStrideY);
 
-            // load background pixel without color correction
-            refreshRow[i] = currentPixel;
-        }
+    for (i = 0; i < this->matrixWidth; i++, localPixel += this->localStrideX) {
+        uint8_t index = (bitmap[localPixel / pixelsPerByte] >> (((pixelsPerByte - 1) - (localPixel % pixelsPerByte)) * bitsPerPixel)) & indexMask;
+
+        // index 0 is transparent
+        if (index)
+            refreshRow[i] = currentPalette[index];
     }
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::setIndexedColor(uint8_t index, const RGB & newColor) {
-    color = newColor;
+    palette[index & indexMask] = newColor;
+    refreshPaletteDepth = 0;
+    this->dirtyRows = SM_ALL_ROWS_DIRTY;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::enableColorCorrection(bool enabled) {
     this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    refreshPaletteDepth = 0;
+    this->dirtyRows = SM_ALL_ROWS_DIRTY;
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::fillScreen(uint8_t index) {
     uint8_t fillValue;
-    if(index)
-        fillValue = 0xFF;
+    int i;
+
+    // repeat index for every pixel in the byte, any non-zero index sets a pixel with 1 bit per pixel
+    if (bitsPerPixel == 1)
+        fillValue = index ? 1 : 0;
     else
-        fillValue = 0x00;
+        fillValue = index & indexMask;
+
+    for (i = bitsPerPixel; i < 8; i *= 2)
+        fillValue |= fillValue << i;
 
     memset(&indexedBitmap[indexedDrawBuffer*INDEXED_BUFFER_SIZE], fillValue, INDEXED_BUFFER_SIZE);
+    drawnRows = SM_ALL_ROWS_DIRTY;
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::swapBuffers(bool copy) {
-    while (copyPending);
+    while (copyPending)
+        SM_WAIT_FOR_REFRESH();
 
     copyPending = true;
 
-    while (copy && copyPending);
+    while (copy && copyPending)
+        SM_WAIT_FOR_REFRESH();
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -163,23 +151,23 @@ void SMLayerIndexed<RGB, optionFlags>::handleBufferCopy(void) {
         return;
 
     memcpy(&indexedBitmap[indexedRefreshBuffer*INDEXED_BUFFER_SIZE], &indexedBitmap[indexedDrawBuffer*INDEXED_BUFFER_SIZE], INDEXED_BUFFER_SIZE);
+    this->dirtyRows |= drawnRows;
+    drawnRows = 0;
     copyPending = false;
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::drawPixel(int16_t x, int16_t y, uint8_t index) {
-    uint8_t tempBitmask;
-
-    if(x < 0 || x >= this->localWidth || y < 0 || y >= this->localWidth)
+    if(x < 0 || x >= this->localWidth || y < 0 || y >= this->localHeight)
         return;
 
-    if(index) {
-        tempBitmask = 0x80 >> (x%8);
-        indexedBitmap[indexedDrawBuffer*INDEXED_BUFFER_SIZE + (y * INDEXED_BUFFER_ROW_SIZE) + (x/8)] |= tempBitmask;
-    } else {
-        tempBitmask = ~(0x80 >> (x%8));
-        indexedBitmap[indexedDrawBuffer*INDEXED_BUFFER_SIZE + (y * INDEXED_BUFFER_ROW_SIZE) + (x/8)] &= tempBitmask;
-    }
+    // any non-zero index sets a pixel with 1 bit per pixel
+    uint8_t value = (bitsPerPixel == 1) ? (index ? 1 : 0) : (index & indexMask);
+    uint8_t shift = ((pixelsPerByte - 1) - (x % pixelsPerByte)) * bitsPerPixel;
+    uint8_t * pixelByte = &indexedBitmap[indexedDrawBuffer*INDEXED_BUFFER_SIZE + (y * INDEXED_BUFFER_ROW_SIZE) + (x / pixelsPerByte)];
+
+    *pixelByte = (*pixelByte & ~(indexMask << shift)) | (value << shift);
+    drawnRows |= this->getLocalRowDirtyMask(y);
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -194,7 +182,7 @@ void SMLayerIndexed<RGB, optionFlags>::drawChar(int16_t x, int16_t y, uint8_t in
     int k;
 
     // only draw if character is on the screen
-    if (x + scrollFont->Width < 0 || x >= this->localWidth) {
+    if (x + layerFont->Width < 0 || x >= this->localWidth) {
         return;
     }
 
@@ -204,6 +192,17 @@ void SMLayerIndexed<RGB, optionFlags>::drawChar(int16_t x, int16_t y, uint8_t in
         if (k >= this->localHeight) return;
 
         tempBitmask = getBitmapFontRowAtXY(character, k - y, layerFont);
+
+        if (bitsPerPixel > 1) {
+            // pixels don't line up with bits in the font, draw each set bit with index
+            for (int j = 0; j < 8; j++) {
+                if (tempBitmask & (0x80 >> j))
+                    drawPixel(x + j, k, index);
+            }
+            continue;
+        }
+
+        drawnRows |= this->getLocalRowDirtyMask(k);
         if (x < 0) {
             indexedBitmap[indexedDrawBuffer*INDEXED_BUFFER_SIZE + (k * INDEXED_BUFFER_ROW_SIZE) + 0] |= tempBitmask << -x;
         } else {
@@ -217,16 +216,55 @@ void SMLayerIndexed<RGB, optionFlags>::drawChar(int16_t x, int16_t y, uint8_t in
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::drawString(int16_t x, int16_t y, uint8_t index, const char text []) {
+    uint8_t firstColumn;
+
     // limit text to 10 chars, why?
     for (int i = 0; i < 10; i++) {
         char character = text[i];
         if (character == '\0')
             return;
 
-        drawChar(i * layerFont->Width + x, y, index, character);
+        // columns left of firstColumn are blank, drawing the character shifted left trims them
+        uint8_t advance = getBitmapFontCharAdvance(character, layerFont, proportionalText, &firstColumn);
+        drawChar(x - firstColumn, y, index, character);
+        x += advance;
+    }
+}
+
+// draw text laid out ahead of time, with 1 bit per pixel the run is ORed straight into the bitmap
+template <typename RGB, unsigned int optionFlags>
+void SMLayerIndexed<RGB, optionFlags>::drawGlyphRun(int16_t x, int16_t y, uint8_t index, const SMGlyphRun &run) {
+    int xcnt, ycnt, i;
+
+    if (bitsPerPixel == 1) {
+        if (!index)
+            return;
+
+        run.draw(&indexedBitmap[indexedDrawBuffer*INDEXED_BUFFER_SIZE], INDEXED_BUFFER_ROW_SIZE, this->localWidth, this->localHeight, x, y);
+        for (ycnt = 0; ycnt < run.getHeight(); ycnt++) {
+            if (y + ycnt >= 0 && y + ycnt < this->localHeight)
+                drawnRows |= this->getLocalRowDirtyMask(y + ycnt);
+        }
+        return;
+    }
+
+    for (ycnt = 0; ycnt < run.getHeight(); ycnt++) {
+        for (xcnt = 0; xcnt < run.getWidth(); xcnt += 8) {
+            uint8_t pixels = run.getByte(xcnt, ycnt);
+
+            for (i = 0; pixels; i++, pixels <<= 1) {
+                if (pixels & 0x80)
+                    drawPixel(x + xcnt + i, y + ycnt, index);
+            }
+        }
     }
 }
 
+template <typename RGB, unsigned int optionFlags>
+void SMLayerIndexed<RGB, optionFlags>::enableProportionalText(bool enabled) {
+    proportionalText = enabled;
+}
+
 template <typename RGB, unsigned int optionFlags>
 void SMLayerIndexed<RGB, optionFlags>::drawMonoBitmap(int16_t x, int16_t y, uint8_t width, uint8_t height, uint8_t index, uint8_t *bitmap) {
     int xcnt, ycnt;
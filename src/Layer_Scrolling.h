@@ -24,11 +24,15 @@
 #ifndef _LAYER_SCROLLING_H_
 #define _LAYER_SCROLLING_H_
 
+#include <limits.h>
 #include "Layer.h"
 #include "MatrixCommon.h"
 
 // scroll text
 const int textLayerMaxStringLength = 100;
+// text is laid out into a 1bpp run, enough for textLayerMaxStringLength characters 8 pixels wide, with rows for the
+// layer's height up to the 16 row fonts, a font taller than the layer can cut the longest strings short
+#define SM_SCROLLING_TEXT_RUN_SIZE(height)  (textLayerMaxStringLength * ((height) < 16 ? (height) : 16))
 
 typedef enum ScrollMode {
     wrapForward,
@@ -43,14 +47,16 @@ typedef enum ScrollMode {
 
 // font
 #include "MatrixFontCommon.h"
+#include "MatrixGlyphRun.h"
 
 template <typename RGB, unsigned int optionFlags>
 class SMLayerScrolling : public SM_Layer {
     public:
-        SMLayerScrolling(uint8_t * bitmap, uint16_t width, uint16_t height);
+        SMLayerScrolling(uint8_t * bitmap, uint16_t width, uint16_t height, uint8_t * textRunBitmap, uint16_t textRunSize);
         void frameRefreshCallback();
         void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]);
         void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]);
+        uint32_t getDirtyRows(void);
 
         void setRefreshRate(uint8_t newRefreshRate);
 
@@ -68,25 +74,25 @@ class SMLayerScrolling : public SM_Layer {
         void setOffsetFromTop(int offset);
         void setStartOffsetFromLeft(int offset);
         void enableColorCorrection(bool enabled);
+        void enableProportionalText(bool enabled);
 
     private:
         void redrawScrollingText(void);
+        void shiftScrollingText(int direction);
+        void drawScrollingTextColumn(int x);
         void setMinMax(void);
+        void layoutScrollingText(void);
 
         // todo: move somewhere else
         static bool getBitmapPixelAtXY(uint8_t x, uint8_t y, uint8_t width, uint8_t height, const uint8_t *bitmap);
         void updateScrollingText(void);
 
-        template <typename RGB_OUT>
-        bool getPixel(uint16_t hardwareX, uint16_t hardwareY, RGB_OUT &xyPixel);
-        bool getPixel(uint16_t hardwareX, uint16_t hardwareY);
-
         RGB textcolor;
         unsigned char currentframe = 0;
         char text[textLayerMaxStringLength];
         unsigned char pixelsPerSecond = 30;
 
-        unsigned char textlen;
+        unsigned char textlen = 0;
         volatile int scrollcounter = 0;
         const bitmap_font *scrollFont = &apple5x7;
 
@@ -95,13 +101,22 @@ class SMLayerScrolling : public SM_Layer {
         bool majorScrollFontChange = false;
 
         bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+        bool proportionalText = false;
         ScrollMode scrollmode = bounceForward;
         unsigned char framesperscroll = 4;
 
+        // text rasterized with scrollFont, only laid out again when the text, font, or spacing changes
+        SMGlyphRun textRun;
+
         // these variables describe the text bitmap: size, location on the screen, and bounds of where it moves
-        unsigned int textWidth;
+        unsigned int textWidth = UINT_MAX;
         int scrollMin, scrollMax;
         int scrollPosition;
+
+        // scrollPosition and rotation the bitmap was drawn with, text/font changes set redrawPending
+        int renderedPosition;
+        rotationDegrees renderedRotation;
+        bool redrawPending = true;
 };
 
 #include "Layer_Scrolling_Impl.h"
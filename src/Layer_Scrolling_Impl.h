@@ -27,7 +27,8 @@
 #define SCROLLING_BUFFER_SIZE       (SCROLLING_BUFFER_ROW_SIZE * this->localHeight)
 
 template <typename RGB, unsigned int optionFlags>
-SMLayerScrolling<RGB, optionFlags>::SMLayerScrolling(uint8_t * bitmap, uint16_t width, uint16_t height) {
+SMLayerScrolling<RGB, optionFlags>::SMLayerScrolling(uint8_t * bitmap, uint16_t width, uint16_t height,
+    uint8_t * textRunBitmap, uint16_t textRunSize) : textRun(textRunBitmap, textRunSize) {
     scrollingBitmap = bitmap;
     this->matrixWidth = width;
     this->matrixHeight = height;
@@ -39,124 +40,55 @@ void SMLayerScrolling<RGB, optionFlags>::frameRefreshCallback(void) {
     updateScrollingText();
 }
 
-// returns true and copies color to xyPixel if pixel is opaque, returns false if not
-template<typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
-bool SMLayerScrolling<RGB, optionFlags>::getPixel(uint16_t hardwareX, uint16_t hardwareY, RGB_OUT &xyPixel) {
-    uint16_t localScreenX, localScreenY;
-
-    // convert hardware x/y to the pixel in the local screen
-    switch( this->rotation ) {
-      case rotation0 :
-        localScreenX = hardwareX;
-        localScreenY = hardwareY;
-        break;
-      case rotation180 :
-        localScreenX = (this->matrixWidth - 1) - hardwareX;
-        localScreenY = (this->matrixHeight - 1) - hardwareY;
-        break;
-      case  rotation90 :
-        localScreenX = hardwareY;
-        localScreenY = (this->matrixWidth - 1) - hardwareX;
-        break;
-      case  rotation270 :
-        localScreenX = (this->matrixHeight - 1) - hardwareY;
-        localScreenY = hardwareX;
-        break;
-      default:
-        // TODO: Should throw an error
-        return false;
-    };
-
-    uint8_t bitmask = 0x80 >> (localScreenX % 8);
-
-    if (scrollingBitmap[(localScreenY * SCROLLING_BUFFER_ROW_SIZE) + (localScreenX/8)] & bitmask) {
-        xyPixel = textcolor;
-        return true;
-    }
-
-    return false;
-}
-
-template<typename RGB, unsigned int optionFlags>
-bool SMLayerScrolling<RGB, optionFlags>::getPixel(uint16_t hardwareX, uint16_t hardwareY) {
-    uint16_t localScreenX, localScreenY;
-
-    // convert hardware x/y to the pixel in the local screen
-    switch( this->rotation ) {
-      case rotation0 :
-        localScreenX = hardwareX;
-        localScreenY = hardwareY;
-        break;
-      case rotation180 :
-        localScreenX = (this->matrixWidth - 1) - hardwareX;
-        localScreenY = (this->matrixHeight - 1) - hardwareY;
-        break;
-      case  rotation90 :
-        localScreenX = hardwareY;
-        localScreenY = (this->matrixWidth - 1) - hardwareX;
-        break;
-      case  rotation270 :
-        localScreenX = (this->matrixHeight - 1) - hardwareY;
-        localScreenY = hardwareX;
-        break;
-      default:
-        // TODO: Should throw an error
-        return false;
-    };
-
-    uint8_t bitmask = 0x80 >> (localScreenX % 8);
-
-    if (scrollingBitmap[(localScreenY * SCROLLING_BUFFER_ROW_SIZE) + (localScreenX/8)] & bitmask) {
-        return true;
-    }
-
-    return false;
+template <typename RGB, unsigned int optionFlags>
+uint32_t SMLayerScrolling<RGB, optionFlags>::getDirtyRows(void) {
+    return this->clearDirtyRows();
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]) {
     rgb48 currentPixel;
-    int i;
 
     if(this->ccEnabled)
         colorCorrection(textcolor, currentPixel);
     else
         currentPixel = textcolor;
 
-    for(i=0; i<this->matrixWidth; i++) {
-        if(!getPixel(i, hardwareY))
-            continue;
-
-        refreshRow[i] = currentPixel;
-    }
+    this->fillRefreshRowFromBitmap(scrollingBitmap, hardwareY, currentPixel, refreshRow);
 }
 
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]) {
     rgb24 currentPixel;
-    int i;
 
     if(this->ccEnabled)
         colorCorrection(textcolor, currentPixel);
     else
         currentPixel = textcolor;
 
-    for(i=0; i<this->matrixWidth; i++) {
-        if(!getPixel(i, hardwareY))
-            continue;
-
-        refreshRow[i] = currentPixel;
-    }
+    this->fillRefreshRowFromBitmap(scrollingBitmap, hardwareY, currentPixel, refreshRow);
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::setColor(const RGB & newColor) {
     textcolor = newColor;
+    this->dirtyRows = SM_ALL_ROWS_DIRTY;
 }
 
 template<typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::enableColorCorrection(bool enabled) {
     this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    this->dirtyRows = SM_ALL_ROWS_DIRTY;
+}
+
+// use each character's width instead of the font's fixed width to space text
+template<typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::enableProportionalText(bool enabled) {
+    if (proportionalText == enabled)
+        return;
+
+    proportionalText = enabled;
+    layoutScrollingText();
 }
 
 // stops the scrolling text on the next refresh
@@ -211,31 +143,50 @@ void SMLayerScrolling<RGB, optionFlags>::start(const char inputtext[], int numSc
     int length = strlen((const char *)inputtext);
     if (length > textLayerMaxStringLength)
         length = textLayerMaxStringLength;
-    strncpy(text, (const char *)inputtext, length);
-    textlen = length;
-    scrollcounter = numScrolls;
 
-    textWidth = (textlen * scrollFont->Width) - 1;
+    // showing the same text again reuses the run already laid out
+    if (length != textlen || strncmp(text, (const char *)inputtext, length)) {
+        memcpy(text, inputtext, length);
+        textlen = length;
+        textWidth = textRun.layout(text, textlen, scrollFont, proportionalText) - 1;
+    }
+    scrollcounter = numScrolls;
 
     setMinMax();
+    redrawPending = true;
  }
 
 //Updates the text that is currently scrolling to the new value
 //Useful for a clock display where the time changes.
+//Scrolling continues from the current position
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::update(const char inputtext[]){
     int length = strlen((const char *)inputtext);
     if (length > textLayerMaxStringLength)
         length = textLayerMaxStringLength;
-    strncpy(text, (const char *)inputtext, length);
+
+    if (length == textlen && !strncmp(text, (const char *)inputtext, length))
+        return;
+
+    memcpy(text, inputtext, length);
     textlen = length;
-    textWidth = (textlen * scrollFont->Width) - 1;
+    layoutScrollingText();
+}
 
-    setMinMax();
+// lays out the text again after it or the font changed, scrolling continues from the current position
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::layoutScrollingText(void) {
+    textWidth = textRun.layout(text, textlen, scrollFont, proportionalText) - 1;
+
+    if (scrollmode == stopped || scrollmode == off)
+        setMinMax();
+    else
+        scrollMin = -textWidth;
+
+    redrawPending = true;
 }
 
 // called once per frame to update (virtual) bitmap
-// function needs major efficiency improvments
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::updateScrollingText(void) {
     bool resetScrolls = false;
@@ -284,11 +235,96 @@ void SMLayerScrolling<RGB, optionFlags>::updateScrollingText(void) {
         resetScrolls = true;
     }
 
-    // for now, fill the bitmap fresh with each update
-    // TODO: reset only when necessary, and update just the pixels that need it
-    resetScrolls = true;
+    // a one pixel step only needs the existing text shifted and the newly exposed column drawn
+    if (redrawPending || majorScrollFontChange || this->rotation != renderedRotation)
+        resetScrolls = true;
+    else if (scrollPosition == renderedPosition - 1 || scrollPosition == renderedPosition + 1)
+        shiftScrollingText(scrollPosition - renderedPosition);
+    else if (scrollPosition != renderedPosition)
+        resetScrolls = true;
+
     if (resetScrolls) {
         redrawScrollingText();
+        redrawPending = false;
+    }
+
+    renderedPosition = scrollPosition;
+    renderedRotation = this->rotation;
+}
+
+// shifts the text rows of the bitmap one pixel right (direction = 1) or left (direction = -1), and draws the exposed column
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::shiftScrollingText(int direction) {
+    int j, i;
+    int rowSize = SCROLLING_BUFFER_ROW_SIZE;
+    int rowStart = fontTopOffset > 0 ? fontTopOffset : 0;
+    int rowEnd = fontTopOffset + textRun.getHeight();
+    if (rowEnd > this->localHeight)
+        rowEnd = this->localHeight;
+
+    for (j = rowStart; j < rowEnd; j++) {
+        uint8_t * row = &scrollingBitmap[j * rowSize];
+
+        if (rowSize % sizeof(uint32_t)) {
+            // shift a byte at a time, carrying the bit between bytes
+            if (direction < 0) {
+                for (i = 0; i < rowSize - 1; i++)
+                    row[i] = (row[i] << 1) | (row[i + 1] >> 7);
+                row[i] <<= 1;
+            } else {
+                for (i = rowSize - 1; i > 0; i--)
+                    row[i] = (row[i] >> 1) | (row[i - 1] << 7);
+                row[0] >>= 1;
+            }
+        } else {
+            // shift a word at a time, bytes are swapped so the leftmost pixel is the MSB of the word
+            uint32_t word;
+            if (direction < 0) {
+                for (i = 0; i < rowSize; i += sizeof(uint32_t)) {
+                    memcpy(&word, &row[i], sizeof(uint32_t));
+                    word = __builtin_bswap32(word) << 1;
+                    if (i + (int)sizeof(uint32_t) < rowSize)
+                        word |= row[i + sizeof(uint32_t)] >> 7;
+                    word = __builtin_bswap32(word);
+                    memcpy(&row[i], &word, sizeof(uint32_t));
+                }
+            } else {
+                for (i = rowSize - sizeof(uint32_t); i >= 0; i -= sizeof(uint32_t)) {
+                    memcpy(&word, &row[i], sizeof(uint32_t));
+                    word = __builtin_bswap32(word) >> 1;
+                    if (i > 0)
+                        word |= (uint32_t)(row[i - 1] & 0x01) << 31;
+                    word = __builtin_bswap32(word);
+                    memcpy(&row[i], &word, sizeof(uint32_t));
+                }
+            }
+        }
+
+        this->dirtyRows |= this->getLocalRowDirtyMask(j);
+    }
+
+    drawScrollingTextColumn(direction < 0 ? this->localWidth - 1 : 0);
+}
+
+// sets the pixels of the text at local column x, the column must already be clear
+template <typename RGB, unsigned int optionFlags>
+void SMLayerScrolling<RGB, optionFlags>::drawScrollingTextColumn(int x) {
+    int j;
+    int textColumn = x - scrollPosition;
+
+    if (textColumn < 0 || textColumn >= textRun.getWidth())
+        return;
+
+    uint8_t bitmapMask = 0x80 >> (x % 8);
+
+    int rowStart = fontTopOffset > 0 ? fontTopOffset : 0;
+    int rowEnd = fontTopOffset + textRun.getHeight();
+    if (rowEnd > this->localHeight)
+        rowEnd = this->localHeight;
+
+    for (j = rowStart; j < rowEnd; j++) {
+        if (textRun.getPixel(textColumn, j - fontTopOffset))
+            scrollingBitmap[(j * SCROLLING_BUFFER_ROW_SIZE) + (x / 8)] |= bitmapMask;
     }
 }
 
@@ -296,6 +332,7 @@ void SMLayerScrolling<RGB, optionFlags>::updateScrollingText(void) {
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::setMode(ScrollMode mode) {
     scrollmode = mode;
+    redrawPending = true;
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -313,6 +350,9 @@ void SMLayerScrolling<RGB, optionFlags>::setSpeed(unsigned char pixels_per_secon
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::setFont(fontChoices newFont) {
     scrollFont = fontLookup(newFont);
+    // the new font may cover fewer rows, clear all rows on the next redraw
+    majorScrollFontChange = true;
+    layoutScrollingText();
 }
 
 template <typename RGB, unsigned int optionFlags>
@@ -329,70 +369,27 @@ void SMLayerScrolling<RGB, optionFlags>::setStartOffsetFromLeft(int offset) {
 // if font size or position changed since the last call, redraw the whole frame
 template <typename RGB, unsigned int optionFlags>
 void SMLayerScrolling<RGB, optionFlags>::redrawScrollingText(void) {
-    int j, k;
-    int charPosition, textPosition;
-    uint16_t charY0, charY1;
-
-
-    for (j = 0; j < this->localHeight; j++) {
-
-        // skip rows without text
-        if (j < fontTopOffset || j >= fontTopOffset + scrollFont->Height)
-            continue;
-
-        // now in row with text
-        // find the position of the first char
-        charPosition = scrollPosition;
-        textPosition = 0;
-
-        // move to first character at least partially on screen
-        while (charPosition + scrollFont->Width < 0 ) {
-            charPosition += scrollFont->Width;
-            textPosition++;
-        }
-
-        // find rows within character bitmap that will be drawn (0-font->height unless text is partially off screen)
-        charY0 = j - fontTopOffset;
-
-        if (this->localHeight < fontTopOffset + scrollFont->Height) {
-            charY1 = this->localHeight - fontTopOffset;
-        } else {
-            charY1 = scrollFont->Height;
-        }
-
-        if(majorScrollFontChange) {
-            // clear full refresh buffer before copying background over, size or position may have changed, can't just clear rows used by font
-            memset(scrollingBitmap, 0x00, SCROLLING_BUFFER_SIZE);
-            majorScrollFontChange = false;
-        } else {
-            // clear rows used by font before drawing on top
-            for (k = 0; k < charY1 - charY0; k++)
-                memset(&scrollingBitmap[((j + k) * SCROLLING_BUFFER_ROW_SIZE)], 0x00, SCROLLING_BUFFER_ROW_SIZE);
+    int j;
+
+    if(majorScrollFontChange) {
+        // clear full refresh buffer before copying background over, size or position may have changed, can't just clear rows used by font
+        memset(scrollingBitmap, 0x00, SCROLLING_BUFFER_SIZE);
+        majorScrollFontChange = false;
+        this->dirtyRows = SM_ALL_ROWS_DIRTY;
+    } else {
+        // clear rows used by font before drawing on top
+        int rowStart = fontTopOffset > 0 ? fontTopOffset : 0;
+        int rowEnd = fontTopOffset + textRun.getHeight();
+        if (rowEnd > this->localHeight)
+            rowEnd = this->localHeight;
+
+        for (j = rowStart; j < rowEnd; j++) {
+            memset(&scrollingBitmap[j * SCROLLING_BUFFER_ROW_SIZE], 0x00, SCROLLING_BUFFER_ROW_SIZE);
+            this->dirtyRows |= this->getLocalRowDirtyMask(j);
         }
-
-        while (textPosition < textlen && charPosition < this->localWidth) {
-            uint8_t tempBitmask;
-            // draw character from top to bottom
-            for (k = charY0; k < charY1; k++) {
-                tempBitmask = getBitmapFontRowAtXY(text[textPosition], k, scrollFont);
-                //tempBitmask = 0xAA;
-                if (charPosition < 0) {
-                    scrollingBitmap[((j + k - charY0) * SCROLLING_BUFFER_ROW_SIZE) + 0] |= tempBitmask << -charPosition;
-                } else {
-                    scrollingBitmap[((j + k - charY0) * SCROLLING_BUFFER_ROW_SIZE) + (charPosition/8)] |= tempBitmask >> (charPosition%8);
-                    // do two writes if the shifted 8-bit wide bitmask is still on the screen
-                    if(charPosition + 8 < this->localWidth && charPosition % 8)
-                        scrollingBitmap[((j + k - charY0) * SCROLLING_BUFFER_ROW_SIZE) + (charPosition/8) + 1] |= tempBitmask << (8-(charPosition%8));
-                }
-            }
-
-            // get set up for next character
-            charPosition += scrollFont->Width;
-            textPosition++;
-        }
-
-        j += (charY1 - charY0) - 1;
     }
+
+    textRun.draw(scrollingBitmap, SCROLLING_BUFFER_ROW_SIZE, this->localWidth, this->localHeight, scrollPosition, fontTopOffset);
 }
 
 template <typename RGB, unsigned int optionFlags>
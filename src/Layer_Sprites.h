@@ -0,0 +1,107 @@
+/*
+ * SmartMatrix Library - Sprite Layer Class
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LAYER_SPRITES_H_
+#define _LAYER_SPRITES_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+#define SM_SPRITES_OPTIONS_NONE     0
+
+// sprites on a hardware row are kept as one bit per sprite, SMARTMATRIX_ALLOCATE_SPRITE_LAYER checks max_sprites against it
+#define SM_SPRITES_MAX_SPRITES      32
+
+// how a sprite's pixels are stored
+typedef enum spriteFormats {
+    spriteFormat1bpp,       // palette indexes, index 0 is transparent
+    spriteFormat4bpp,
+    spriteFormat8bpp,
+    spriteFormatRGB         // colors, transparent where they match the color key if it's enabled
+} spriteFormats;
+
+// indexed pixels are packed with the leftmost pixel in the most significant bits, and each row starts on a new byte
+template <typename RGB>
+struct SMSprite {
+    const void * pixels;
+    const RGB * palette;
+    int16_t x, y;
+    uint8_t width, height;
+    uint8_t format;
+    bool visible;
+    bool flipX, flipY;
+    bool colorKeyEnabled;
+    RGB colorKey;
+    // hardware rows the sprite is binned in, lastRow < firstRow if none
+    int16_t firstRow, lastRow;
+};
+
+// sprites drawn over the layers below without a framebuffer, each hardware row keeps a mask of the sprites that cross it
+// changes are taken in at the start of the next frame, where only the sprites that changed are binned again
+template <typename RGB, unsigned int optionFlags>
+class SMLayerSprites : public SM_Layer {
+    public:
+        SMLayerSprites(SMSprite<RGB> * sprites, uint32_t * rowSprites, uint8_t maxSprites, uint16_t width, uint16_t height);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]);
+        uint32_t getDirtyRows(void);
+
+        // sprites with higher numbers are drawn on top, and are hidden until showSprite()
+        // pixels and palette aren't copied, they're read every time a row is refreshed and need to stay in memory
+        // indexed formats need a palette with an entry for every index, without one the image isn't changed
+        void setSpriteImage(uint8_t sprite, spriteFormats format, uint8_t width, uint8_t height, const void * pixels,
+            const RGB * palette = NULL);
+        void setSpritePosition(uint8_t sprite, int16_t x, int16_t y);
+        void setSpriteFlip(uint8_t sprite, bool flipX, bool flipY);
+        void setSpriteColorKey(uint8_t sprite, bool enabled, const RGB & colorKey = RGB(0, 0, 0));
+        void showSprite(uint8_t sprite, bool visible);
+
+        void enableColorCorrection(bool enabled);
+
+    private:
+        template <typename RGB_OUT>
+        void fillSpritesRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[]);
+        static bool getSpritePixel(const SMSprite<RGB> & sprite, int16_t x, int16_t y, RGB & color);
+
+        void binSprite(uint8_t sprite);
+        void unbinSprite(uint8_t sprite);
+        void markChanged(uint8_t sprite);
+
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+
+        uint8_t maxSprites;
+        // sprites as the sketch sets them, and as they're shown
+        SMSprite<RGB> * pendingSprites;
+        SMSprite<RGB> * activeSprites;
+        // bit n of rowSprites[hardwareY] is set if sprite n crosses the row
+        uint32_t * rowSprites;
+        // pendingSprites that changed since the last frame
+        volatile uint32_t changedSprites = 0;
+        // rotation the sprites were binned for
+        uint8_t binnedRotation = 0xFF;
+};
+
+#include "Layer_Sprites_Impl.h"
+
+#endif
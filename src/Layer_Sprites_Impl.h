@@ -0,0 +1,271 @@
+/*
+ * SmartMatrix Library - Sprite Layer Class
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerSprites<RGB, optionFlags>::SMLayerSprites(SMSprite<RGB> * sprites, uint32_t * rowSprites, uint8_t maxSprites,
+  uint16_t width, uint16_t height) {
+    // sprites holds 2 * maxSprites, rowSprites holds height, maxSprites is at most SM_SPRITES_MAX_SPRITES
+    this->maxSprites = maxSprites;
+    pendingSprites = sprites;
+    activeSprites = &sprites[maxSprites];
+    this->rowSprites = rowSprites;
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+
+    for (int i = 0; i < 2 * maxSprites; i++) {
+        sprites[i].pixels = NULL;
+        sprites[i].visible = false;
+        sprites[i].flipX = false;
+        sprites[i].flipY = false;
+        sprites[i].colorKeyEnabled = false;
+        sprites[i].firstRow = 0;
+        sprites[i].lastRow = -1;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::frameRefreshCallback(void) {
+    uint32_t changed;
+    int i;
+
+    // rows depend on the rotation, which is only changed before this callback
+    if (binnedRotation != this->rotation) {
+        memset(rowSprites, 0x00, this->matrixHeight * sizeof(uint32_t));
+        for (i = 0; i < maxSprites; i++)
+            binSprite(i);
+
+        binnedRotation = this->rotation;
+        this->dirtyRows = SM_ALL_ROWS_DIRTY;
+    }
+
+    changed = changedSprites;
+    changedSprites = 0;
+
+    for (i = 0; changed; i++, changed >>= 1) {
+        if (!(changed & 1))
+            continue;
+
+        unbinSprite(i);
+        activeSprites[i] = pendingSprites[i];
+        binSprite(i);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+uint32_t SMLayerSprites<RGB, optionFlags>::getDirtyRows(void) {
+    return this->clearDirtyRows();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]) {
+    fillSpritesRefreshRow(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]) {
+    fillSpritesRefreshRow(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SMLayerSprites<RGB, optionFlags>::fillSpritesRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    uint32_t sprites = rowSprites[hardwareY];
+    int16_t position;
+    bool positionIsY, reversed;
+    RGB color;
+    int i, j;
+
+    if (!sprites)
+        return;
+
+    this->mapHardwareRow(hardwareY, position, positionIsY, reversed);
+
+    for (i = 0; sprites; i++, sprites >>= 1) {
+        if (!(sprites & 1))
+            continue;
+
+        const SMSprite<RGB> & sprite = activeSprites[i];
+
+        // the sprite's row (or column) on this hardware row, and the part of it on the layer
+        int16_t start = positionIsY ? sprite.x : sprite.y;
+        int16_t length = positionIsY ? sprite.width : sprite.height;
+        int16_t across = position - (positionIsY ? sprite.y : sprite.x);
+        int16_t end = (start + length > this->matrixWidth) ? this->matrixWidth - start : length;
+
+        for (j = (start < 0) ? -start : 0; j < end; j++) {
+            int16_t spriteX = positionIsY ? j : across;
+            int16_t spriteY = positionIsY ? across : j;
+
+            if (sprite.flipX)
+                spriteX = (sprite.width - 1) - spriteX;
+            if (sprite.flipY)
+                spriteY = (sprite.height - 1) - spriteY;
+
+            if (!getSpritePixel(sprite, spriteX, spriteY, color))
+                continue;
+
+            int16_t hardwareX = reversed ? (this->matrixWidth - 1) - (start + j) : start + j;
+
+            if (ccEnabled)
+                colorCorrection(color, refreshRow[hardwareX]);
+            else
+                refreshRow[hardwareX] = color;
+        }
+    }
+}
+
+// returns false if the pixel is transparent
+template <typename RGB, unsigned int optionFlags>
+bool SMLayerSprites<RGB, optionFlags>::getSpritePixel(const SMSprite<RGB> & sprite, int16_t x, int16_t y, RGB & color) {
+    if (sprite.format == spriteFormatRGB) {
+        color = ((const RGB *)sprite.pixels)[(y * sprite.width) + x];
+
+        return !(sprite.colorKeyEnabled && color.red == sprite.colorKey.red && color.green == sprite.colorKey.green &&
+            color.blue == sprite.colorKey.blue);
+    }
+
+    int bitsPerPixel = (sprite.format == spriteFormat1bpp) ? 1 : (sprite.format == spriteFormat4bpp) ? 4 : 8;
+    int rowSize = ((sprite.width * bitsPerPixel) + 7) / 8;
+    int bit = x * bitsPerPixel;
+    uint8_t index = (((const uint8_t *)sprite.pixels)[(y * rowSize) + (bit / 8)] >> ((8 - bitsPerPixel) - (bit % 8))) &
+        ((1 << bitsPerPixel) - 1);
+
+    // index 0 is transparent
+    if (!index)
+        return false;
+
+    color = sprite.palette[index];
+    return true;
+}
+
+// adds a sprite from activeSprites to the bins of the rows it crosses
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::binSprite(uint8_t sprite) {
+    SMSprite<RGB> & active = activeSprites[sprite];
+    int i;
+
+    // an indexed sprite without a palette would be read through a NULL pointer from the ISR, it's never binned
+    if (!active.visible || !active.pixels || (active.format != spriteFormatRGB && !active.palette)) {
+        active.firstRow = 0;
+        active.lastRow = -1;
+        return;
+    }
+
+    this->getHardwareRows(active.x, active.y, active.x + active.width - 1, active.y + active.height - 1, active.firstRow, active.lastRow);
+
+    for (i = active.firstRow; i <= active.lastRow; i++) {
+        rowSprites[i] |= (uint32_t)1 << sprite;
+        this->dirtyRows |= SM_DIRTY_ROW(i);
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::unbinSprite(uint8_t sprite) {
+    const SMSprite<RGB> & active = activeSprites[sprite];
+    int i;
+
+    for (i = active.firstRow; i <= active.lastRow; i++) {
+        rowSprites[i] &= ~((uint32_t)1 << sprite);
+        this->dirtyRows |= SM_DIRTY_ROW(i);
+    }
+}
+
+// called with interrupts disabled after changing pendingSprites, so refresh never takes a half updated sprite
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::markChanged(uint8_t sprite) {
+    changedSprites |= (uint32_t)1 << sprite;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpriteImage(uint8_t sprite, spriteFormats format, uint8_t width, uint8_t height,
+  const void * pixels, const RGB * palette) {
+    if (sprite >= maxSprites)
+        return;
+
+    // indexed formats read every color from the palette, an image without one is ignored
+    if (format != spriteFormatRGB && !palette)
+        return;
+
+    noInterrupts();
+    pendingSprites[sprite].format = format;
+    pendingSprites[sprite].width = width;
+    pendingSprites[sprite].height = height;
+    pendingSprites[sprite].pixels = pixels;
+    pendingSprites[sprite].palette = palette;
+    markChanged(sprite);
+    interrupts();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpritePosition(uint8_t sprite, int16_t x, int16_t y) {
+    if (sprite >= maxSprites)
+        return;
+
+    noInterrupts();
+    pendingSprites[sprite].x = x;
+    pendingSprites[sprite].y = y;
+    markChanged(sprite);
+    interrupts();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpriteFlip(uint8_t sprite, bool flipX, bool flipY) {
+    if (sprite >= maxSprites)
+        return;
+
+    noInterrupts();
+    pendingSprites[sprite].flipX = flipX;
+    pendingSprites[sprite].flipY = flipY;
+    markChanged(sprite);
+    interrupts();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::setSpriteColorKey(uint8_t sprite, bool enabled, const RGB & colorKey) {
+    if (sprite >= maxSprites)
+        return;
+
+    noInterrupts();
+    pendingSprites[sprite].colorKeyEnabled = enabled;
+    pendingSprites[sprite].colorKey = colorKey;
+    markChanged(sprite);
+    interrupts();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::showSprite(uint8_t sprite, bool visible) {
+    if (sprite >= maxSprites)
+        return;
+
+    noInterrupts();
+    pendingSprites[sprite].visible = visible;
+    markChanged(sprite);
+    interrupts();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerSprites<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    this->dirtyRows = SM_ALL_ROWS_DIRTY;
+}
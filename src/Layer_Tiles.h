@@ -0,0 +1,89 @@
+/*
+ * SmartMatrix Library - Tile Map Layer Class
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _LAYER_TILES_H_
+#define _LAYER_TILES_H_
+
+#include "Layer.h"
+#include "MatrixCommon.h"
+
+#define SM_TILES_OPTIONS_NONE       0
+
+// how tile pixels are stored
+typedef enum tileFormats {
+    tileFormat4bpp,         // palette indexes, index 0 is transparent
+    tileFormat8bpp,
+    tileFormatRGB           // colors, always opaque
+} tileFormats;
+
+// a canvas of mapWidth x mapHeight tiles, each tileSize x tileSize (8 or 16) pixels, shown through a window the size
+// of the layer that's moved with setScroll(), there's no framebuffer and scrolling doesn't redraw anything
+// tiles are stored one after the other, each tileSize rows from the top, indexed pixels are packed with the leftmost
+// pixel in the most significant bits
+template <typename RGB, unsigned int optionFlags>
+class SMLayerTiles : public SM_Layer {
+    public:
+        SMLayerTiles(uint8_t * tileMap, uint16_t mapWidth, uint16_t mapHeight, uint8_t tileSize, uint16_t width, uint16_t height);
+        void frameRefreshCallback();
+        void fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]);
+        void fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]);
+        uint32_t getDirtyRows(void);
+
+        // tiles and palette aren't copied, they're read every time a row is refreshed and need to stay in memory
+        void setTiles(tileFormats format, const void * tiles, const RGB * palette = NULL);
+        // tile is an index into tiles, the map starts out filled with tile 0
+        void setTile(uint16_t mapX, uint16_t mapY, uint8_t tile);
+        uint8_t getTile(uint16_t mapX, uint16_t mapY);
+        void fillTiles(uint8_t tile);
+
+        // canvas pixel shown at the layer's top left, the canvas wraps around in both directions
+        // the new position is shown from the next frame
+        void setScroll(int32_t x, int32_t y);
+        int32_t getScrollX(void);
+        int32_t getScrollY(void);
+
+        void enableColorCorrection(bool enabled);
+
+    private:
+        template <typename RGB_OUT>
+        void fillTilesRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[]);
+
+        bool ccEnabled = sizeof(RGB) <= 3 ? true : false;
+
+        uint8_t * tileMap;
+        uint16_t mapWidth, mapHeight;
+        uint8_t tileSize, tileShift;
+
+        tileFormats format = tileFormatRGB;
+        const void * tiles = NULL;
+        const RGB * palette = NULL;
+
+        // the sketch sets pendingScroll, refresh uses scroll
+        int32_t pendingScrollX = 0, pendingScrollY = 0;
+        int32_t scrollX = 0, scrollY = 0;
+        uint8_t lastRotation = 0xFF;
+};
+
+#include "Layer_Tiles_Impl.h"
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * SmartMatrix Library - Tile Map Layer Class
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+template <typename RGB, unsigned int optionFlags>
+SMLayerTiles<RGB, optionFlags>::SMLayerTiles(uint8_t * tileMap, uint16_t mapWidth, uint16_t mapHeight, uint8_t tileSize,
+  uint16_t width, uint16_t height) {
+    this->tileMap = tileMap;
+    this->mapWidth = mapWidth;
+    this->mapHeight = mapHeight;
+    this->tileSize = (tileSize == 16) ? 16 : 8;
+    this->tileShift = (tileSize == 16) ? 4 : 3;
+    this->matrixWidth = width;
+    this->matrixHeight = height;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTiles<RGB, optionFlags>::frameRefreshCallback(void) {
+    if (scrollX != pendingScrollX || scrollY != pendingScrollY || lastRotation != this->rotation) {
+        scrollX = pendingScrollX;
+        scrollY = pendingScrollY;
+        lastRotation = this->rotation;
+        this->dirtyRows = SM_ALL_ROWS_DIRTY;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+uint32_t SMLayerTiles<RGB, optionFlags>::getDirtyRows(void) {
+    return this->clearDirtyRows();
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTiles<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb48 refreshRow[]) {
+    fillTilesRefreshRow(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTiles<RGB, optionFlags>::fillRefreshRow(uint16_t hardwareY, rgb24 refreshRow[]) {
+    fillTilesRefreshRow(hardwareY, refreshRow);
+}
+
+template <typename RGB, unsigned int optionFlags> template <typename RGB_OUT>
+void SMLayerTiles<RGB, optionFlags>::fillTilesRefreshRow(uint16_t hardwareY, RGB_OUT refreshRow[]) {
+    int16_t position;
+    bool positionIsY, reversed;
+
+    if (!tiles)
+        return;
+
+    this->mapHardwareRow(hardwareY, position, positionIsY, reversed);
+
+    int32_t canvasWidth = (int32_t)mapWidth << tileShift;
+    int32_t canvasHeight = (int32_t)mapHeight << tileShift;
+    uint8_t tileMask = tileSize - 1;
+
+    // canvas coordinates of the first pixel along the hardware row
+    int32_t canvasX = (positionIsY ? scrollX : scrollX + position) % canvasWidth;
+    int32_t canvasY = (positionIsY ? scrollY + position : scrollY) % canvasHeight;
+    if (canvasX < 0)
+        canvasX += canvasWidth;
+    if (canvasY < 0)
+        canvasY += canvasHeight;
+
+    // walk along the hardware row a tile at a time, the coordinate across it stays the same
+    int32_t along = positionIsY ? canvasX : canvasY;
+    int32_t alongSize = positionIsY ? canvasWidth : canvasHeight;
+    int32_t across = positionIsY ? canvasY : canvasX;
+    uint16_t acrossTile = across >> tileShift;
+    uint8_t acrossPixel = across & tileMask;
+
+    int16_t hardwareX = reversed ? this->matrixWidth - 1 : 0;
+    int8_t hardwareStep = reversed ? -1 : 1;
+    int16_t remaining = this->matrixWidth;
+
+    while (remaining > 0) {
+        uint16_t alongTile = along >> tileShift;
+        uint8_t alongPixel = along & tileMask;
+        int16_t count = tileSize - alongPixel;
+        if (count > remaining)
+            count = remaining;
+
+        uint8_t tile = positionIsY ? tileMap[(acrossTile * mapWidth) + alongTile] : tileMap[(alongTile * mapWidth) + acrossTile];
+
+        // pixel index of the first pixel in tiles, and the step between pixels along the hardware row
+        int32_t pixel = ((int32_t)tile << (2 * tileShift)) +
+            (positionIsY ? (acrossPixel << tileShift) + alongPixel : (alongPixel << tileShift) + acrossPixel);
+        int32_t pixelStep = positionIsY ? 1 : tileSize;
+
+        if (format == tileFormatRGB) {
+            const RGB * src = &((const RGB *)tiles)[pixel];
+            for (int i = 0; i < count; i++, src += pixelStep, hardwareX += hardwareStep) {
+                if (ccEnabled)
+                    colorCorrection(*src, refreshRow[hardwareX]);
+                else
+                    refreshRow[hardwareX] = *src;
+            }
+        } else {
+            for (int i = 0; i < count; i++, pixel += pixelStep, hardwareX += hardwareStep) {
+                uint8_t index;
+                if (format == tileFormat8bpp)
+                    index = ((const uint8_t *)tiles)[pixel];
+                else
+                    index = (((const uint8_t *)tiles)[pixel / 2] >> ((pixel & 1) ? 0 : 4)) & 0x0F;
+
+                // index 0 is transparent
+                if (!index)
+                    continue;
+
+                if (ccEnabled)
+                    colorCorrection(palette[index], refreshRow[hardwareX]);
+                else
+                    refreshRow[hardwareX] = palette[index];
+            }
+        }
+
+        remaining -= count;
+        along += count;
+        if (along >= alongSize)
+            along = 0;
+    }
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTiles<RGB, optionFlags>::setTiles(tileFormats format, const void * tiles, const RGB * palette) {
+    noInterrupts();
+    this->format = format;
+    this->tiles = tiles;
+    this->palette = palette;
+    interrupts();
+    this->dirtyRows = SM_ALL_ROWS_DIRTY;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTiles<RGB, optionFlags>::setTile(uint16_t mapX, uint16_t mapY, uint8_t tile) {
+    if (mapX >= mapWidth || mapY >= mapHeight)
+        return;
+
+    tileMap[(mapY * mapWidth) + mapX] = tile;
+    this->dirtyRows = SM_ALL_ROWS_DIRTY;
+}
+
+template <typename RGB, unsigned int optionFlags>
+uint8_t SMLayerTiles<RGB, optionFlags>::getTile(uint16_t mapX, uint16_t mapY) {
+    if (mapX >= mapWidth || mapY >= mapHeight)
+        return 0;
+
+    return tileMap[(mapY * mapWidth) + mapX];
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTiles<RGB, optionFlags>::fillTiles(uint8_t tile) {
+    memset(tileMap, tile, mapWidth * mapHeight);
+    this->dirtyRows = SM_ALL_ROWS_DIRTY;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTiles<RGB, optionFlags>::setScroll(int32_t x, int32_t y) {
+    noInterrupts();
+    pendingScrollX = x;
+    pendingScrollY = y;
+    interrupts();
+}
+
+template <typename RGB, unsigned int optionFlags>
+int32_t SMLayerTiles<RGB, optionFlags>::getScrollX(void) {
+    return pendingScrollX;
+}
+
+template <typename RGB, unsigned int optionFlags>
+int32_t SMLayerTiles<RGB, optionFlags>::getScrollY(void) {
+    return pendingScrollY;
+}
+
+template <typename RGB, unsigned int optionFlags>
+void SMLayerTiles<RGB, optionFlags>::enableColorCorrection(bool enabled) {
+    this->ccEnabled = sizeof(RGB) <= 3 ? enabled : false;
+    this->dirtyRows = SM_ALL_ROWS_DIRTY;
+}
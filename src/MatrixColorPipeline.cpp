@@ -0,0 +1,92 @@
+/*
+ * SmartMatrix Library - Color Correction Pipeline
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "SmartMatrix3.h"
+
+void SMColorPipeline::setBrightness(uint8_t newBrightness) {
+    if (brightness == newBrightness)
+        return;
+
+    brightness = newBrightness;
+    tablesStale = true;
+}
+
+void SMColorPipeline::setWhitePoint(const rgb24 & newWhitePoint) {
+    if (whitePoint.red == newWhitePoint.red && whitePoint.green == newWhitePoint.green && whitePoint.blue == newWhitePoint.blue)
+        return;
+
+    whitePoint = newWhitePoint;
+    tablesStale = true;
+}
+
+void SMColorPipeline::setChannelBits(uint8_t newChannelBits) {
+    if (newChannelBits > 16)
+        newChannelBits = 16;
+
+    if (channelBits == newChannelBits)
+        return;
+
+    channelBits = newChannelBits;
+    tablesStale = true;
+}
+
+uint8_t SMColorPipeline::getBrightness(void) const {
+    return brightness;
+}
+
+rgb24 SMColorPipeline::getWhitePoint(void) const {
+    // rgb24 has a user-declared copy assignment, so build the copy instead of relying on the implicit copy constructor
+    return rgb24(whitePoint.red, whitePoint.green, whitePoint.blue);
+}
+
+bool SMColorPipeline::update(void) {
+    int i, j;
+
+    if (!tablesStale)
+        return false;
+
+    // clear first, a parameter changed while rebuilding marks the tables stale again for the next call
+    tablesStale = false;
+
+    const uint8_t white[3] = { whitePoint.red, whitePoint.green, whitePoint.blue };
+    const uint8_t shift = 16 - channelBits;
+    const uint32_t maxValue = 0xFFFF & ~((1 << shift) - 1);
+
+    for (j = 0; j < 3; j++) {
+        for (i = 0; i < 256; i++) {
+            uint32_t value = (lightPowerMap16bit[i] * brightness) / 256;
+            value = (value * (white[j] + 1)) / 256;
+
+            // round to the nearest value the refresh can show instead of truncating when packing
+            if (shift) {
+                value = ((value + (1 << (shift - 1))) >> shift) << shift;
+                if (value > maxValue)
+                    value = maxValue;
+            }
+
+            lut[j][i] = value;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * SmartMatrix Library - Color Correction Pipeline
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _MATRIX_COLOR_PIPELINE_H_
+#define _MATRIX_COLOR_PIPELINE_H_
+
+#include "MatrixCommon.h"
+
+// per-channel tables that fuse gamma (lightPowerMap16bit), brightness, and white point into one lookup per channel
+// setters only mark the tables stale, update() rebuilds them at most once per call so parameters can change at any time
+class SMColorPipeline {
+    public:
+        void setBrightness(uint8_t newBrightness);
+        void setWhitePoint(const rgb24 & newWhitePoint);
+        // significant bits per channel in the refresh (refreshDepth/3), table values are rounded to this many bits
+        // so the bits dropped when the refresh row is packed are always zero
+        void setChannelBits(uint8_t newChannelBits);
+
+        uint8_t getBrightness(void) const;
+        rgb24 getWhitePoint(void) const;
+
+        // rebuilds the tables if a parameter changed since the last call, returns true if they were rebuilt
+        bool update(void);
+
+        template <typename RGB_IN>
+        void correct(const RGB_IN & in, rgb48 & out) const {
+            out = rgb48(lut[0][in.red], lut[1][in.green], lut[2][in.blue]);
+        }
+
+        template <typename RGB_IN>
+        void correct(const RGB_IN & in, rgb24 & out) const {
+            out = rgb24(lut[0][in.red] >> 8, lut[1][in.green] >> 8, lut[2][in.blue] >> 8);
+        }
+
+    private:
+        color_chan_t lut[3][256];
+
+        uint8_t brightness = 255;
+        rgb24 whitePoint = rgb24(255, 255, 255);
+        uint8_t channelBits = 16;
+        volatile bool tablesStale = true;
+};
+
+#endif
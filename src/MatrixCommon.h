@@ -25,6 +25,7 @@
 #define _MATRIX_COMMON_H_
 
 #include <stdint.h>
+#include <string.h>
 
 #ifdef ARDUINO_ARCH_AVR
 #include "Arduino.h"
@@ -196,19 +197,6 @@ static const uint8_t lightPowerMap4bit[256] = {
     0x0e, 0x0e, 0x0e, 0x0e, 0x0f, 0x0f, 0x0f, 0x0f
 };
 
-inline void calculateBackgroundLUT(color_chan_t * lut, uint8_t backgroundBrightness) {
-    // update background table
-    for(int i=0; i<256; i++) {
-//#if COLOR_DEPTH_RGB > 24
-        lut[i] = (lightPowerMap16bit[i] * backgroundBrightness) / 256;
-//#else
-//        lut[i] = (lightPowerMap8bit[i] * backgroundBrightness) / 256;
-//#endif
-    }
-}
-
-
-
 template <typename RGB_IN>
 void colorCorrection(const RGB_IN& in, rgb48& out) {
     out = rgb48(lightPowerMap16bit[in.red],
@@ -218,12 +206,51 @@ void colorCorrection(const RGB_IN& in, rgb48& out) {
 
 template <typename RGB_IN>
 void colorCorrection(const RGB_IN& in, rgb24& out) {
-    out = rgb24(lightPowerMap16bit[in.red],
-                lightPowerMap16bit[in.green],
-                lightPowerMap16bit[in.blue]);
+    out = rgb24(lightPowerMap16bit[in.red] >> 8,
+                lightPowerMap16bit[in.green] >> 8,
+                lightPowerMap16bit[in.blue] >> 8);
 }
 
-void calculateBackgroundLUT(color_chan_t * lut, uint8_t backgroundBrightness);
+// 32-bit stores into RGB buffers
+typedef uint32_t __attribute__((__may_alias__)) aliasedWord;
+
+// writes count copies of color starting at dest, with aligned 32-bit stores for most of the span
+// 12 bytes holds a whole number of rgb24 (4) or rgb48 (2) pixels, so once dest is word aligned the same three words repeat
+template <typename RGB>
+inline void fillPixelSpan(RGB *dest, uint16_t count, const RGB& color) {
+    const uint8_t pixelsPerPattern = 12 / sizeof(RGB);
+
+    if (!(12 % sizeof(RGB))) {
+        // one pixel at a time until dest is word aligned, at most 3 rgb24 or 1 rgb48 pixel
+        while (count && ((uintptr_t)dest & 3)) {
+            *dest++ = color;
+            count--;
+        }
+
+        if (count >= pixelsPerPattern) {
+            RGB patternPixels[12 / sizeof(RGB)];
+            uint32_t pattern[3];
+
+            for (int i = 0; i < pixelsPerPattern; i++)
+                patternPixels[i] = color;
+            memcpy(pattern, patternPixels, sizeof(pattern));
+
+            aliasedWord *words = (aliasedWord *)dest;
+            for (uint16_t i = count / pixelsPerPattern; i > 0; i--) {
+                words[0] = pattern[0];
+                words[1] = pattern[1];
+                words[2] = pattern[2];
+                words += 3;
+            }
+
+            dest = (RGB *)words;
+            count %= pixelsPerPattern;
+        }
+    }
+
+    while (count--)
+        *dest++ = color;
+}
 
 // config
 typedef enum rotationDegrees {
@@ -233,4 +260,11 @@ typedef enum rotationDegrees {
     rotation270
 } rotationDegrees;
 
+// how a layer's pixels are combined with the layers below it
+typedef enum blendModes {
+    blendNormal,        // alpha blend by layer opacity
+    blendAdditive,      // add layer color scaled by opacity, saturating
+    blendMultiply       // multiply by layer color, mixed in by opacity
+} blendModes;
+
 #endif
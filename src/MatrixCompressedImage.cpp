@@ -0,0 +1,80 @@
+/*
+ * SmartMatrix Library - Compressed Images
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SmartMatrix3.h"
+
+SMCompressedImage::SMCompressedImage(const uint8_t * image, uint32_t length) {
+    uint32_t headerLength = 7;
+
+    if (!image || length < headerLength || image[0] != 'S' || image[1] != 'M' || (image[2] & ~SM_COMPRESSED_IMAGE_PALETTE))
+        return;
+
+    width = image[3] | (image[4] << 8);
+    height = image[5] | (image[6] << 8);
+
+    if (image[2] & SM_COMPRESSED_IMAGE_PALETTE) {
+        // the palette size byte and the whole palette have to fit
+        if (length < headerLength + 1)
+            return;
+
+        paletteSize = image[7] + 1;
+        palette = &image[8];
+        headerLength += 1 + (paletteSize * 3);
+
+        if (length < headerLength)
+            return;
+    }
+
+    packets = &image[headerLength];
+    packetBytes = length - headerLength;
+    valid = true;
+}
+
+bool SMCompressedImage::isValid(void) const {
+    return valid;
+}
+
+uint16_t SMCompressedImage::getWidth(void) const {
+    return width;
+}
+
+uint16_t SMCompressedImage::getHeight(void) const {
+    return height;
+}
+
+const uint8_t * SMCompressedImage::getPalette(void) const {
+    return palette;
+}
+
+uint16_t SMCompressedImage::getPaletteSize(void) const {
+    return paletteSize;
+}
+
+const uint8_t * SMCompressedImage::getPackets(void) const {
+    return packets;
+}
+
+uint32_t SMCompressedImage::getPacketBytes(void) const {
+    return packetBytes;
+}
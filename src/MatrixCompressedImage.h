@@ -0,0 +1,68 @@
+/*
+ * SmartMatrix Library - Compressed Images
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _MATRIX_COMPRESSED_IMAGE_H_
+#define _MATRIX_COMPRESSED_IMAGE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// run length encoded image, made from a GIMP C source dump or an image file by extras/ImageEncoder/encodeImage.py
+//   header: 'S', 'M', flags, width and height (16 bit little endian)
+//   with SM_COMPRESSED_IMAGE_PALETTE set: palette size - 1, then the palette (3 bytes red, green, blue per color)
+//   packets: count byte n, if n & 0x80 one pixel repeated (n & 0x7F) + 1 times, otherwise n + 1 different pixels
+//   pixels: a palette index, or 3 bytes red, green, blue
+// packets cover width * height pixels in rows from the top left and can continue from one row onto the next
+#define SM_COMPRESSED_IMAGE_PALETTE     0x01
+
+#define SM_COMPRESSED_IMAGE_RUN         0x80
+#define SM_COMPRESSED_IMAGE_MAX_COUNT   128
+
+class SMCompressedImage {
+    public:
+        // image isn't copied, it's read when the image is drawn and needs to stay in memory
+        // length is the size of image in bytes, e.g. sizeof() the array written by encodeImage.py
+        SMCompressedImage(const uint8_t * image, uint32_t length);
+
+        // false if image doesn't start with a compressed image header that fits in length
+        bool isValid(void) const;
+        uint16_t getWidth(void) const;
+        uint16_t getHeight(void) const;
+        // 3 bytes per color, NULL if pixels are stored as colors
+        const uint8_t * getPalette(void) const;
+        uint16_t getPaletteSize(void) const;
+        const uint8_t * getPackets(void) const;
+        // bytes from getPackets() to the end of the image
+        uint32_t getPacketBytes(void) const;
+
+    private:
+        bool valid = false;
+        uint16_t width = 0;
+        uint16_t height = 0;
+        const uint8_t * palette = NULL;
+        uint16_t paletteSize = 0;
+        const uint8_t * packets = NULL;
+        uint32_t packetBytes = 0;
+};
+
+#endif
@@ -0,0 +1,155 @@
+/*
+ * SmartMatrix Library - Damage Region
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "SmartMatrix3.h"
+
+static uint32_t rectArea(const damageRect & rect) {
+    return (uint32_t)(rect.x1 - rect.x0 + 1) * (rect.y1 - rect.y0 + 1);
+}
+
+static damageRect rectUnion(const damageRect & a, const damageRect & b) {
+    damageRect result;
+    result.x0 = a.x0 < b.x0 ? a.x0 : b.x0;
+    result.y0 = a.y0 < b.y0 ? a.y0 : b.y0;
+    result.x1 = a.x1 > b.x1 ? a.x1 : b.x1;
+    result.y1 = a.y1 > b.y1 ? a.y1 : b.y1;
+    return result;
+}
+
+static bool rectsOverlap(const damageRect & a, const damageRect & b) {
+    return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+
+static bool rectContains(const damageRect & outer, const damageRect & inner) {
+    return inner.x0 >= outer.x0 && inner.x1 <= outer.x1 && inner.y0 >= outer.y0 && inner.y1 <= outer.y1;
+}
+
+SMDamageRegion::SMDamageRegion() {
+    clear();
+}
+
+void SMDamageRegion::clear(void) {
+    numRects = 0;
+    lastRect = 0;
+}
+
+void SMDamageRegion::add(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    damageRect rect;
+    rect.x0 = x0 < x1 ? x0 : x1;
+    rect.x1 = x0 < x1 ? x1 : x0;
+    rect.y0 = y0 < y1 ? y0 : y1;
+    rect.y1 = y0 < y1 ? y1 : y0;
+    add(rect);
+}
+
+void SMDamageRegion::add(const damageRect & rect) {
+    int i;
+    uint32_t area = rectArea(rect);
+    uint8_t bestIndex = 0;
+    uint32_t bestGrowth = 0xFFFFFFFF;
+
+    if (numRects) {
+        damageRect & last = rects[lastRect];
+        if (rect.x1 + SM_DAMAGE_REGION_GAP >= last.x0 && rect.x0 <= last.x1 + SM_DAMAGE_REGION_GAP &&
+            rect.y1 + SM_DAMAGE_REGION_GAP >= last.y0 && rect.y0 <= last.y1 + SM_DAMAGE_REGION_GAP) {
+            last = rectUnion(last, rect);
+            return;
+        }
+    }
+
+    for (i = 0; i < numRects; i++) {
+        if (rectContains(rects[i], rect)) {
+            lastRect = i;
+            return;
+        }
+
+        // pixels covered by the merged rect that neither rect covered (counting overlapping pixels once is close enough)
+        uint32_t mergedArea = rectArea(rectUnion(rects[i], rect));
+        uint32_t currentArea = rectArea(rects[i]);
+        uint32_t growth = mergedArea - currentArea;
+        uint32_t waste = growth > area ? growth - area : 0;
+
+        // overlapping rects are always merged so no pixel is covered twice, touching rects if nothing extra is covered
+        if (!waste || rectsOverlap(rects[i], rect)) {
+            merge(i, rect);
+            return;
+        }
+
+        if (growth < bestGrowth) {
+            bestGrowth = growth;
+            bestIndex = i;
+        }
+    }
+
+    if (numRects < SM_DAMAGE_REGION_MAX_RECTS) {
+        rects[numRects] = rect;
+        lastRect = numRects++;
+        return;
+    }
+
+    merge(bestIndex, rect);
+}
+
+// grows rects[index] to cover rect too, then absorbs any other rects the larger rect now overlaps
+void SMDamageRegion::merge(uint8_t index, const damageRect & rect) {
+    int i;
+
+    rects[index] = rectUnion(rects[index], rect);
+
+    for (i = 0; i < numRects; i++) {
+        if (i == index || !rectsOverlap(rects[i], rects[index]))
+            continue;
+
+        rects[index] = rectUnion(rects[index], rects[i]);
+
+        // remove rects[i] by moving the last rect into its place, and start over as the merged rect grew again
+        numRects--;
+        rects[i] = rects[numRects];
+        if (index == numRects)
+            index = i;
+        i = -1;
+    }
+
+    lastRect = index;
+}
+
+bool SMDamageRegion::isEmpty(void) const {
+    return !numRects;
+}
+
+uint8_t SMDamageRegion::getRectCount(void) const {
+    return numRects;
+}
+
+const damageRect & SMDamageRegion::getRect(uint8_t index) const {
+    return rects[index];
+}
+
+uint32_t SMDamageRegion::getArea(void) const {
+    uint32_t area = 0;
+
+    for (int i = 0; i < numRects; i++)
+        area += rectArea(rects[i]);
+
+    return area;
+}
@@ -0,0 +1,86 @@
+/*
+ * SmartMatrix Library - Damage Region
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _MATRIX_DAMAGE_REGION_H_
+#define _MATRIX_DAMAGE_REGION_H_
+
+#include <stdint.h>
+
+// more rects follow the shape of scattered changes more closely, but make each add() slower
+#define SM_DAMAGE_REGION_MAX_RECTS  4
+// areas this close to the rect that grew last join it without checking the other rects
+#define SM_DAMAGE_REGION_GAP        4
+
+// inclusive pixel coordinates
+typedef struct damageRect {
+    uint16_t x0;
+    uint16_t y0;
+    uint16_t x1;
+    uint16_t y1;
+} damageRect;
+
+// area that changed, kept as a few rects that together cover every pixel passed to add()
+// new areas next to the rect that grew last join it, then rects that overlap or can be joined without covering extra
+// pixels are merged, when all rects are in use the new area is merged into the rect that grows the least,
+// so the region can cover more than what was added but never less
+// growing the last rect doesn't check the other rects, so rects can overlap and getArea() can count pixels twice
+class SMDamageRegion {
+    public:
+        SMDamageRegion();
+
+        void clear(void);
+        void add(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+        void add(const damageRect & rect);
+
+        inline void addPixel(uint16_t x, uint16_t y) {
+            // most pixels land in or next to the rect that grew last, e.g. lines, circles, and text
+            if (numRects) {
+                damageRect & last = rects[lastRect];
+                if (x + SM_DAMAGE_REGION_GAP >= last.x0 && x <= last.x1 + SM_DAMAGE_REGION_GAP &&
+                    y + SM_DAMAGE_REGION_GAP >= last.y0 && y <= last.y1 + SM_DAMAGE_REGION_GAP) {
+                    if (x < last.x0) last.x0 = x;
+                    if (x > last.x1) last.x1 = x;
+                    if (y < last.y0) last.y0 = y;
+                    if (y > last.y1) last.y1 = y;
+                    return;
+                }
+            }
+
+            add(x, y, x, y);
+        }
+
+        bool isEmpty(void) const;
+        uint8_t getRectCount(void) const;
+        const damageRect & getRect(uint8_t index) const;
+        // pixels covered by the region
+        uint32_t getArea(void) const;
+
+    private:
+        void merge(uint8_t index, const damageRect & rect);
+
+        damageRect rects[SM_DAMAGE_REGION_MAX_RECTS];
+        uint8_t numRects;
+        uint8_t lastRect;
+};
+
+#endif
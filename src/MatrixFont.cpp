@@ -24,27 +24,26 @@
 #include "SmartMatrix3.h"
 
 // depends on letters in font->Index table being arranged in ascending order
-// save location of last lookup to speed up repeated lookups of the same letter
-// TODO: use successive approximation to located index faster
+// fonts with a Lookup table resolve in one step, others fall back to a binary search
+// no state is kept between calls, so lookups are safe from both the ISR and the sketch
 int getBitmapFontLocation(unsigned char letter, const bitmap_font *font) {
-    static int location = 0;
-
-    if(location < 0)
-        location = 0;
-
-    if(font->Index[location] == letter)
-        return location;
-
-    if(font->Index[location] < letter) {
-        for (; location < font->Chars; location++) {
-            if (font->Index[location] == letter)
-                return location;
-        }
-    } else {
-        for (; location >= 0; location--) {
-            if (font->Index[location] == letter)
-                return location;
-        }
+    if (font->Lookup) {
+        int location = font->Lookup[letter];
+        if (location < font->Chars && font->Index[location] == letter)
+            return location;
+        return -1;
+    }
+
+    int low = 0;
+    int high = font->Chars - 1;
+    while (low <= high) {
+        int location = (low + high) / 2;
+        if (font->Index[location] == letter)
+            return location;
+        if (font->Index[location] < letter)
+            low = location + 1;
+        else
+            high = location - 1;
     }
 
     return -1;
@@ -80,6 +79,42 @@ uint16_t getBitmapFontRowAtXY(unsigned char letter, unsigned char y, const bitma
     return(font->Bitmap[(location * font->Height) + y]);
 }
 
+// returns how far to move right after drawing letter, Width for fixed spacing
+// proportional spacing uses font->Widths if the font has it, otherwise the columns with pixels set plus one blank column,
+// firstColumn is set to the first of those columns so the glyph can be drawn shifted left
+uint8_t getBitmapFontCharAdvance(unsigned char letter, const bitmap_font *font, bool proportional, uint8_t *firstColumn) {
+    int location;
+    uint8_t columns = 0;
+
+    if (firstColumn)
+        *firstColumn = 0;
+
+    if (!proportional)
+        return font->Width;
+
+    location = getBitmapFontLocation(letter, font);
+
+    if (location >= 0 && font->Widths)
+        return font->Widths[location];
+
+    if (location >= 0) {
+        for (int y = 0; y < font->Height; y++)
+            columns |= font->Bitmap[(location * font->Height) + y];
+    }
+
+    // blank and missing characters (e.g. space) get half the font width
+    if (!columns)
+        return (font->Width / 2) + 1;
+
+    uint8_t first = __builtin_clz(columns) - 24;
+    uint8_t last = 7 - __builtin_ctz(columns);
+
+    if (firstColumn)
+        *firstColumn = first;
+
+    return (last - first) + 2;
+}
+
 // order needs to match fontChoices enum
 static const bitmap_font *fontArray[] = {
     &apple3x5,
@@ -35,6 +35,7 @@ typedef struct bitmap_font {
 	const unsigned char *Widths;	///< width of each character
 	const unsigned short *Index;	///< encoding to character index
 	const unsigned char *Bitmap;	///< bitmap of all characters
+	const unsigned char *Lookup;	///< 8-bit encoding to character index (optional)
 } bitmap_font;
 
 
@@ -54,9 +55,11 @@ typedef enum fontChoices {
     gohufont11b
 } fontChoices;
 
+int getBitmapFontLocation(unsigned char letter, const bitmap_font *font);
 bool getBitmapFontPixelAtXY(unsigned char letter, unsigned char x, unsigned char y, const bitmap_font *font);
 const bitmap_font *fontLookup(fontChoices font);
 uint16_t getBitmapFontRowAtXY(unsigned char letter, unsigned char y, const bitmap_font *font);
+uint8_t getBitmapFontCharAdvance(unsigned char letter, const bitmap_font *font, bool proportional, uint8_t *firstColumn);
 
 /// @{ defines to have human readable font files
 #define ________ 0x00
@@ -0,0 +1,141 @@
+/*
+ * SmartMatrix Library - Rasterized Text Runs
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SmartMatrix3.h"
+#include <string.h>
+
+SMGlyphRun::SMGlyphRun(uint8_t * bitmap, uint16_t bitmapSize) {
+    runBitmap = bitmap;
+    runBitmapSize = bitmapSize;
+}
+
+uint16_t SMGlyphRun::layout(const char text[], const bitmap_font *font, bool proportional) {
+    return layout(text, strlen(text), font, proportional);
+}
+
+uint16_t SMGlyphRun::layout(const char text[], uint16_t length, const bitmap_font *font, bool proportional) {
+    int i, j;
+    uint32_t width = 0;
+
+    for (i = 0; i < length; i++)
+        width += getBitmapFontCharAdvance(text[i], font, proportional, NULL);
+
+    runHeight = font->Height;
+    runRowSize = (width + 7) / 8;
+
+    // cut the run off at a byte boundary if it doesn't fit
+    if (runHeight && runRowSize * runHeight > runBitmapSize) {
+        runRowSize = runBitmapSize / runHeight;
+        width = runRowSize * 8;
+    }
+    runWidth = width;
+
+    memset(runBitmap, 0x00, runRowSize * runHeight);
+
+    int position = 0;
+    for (i = 0; i < length && position < runWidth; i++) {
+        uint8_t firstColumn;
+        uint8_t advance = getBitmapFontCharAdvance(text[i], font, proportional, &firstColumn);
+        int location = getBitmapFontLocation(text[i], font);
+
+        if (location >= 0) {
+            const unsigned char * glyph = &font->Bitmap[location * font->Height];
+            uint8_t * column = &runBitmap[position / 8];
+
+            for (j = 0; j < runHeight; j++) {
+                uint8_t glyphRow = glyph[j] << firstColumn;
+
+                column[0] |= glyphRow >> (position % 8);
+                if (position % 8 && (position / 8) + 1 < runRowSize)
+                    column[1] |= glyphRow << (8 - (position % 8));
+                column += runRowSize;
+            }
+        }
+
+        position += advance;
+    }
+
+    return runWidth;
+}
+
+uint16_t SMGlyphRun::getWidth(void) const {
+    return runWidth;
+}
+
+uint8_t SMGlyphRun::getHeight(void) const {
+    return runHeight;
+}
+
+bool SMGlyphRun::getPixel(int16_t x, int16_t y) const {
+    if (x < 0 || x >= runWidth || y < 0 || y >= runHeight)
+        return false;
+
+    return runBitmap[(y * runRowSize) + (x / 8)] & (0x80 >> (x % 8));
+}
+
+uint8_t SMGlyphRun::getByte(int16_t x, int16_t y) const {
+    if (y < 0 || y >= runHeight || x <= -8 || x >= runWidth)
+        return 0x00;
+
+    // combine the two run bytes the eight pixels fall in, columns before the start of the run read as zero
+    const uint8_t * row = &runBitmap[y * runRowSize];
+    int index = (x < 0) ? -1 : x / 8;
+    int shift = x - (index * 8);
+    uint16_t pixels = 0;
+
+    if (index >= 0)
+        pixels = row[index] << 8;
+    if (index + 1 < runRowSize)
+        pixels |= row[index + 1];
+
+    return (pixels << shift) >> 8;
+}
+
+void SMGlyphRun::draw(uint8_t * bitmap, uint16_t rowSize, uint16_t width, uint16_t height, int16_t x, int16_t y) const {
+    int start = (x > 0) ? x : 0;
+    int end = x + runWidth;
+    if (end > width)
+        end = width;
+    if (start >= end)
+        return;
+
+    for (int j = 0; j < runHeight; j++) {
+        if (y + j < 0)
+            continue;
+        if (y + j >= height)
+            break;
+
+        uint8_t * row = &bitmap[(y + j) * rowSize];
+
+        for (int i = start & ~0x07; i < end; i += 8) {
+            uint8_t pixels = getByte(i - x, j);
+
+            if (i < start)
+                pixels &= 0xFF >> (start - i);
+            if (i + 8 > end)
+                pixels &= 0xFF << (i + 8 - end);
+
+            row[i / 8] |= pixels;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * SmartMatrix Library - Rasterized Text Runs
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _MATRIX_GLYPH_RUN_H_
+#define _MATRIX_GLYPH_RUN_H_
+
+#include <stdint.h>
+#include "MatrixFontCommon.h"
+
+// a string rasterized once into a 1 bit per pixel bitmap, font->Height rows of getWidth() pixels
+// leftmost pixel of each byte is the MSB, matching the scrolling and indexed layer bitmaps
+class SMGlyphRun {
+    public:
+        SMGlyphRun(uint8_t * bitmap, uint16_t bitmapSize);
+
+        // returns the width of the run, text that doesn't fit in the bitmap is cut off
+        uint16_t layout(const char text[], const bitmap_font *font, bool proportional);
+        uint16_t layout(const char text[], uint16_t length, const bitmap_font *font, bool proportional);
+
+        uint16_t getWidth(void) const;
+        uint8_t getHeight(void) const;
+        bool getPixel(int16_t x, int16_t y) const;
+        // eight pixels of row y starting at column x, pixels outside the run are zero
+        uint8_t getByte(int16_t x, int16_t y) const;
+
+        // sets the run's pixels in a 1 bit per pixel bitmap with x,y as the top left, clipped to width and height
+        void draw(uint8_t * bitmap, uint16_t rowSize, uint16_t width, uint16_t height, int16_t x, int16_t y) const;
+
+    private:
+        uint8_t * runBitmap;
+        uint16_t runBitmapSize;
+        uint16_t runRowSize = 0;
+        uint16_t runWidth = 0;
+        uint8_t runHeight = 0;
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * SmartMatrix Library - Hardware-Specific Header File (for host simulation)
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+ // Note: only one MatrixHardware_*.h file should be included per project
+
+#ifndef MATRIX_HARDWARE_H
+#define MATRIX_HARDWARE_H
+
+// the host simulation mirrors the SmartMatrix Shield V4 layout: address is shifted out on the data pins before the latch
+#define COLOR_CHANNELS_PER_PIXEL        3
+#define DMA_UPDATES_PER_CLOCK           2
+#define ADDX_UPDATE_BEFORE_LATCH_BYTES  1
+#define ADDX_UPDATE_ON_DATA_PINS
+
+// timer math is done with the clocks of a Teensy 3.2 at the default 96MHz, override to simulate other speeds
+#ifndef F_CPU
+#define F_CPU   96000000
+#endif
+#ifndef F_BUS
+#define F_BUS   48000000
+#endif
+
+/* an advanced user may need to tweak these values */
+
+// size of latch pulse - all address updates must fit inside high portion of latch pulse
+#define LATCH_TIMER_PULSE_WIDTH_NS  438
+
+// max delay from rising edge of latch pulse to falling edge of clock
+#define LATCH_TO_CLK_DELAY_NS       1400
+
+// same estimate used for Teensy with DMA Bandwidth Control enabled, keeps simulated timer values identical to hardware
+#define PANEL_32_PIXELDATA_TRANSFER_MAXIMUM_NS  (uint32_t)((2 * 3400 * 96000000.0) / F_CPU)
+
+/* this section describes how the simulated GPIO port is attached to the display */
+
+// defines data bit order from bit 0-7, four times to fit in uint32_t
+#define GPIO_WORD_ORDER p0r1:1, p0clk:1, p0pad:1, p0g2:1, p0b1:1, p0b2:1, p0r2:1, p0g1:1, \
+    p1r1:1, p1clk:1, p1pad:1, p1g2:1, p1b1:1, p1b2:1, p1r2:1, p1g1:1, \
+    p2r1:1, p2clk:1, p2pad:1, p2g2:1, p2b1:1, p2b2:1, p2r2:1, p2g1:1, \
+    p3r1:1, p3clk:1, p3pad:1, p3g2:1, p3b1:1, p3b2:1, p3r2:1, p3g1:1
+
+#endif
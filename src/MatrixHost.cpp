@@ -0,0 +1,197 @@
+/*
+ * SmartMatrix Library - Host (Linux) Build Support
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef SMARTMATRIX_HOST_BUILD
+
+#include <time.h>
+
+#include "SmartMatrix3.h"
+
+#define FNV_OFFSET_BASIS    2166136261u
+#define FNV_PRIME           16777619u
+
+SMHostRefresh smHostRefresh;
+
+static uint64_t monotonicMicros(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+uint32_t millis(void) {
+    return monotonicMicros() / 1000;
+}
+
+uint32_t micros(void) {
+    return monotonicMicros();
+}
+
+void SMHostRefresh::begin(uint8_t latchesPerRow, uint16_t bytesPerLatch, void (*shiftCompleteISR)(void), void (*calculationISR)(void)) {
+    this->latchesPerRow = latchesPerRow;
+    this->bytesPerLatch = bytesPerLatch;
+    this->shiftCompleteISR = shiftCompleteISR;
+    this->calculationISR = calculationISR;
+
+    timerRunning = false;
+    calculationPending = false;
+    addressPort = 0;
+    timerOe = 0;
+    resetCounters();
+}
+
+// equivalent to loading SADDR of dmaUpdateTimer/dmaUpdateAddress/dmaClockOutData and enabling channel-to-channel linking
+void SMHostRefresh::pointAtRow(const matrixUpdateBlock * blocks, const uint8_t * data) {
+    blockSource = blocks;
+    dataSource = data;
+    currentLatch = 0;
+    linked = true;
+}
+
+// equivalent to pointing dmaUpdateTimer at timerPairIdle and disabling the link to dmaClockOutData
+void SMHostRefresh::idle(const timerpair * idlePair) {
+    timerPairIdle = idlePair;
+    linked = false;
+}
+
+// rowCalculationISR runs at a lower priority than rowShiftCompleteISR, so it's run after the current ISR returns
+void SMHostRefresh::pendRowCalculation(void) {
+    calculationPending = true;
+}
+
+void SMHostRefresh::startTimer(void) {
+    timerRunning = true;
+}
+
+void SMHostRefresh::stopTimer(void) {
+    timerRunning = false;
+}
+
+void SMHostRefresh::emit(uint8_t value) {
+    checksum = (checksum ^ value) * FNV_PRIME;
+
+    if(captureLength < captureSize)
+        captureBuffer[captureLength++] = value;
+}
+
+// one latch falling edge: load the next timer values, then shift out the data for the following latch
+void SMHostRefresh::latch(void) {
+    int i;
+
+    if(!linked) {
+        ticks += timerPairIdle->timer_period;
+        timerOe = timerPairIdle->timer_oe;
+        idleLatchCount++;
+        return;
+    }
+
+    ticks += blockSource->timerValues.timer_period;
+    timerOe = blockSource->timerValues.timer_oe;
+#ifndef ADDX_UPDATE_ON_DATA_PINS
+    addressPort = (addressPort & ~blockSource->addressValues.bits_to_clear) | blockSource->addressValues.bits_to_set;
+#endif
+    blockSource++;
+
+    // dmaClockOutData minor loop: step through the row latchesPerRow bytes at a time, starting one byte further in for each latch
+    const uint8_t * tempptr = dataSource + currentLatch;
+    for(i=0; i<bytesPerLatch; i++) {
+        emit(*tempptr);
+        tempptr += latchesPerRow;
+    }
+    latchCount++;
+
+    // major loop complete: the hardware raises the dmaClockOutData interrupt
+    if(++currentLatch >= latchesPerRow) {
+        currentLatch = 0;
+        rowCount++;
+
+        shiftCompleteISR();
+
+        if(calculationPending) {
+            calculationPending = false;
+            calculationISR();
+        }
+    }
+}
+
+void SMHostRefresh::runLatches(uint32_t numLatches) {
+    while(timerRunning && numLatches--)
+        latch();
+}
+
+void SMHostRefresh::runRows(uint32_t numRows) {
+    uint32_t targetRowCount = rowCount + numRows;
+
+    // stop if refresh is idle, nothing will restart it until the application runs
+    while(timerRunning && linked && rowCount != targetRowCount)
+        latch();
+}
+
+void SMHostRefresh::setCaptureBuffer(uint8_t * buffer, uint32_t size) {
+    captureBuffer = buffer;
+    captureSize = size;
+    captureLength = 0;
+}
+
+uint32_t SMHostRefresh::getCaptureLength(void) const {
+    return captureLength;
+}
+
+uint32_t SMHostRefresh::getChecksum(void) const {
+    return checksum;
+}
+
+void SMHostRefresh::resetCounters(void) {
+    checksum = FNV_OFFSET_BASIS;
+    captureLength = 0;
+    ticks = 0;
+    latchCount = 0;
+    idleLatchCount = 0;
+    rowCount = 0;
+}
+
+uint64_t SMHostRefresh::getTicks(void) const {
+    return ticks;
+}
+
+uint32_t SMHostRefresh::getLatchCount(void) const {
+    return latchCount;
+}
+
+uint32_t SMHostRefresh::getIdleLatchCount(void) const {
+    return idleLatchCount;
+}
+
+uint32_t SMHostRefresh::getRowCount(void) const {
+    return rowCount;
+}
+
+uint16_t SMHostRefresh::getTimerOe(void) const {
+    return timerOe;
+}
+
+uint16_t SMHostRefresh::getAddressPort(void) const {
+    return addressPort;
+}
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * SmartMatrix Library - Host (Linux) Build Support
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Building with SMARTMATRIX_HOST_BUILD defined (e.g. g++ -fno-rtti -DSMARTMATRIX_HOST_BUILD -Isrc src/*.cpp src/*.c app.cpp,
+// -fno-rtti matches the Teensy core, any -O level works)
+// replaces the Teensy FTM1 timer and eDMA channels with SMHostRefresh, a simulation that walks the same
+// matrixUpdateBlocks and matrixUpdateData buffers the DMA would, records the bytes that would be written to
+// the GPIO port, and fires rowShiftCompleteISR() and rowCalculationISR() in the same order as the hardware.
+// Nothing runs in the background: the application advances the simulated timer with runLatches() or runRows()
+// extras/HostTests has a Makefile that builds the library this way and runs the host tests and benchmarks
+
+#ifndef _MATRIX_HOST_H_
+#define _MATRIX_HOST_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// minimal replacements for the parts of Arduino.h used by the library
+#define DMAMEM
+
+// ISRs are called synchronously from runLatches(), so there is nothing to mask
+#define noInterrupts()
+#define interrupts()
+
+// nothing refreshes in the background, so loops waiting on the refresh ISRs (like swapBuffers()) advance the simulation
+#define SM_WAIT_FOR_REFRESH()   smHostRefresh.runLatches(1)
+
+uint32_t millis(void);
+uint32_t micros(void);
+
+struct timerpair;
+struct matrixUpdateBlock;
+
+class SMHostRefresh {
+    public:
+        // used by the refresh code in place of the timer and DMA registers
+        void begin(uint8_t latchesPerRow, uint16_t bytesPerLatch, void (*shiftCompleteISR)(void), void (*calculationISR)(void));
+        void pointAtRow(const matrixUpdateBlock * blocks, const uint8_t * data);
+        void idle(const timerpair * idlePair);
+        void pendRowCalculation(void);
+        void startTimer(void);
+        void stopTimer(void);
+
+        // advance simulated time, shifting out data and firing ISRs as each latch completes
+        void runLatches(uint32_t numLatches);
+        void runRows(uint32_t numRows);
+
+        // bytes written to the (simulated) GPIO data port are copied to buffer until it is full
+        void setCaptureBuffer(uint8_t * buffer, uint32_t size);
+        uint32_t getCaptureLength(void) const;
+        // FNV-1a hash of every byte written to the GPIO data port since the last resetCounters()
+        uint32_t getChecksum(void) const;
+        void resetCounters(void);
+
+        uint64_t getTicks(void) const;
+        uint32_t getLatchCount(void) const;
+        uint32_t getIdleLatchCount(void) const;
+        uint32_t getRowCount(void) const;
+        uint16_t getTimerOe(void) const;
+        uint16_t getAddressPort(void) const;
+
+    private:
+        void latch(void);
+        void emit(uint8_t value);
+
+        void (*shiftCompleteISR)(void);
+        void (*calculationISR)(void);
+
+        uint8_t latchesPerRow;
+        uint16_t bytesPerLatch;
+
+        const matrixUpdateBlock * blockSource;
+        const uint8_t * dataSource;
+        const timerpair * timerPairIdle;
+        uint8_t currentLatch;
+        bool linked;
+        bool timerRunning;
+        bool calculationPending;
+
+        uint16_t timerOe;
+        uint16_t addressPort;
+
+        uint8_t * captureBuffer;
+        uint32_t captureSize;
+        uint32_t captureLength;
+        uint32_t checksum;
+
+        uint64_t ticks;
+        uint32_t latchCount;
+        uint32_t idleLatchCount;
+        uint32_t rowCount;
+};
+
+extern SMHostRefresh smHostRefresh;
+
+#endif
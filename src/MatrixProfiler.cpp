@@ -0,0 +1,110 @@
+/*
+ * SmartMatrix Library - Refresh Budget Profiler
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "SmartMatrix3.h"
+
+#if defined(SMARTMATRIX_HOST_BUILD)
+#include <time.h>
+
+// host timestamps are scaled to F_CPU cycles so they can be compared against the row budget
+uint32_t profileCycleCount(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (((uint64_t)now.tv_sec * 1000000000 + now.tv_nsec) * (F_CPU / 1000000)) / 1000;
+}
+
+void profileCycleCounterEnable(void) {
+}
+#else
+uint32_t profileCycleCount(void) {
+    return ARM_DWT_CYCCNT;
+}
+
+void profileCycleCounterEnable(void) {
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+}
+#endif
+
+void SMProfiler::reset(void) {
+    int i, j;
+
+    for (i = 0; i < PROFILE_NUM_STAGES; i++) {
+        minCycles[i] = 0xFFFFFFFF;
+        maxCycles[i] = 0;
+        totalCycles[i] = 0;
+        count[i] = 0;
+        for (j = 0; j < PROFILE_HISTOGRAM_BINS; j++)
+            histogram[i][j] = 0;
+    }
+}
+
+void SMProfiler::setRowBudget(uint32_t cycles) {
+    rowBudget = cycles;
+    binCycles = cycles / PROFILE_BINS_PER_BUDGET;
+    if (!binCycles)
+        binCycles = 1;
+}
+
+uint32_t SMProfiler::getRowBudget(void) const {
+    return rowBudget;
+}
+
+uint32_t SMProfiler::record(uint8_t stage, uint32_t startCycles) {
+    uint32_t now = profileCycleCount();
+    // unsigned math handles counter wraparound
+    uint32_t cycles = now - startCycles;
+
+    if (stage >= PROFILE_NUM_STAGES)
+        return now;
+
+    if (cycles < minCycles[stage])
+        minCycles[stage] = cycles;
+    if (cycles > maxCycles[stage])
+        maxCycles[stage] = cycles;
+    totalCycles[stage] += cycles;
+    count[stage]++;
+
+    uint32_t bin = cycles / binCycles;
+    if (bin >= PROFILE_HISTOGRAM_BINS)
+        bin = PROFILE_HISTOGRAM_BINS - 1;
+    histogram[stage][bin]++;
+
+    return now;
+}
+
+bool SMProfiler::getStats(uint8_t stage, profileStats * stats) const {
+    int i;
+
+    if (stage >= PROFILE_NUM_STAGES || !count[stage])
+        return false;
+
+    stats->minCycles = minCycles[stage];
+    stats->maxCycles = maxCycles[stage];
+    stats->avgCycles = totalCycles[stage] / count[stage];
+    stats->count = count[stage];
+    for (i = 0; i < PROFILE_HISTOGRAM_BINS; i++)
+        stats->histogram[i] = histogram[stage][i];
+
+    return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * SmartMatrix Library - Refresh Budget Profiler
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef _MATRIX_PROFILER_H_
+#define _MATRIX_PROFILER_H_
+
+#include <stdint.h>
+
+// stages of matrixCalculations() that are timed when SMARTMATRIX_OPTIONS_PROFILING is set
+// fillRefreshRow() gets a stage per layer, in the order layers were added, starting at profileStageLayer0
+typedef enum profileStage {
+    profileStageRow,            // everything done to prepare one row, including once-per-frame updates
+    profileStageFrameUpdates,   // rotation, refresh rate, and frameRefreshCallback() for all layers (first row only)
+    profileStageBlockFill,      // timer/address matrixUpdateBlocks for the row
+    profileStagePacking,        // converting refresh rows into bit-plane DMA data
+    profileStageLayer0
+} profileStage;
+
+#define PROFILE_MAX_LAYERS          8
+#define PROFILE_NUM_STAGES          (profileStageLayer0 + PROFILE_MAX_LAYERS)
+
+// each histogram bin covers 1/PROFILE_BINS_PER_BUDGET of the time available to calculate one row,
+// anything over (PROFILE_HISTOGRAM_BINS/PROFILE_BINS_PER_BUDGET) row budgets goes in the last bin
+#define PROFILE_HISTOGRAM_BINS      16
+#define PROFILE_BINS_PER_BUDGET     8
+
+typedef struct profileStats {
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint32_t avgCycles;
+    uint32_t count;
+    uint32_t histogram[PROFILE_HISTOGRAM_BINS];
+} profileStats;
+
+// cycle counter used for timestamps: DWT CYCCNT on Teensy, clock_gettime() scaled to F_CPU on the host
+uint32_t profileCycleCount(void);
+void profileCycleCounterEnable(void);
+
+class SMProfiler {
+    public:
+        void reset(void);
+        void setRowBudget(uint32_t cycles);
+        uint32_t getRowBudget(void) const;
+
+        // add a sample that started at startCycles and ended now, returns the current cycle count
+        uint32_t record(uint8_t stage, uint32_t startCycles);
+
+        bool getStats(uint8_t stage, profileStats * stats) const;
+
+    private:
+        uint32_t rowBudget;
+        uint32_t binCycles;
+
+        uint32_t minCycles[PROFILE_NUM_STAGES];
+        uint32_t maxCycles[PROFILE_NUM_STAGES];
+        uint64_t totalCycles[PROFILE_NUM_STAGES];
+        uint32_t count[PROFILE_NUM_STAGES];
+        uint32_t histogram[PROFILE_NUM_STAGES][PROFILE_HISTOGRAM_BINS];
+};
+
+#endif
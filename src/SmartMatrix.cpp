@@ -23,11 +23,13 @@
 
 #include "SmartMatrix3.h"
 
+#ifndef SMARTMATRIX_HOST_BUILD
 #ifndef ADDX_UPDATE_ON_DATA_PINS
 DMAChannel dmaOutputAddress(false);
 DMAChannel dmaUpdateAddress(false);
 #endif
 DMAChannel dmaUpdateTimer(false);
 DMAChannel dmaClockOutData(false);
+#endif
 
 CircularBuffer dmaBuffer;
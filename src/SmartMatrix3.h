@@ -26,19 +26,29 @@
 
 #include <stdint.h>
 
-#include "Arduino.h"
+#ifdef SMARTMATRIX_HOST_BUILD
+    #include "MatrixHost.h"
+#else
+    #include "Arduino.h"
+#endif
 
-#ifdef V4HEADER
+#if defined(SMARTMATRIX_HOST_BUILD)
+    #include "MatrixHardware_Host.h"
+#elif defined(V4HEADER)
     #include "MatrixHardware_KitV4.h"
 #else
     #include "MatrixHardware_KitV1.h"
 #endif
 
 #include "MatrixCommon.h"
+#include "MatrixProfiler.h"
 
 #include "Layer_Scrolling.h"
 #include "Layer_Indexed.h"
 #include "Layer_Background.h"
+#include "Layer_DisplayList.h"
+#include "Layer_Sprites.h"
+#include "Layer_Tiles.h"
 
 typedef struct timerpair {
     uint16_t timer_oe;
@@ -55,6 +65,20 @@ typedef struct matrixUpdateBlock {
     addresspair addressValues;
 } matrixUpdateBlock;
 
+#define SMARTMATRIX_OPTIONS_NONE                    0
+#define SMARTMATRIX_OPTIONS_C_SHAPE_STACKING        (1 << 0)
+#define SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING  (1 << 1)
+#define SMARTMATRIX_OPTIONS_PROFILING               (1 << 2)
+// set by SMARTMATRIX_ALLOCATE_FULL_FRAME_BUFFERS, don't set directly
+#define SMARTMATRIX_OPTIONS_FULL_FRAME_BUFFER       (1 << 3)
+// at refresh depth 24 or 36, layers fill 48-bit rows and the bits the refresh can't show are dithered over frames instead
+// of dropped, every row is packed again each frame
+#define SMARTMATRIX_OPTIONS_TEMPORAL_DITHERING      (1 << 4)
+
+// called from the refresh ISR at the start of each frame, after layers have taken in swaps and other changes for the frame
+// frameMicros is micros() at the frame boundary, keep the callback short as it delays loading rows
+typedef void (*frameCallbackFunction)(uint32_t frameNumber, uint32_t frameMicros);
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 class SmartMatrix3 {
 public:
@@ -75,9 +99,21 @@ public:
     bool getdmaBufferUnderrunFlag(void);
     bool getRefreshRateLoweredFlag(void);
 
+    // frame boundary events, for rendering once per displayed frame
+    void setFrameCallback(frameCallbackFunction callback);
+    uint32_t getFrameCount(void);
+    uint32_t getFrameMicros(void);
+    // sleeps until a frame after lastFrame has started, returns the current frame number
+    uint32_t waitForFrame(uint32_t lastFrame);
+
     // debug
     void countFPS(void);
 
+    // refresh budget profiling, only recorded when SMARTMATRIX_OPTIONS_PROFILING is set
+    void resetProfile(void);
+    bool getProfileStats(uint8_t stage, profileStats * stats);
+    uint32_t getRowBudgetCycles(void);
+
 private:
     SM_Layer * baseLayer;
 
@@ -89,16 +125,37 @@ private:
 
     // functions called by ISR
     static void matrixCalculations(bool initial = false);
+    static void frameCalculations(uint32_t startCycles);
 
     // functions for refreshing
     static void loadMatrixBuffers(unsigned char currentRow);
     static void loadMatrixBuffers48(unsigned char currentRow, unsigned char freeRowBuffer);
     static void loadMatrixBuffers36(unsigned char currentRow, unsigned char freeRowBuffer);
     static void loadMatrixBuffers24(unsigned char currentRow, unsigned char freeRowBuffer);
+    static void loadMatrixBuffersDithered(unsigned char currentRow, unsigned char freeRowBuffer);
+    static uint16_t ditherChannel(uint16_t value, uint8_t threshold);
+    static void getPanelRows(unsigned char currentRow, int panel, int * row0, int * row1);
+    static uint32_t getRowSourceMask(unsigned char currentRow);
+    template <typename RGB>
+    static void blendRefreshRow(SM_Layer * layer, uint16_t hardwareY, RGB refreshRow[]);
+    template <typename RGB, blendModes blendMode>
+    static void blendPixels(const RGB layerRow[], const RGB layerRowCheck[], int32_t layerAlpha, RGB refreshRow[]);
+    template <typename RGB>
+    static uint32_t fillRefreshRows(unsigned char currentRow, RGB tempRow0[], RGB tempRow1[]);
+    static void packBitPlanes(uint32_t * wordptr, uint16_t red0, uint16_t green0, uint16_t blue0, uint16_t red1, uint16_t green1, uint16_t blue1);
 
     // configuration helper functions
     static void calculateTimerLut(void);
 
+    // profiling helpers, compile to nothing without SMARTMATRIX_OPTIONS_PROFILING
+    static uint32_t profileStart(void);
+    static uint32_t profileRecord(uint8_t stage, uint32_t startCycles);
+
+    // platform-specific timer and DMA control (SmartMatrix_Teensy_Impl.h or SmartMatrix_Host_Impl.h)
+    static void beginRefreshHardware(void);
+    static void restartRefreshHardware(void);
+    static void waitForRefreshInterrupt(void);
+
     // configuration
     static volatile bool brightnessChange;
     static volatile bool rotationChange;
@@ -119,6 +176,13 @@ private:
     static bool dmaBufferUnderrunSinceLastCheck;
     static bool refreshRateLowered;
     static bool refreshRateChanged;
+    static uint32_t packedRows;
+    static uint32_t frameDirtyRows;
+    static const bool temporalDithering = (optionFlags & SMARTMATRIX_OPTIONS_TEMPORAL_DITHERING) && (refreshDepth < 48);
+    static uint8_t ditherFrame;
+    static volatile uint32_t frameCount;
+    static volatile uint32_t frameMicros;
+    static frameCallbackFunction frameCallback;
 
     static uint32_t * matrixUpdateData;
     static matrixUpdateBlock * matrixUpdateBlocks;
@@ -126,6 +190,8 @@ private:
     static timerpair * timerLUT;
     static timerpair * timerPairIdle;
 
+    static SMProfiler profiler;
+
     static SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>* globalinstance;
 };
 
@@ -145,10 +211,6 @@ private:
                                                      (x == SMARTMATRIX_HUB75_16ROW_MOD8SCAN ? 8 : 0) | \
                                                      (x == SMARTMATRIX_HUB75_64ROW_MOD32SCAN ? 32 : 0))
 
-#define SMARTMATRIX_OPTIONS_NONE                    0
-#define SMARTMATRIX_OPTIONS_C_SHAPE_STACKING        (1 << 0)
-#define SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING  (1 << 1)
-
 
 // single matrixUpdateBlocks buffer is divided up to hold matrixUpdateBlocks, addressLUT, timerLUT to simplify user sketch code and reduce constructor parameters
 #define SMARTMATRIX_ALLOCATE_BUFFERS(matrix_name, width, height, pwm_depth, buffer_rows, panel_type, option_flags) \
@@ -156,21 +218,59 @@ private:
     static DMAMEM uint8_t matrixUpdateBlocks[(sizeof(matrixUpdateBlock) * buffer_rows * pwm_depth/COLOR_CHANNELS_PER_PIXEL) + (sizeof(addresspair) * CONVERT_PANELTYPE_TO_MATRIXROWSPERFRAME(panel_type)) + (sizeof(timerpair) * pwm_depth/COLOR_CHANNELS_PER_PIXEL) + sizeof(timerpair)]; \
     SmartMatrix3<pwm_depth, width, height, panel_type, option_flags> matrix_name(buffer_rows, matrixUpdateData, matrixUpdateBlocks)
 
+// keeps every row of the frame packed, DMA walks the frame without waiting for rows to be calculated
+// and rows are only packed again when a layer changes them, uses matrixRowsPerFrame rows of buffer (e.g. 16 rows for a 32-row panel)
+#define SMARTMATRIX_ALLOCATE_FULL_FRAME_BUFFERS(matrix_name, width, height, pwm_depth, panel_type, option_flags) \
+    SMARTMATRIX_ALLOCATE_BUFFERS(matrix_name, width, height, pwm_depth, CONVERT_PANELTYPE_TO_MATRIXROWSPERFRAME(panel_type), panel_type, (option_flags | SMARTMATRIX_OPTIONS_FULL_FRAME_BUFFER))
+
 #define SMARTMATRIX_ALLOCATE_SCROLLING_LAYER(layer_name, width, height, storage_depth, scrolling_options) \
     typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
     static uint8_t layer_name##Bitmap[width * (height / 8)];                                              \
-    static SMLayerScrolling<RGB_TYPE(storage_depth), scrolling_options> layer_name(layer_name##Bitmap, width, height)  
+    static uint8_t layer_name##TextRun[SM_SCROLLING_TEXT_RUN_SIZE(height)];                                \
+    static SMLayerScrolling<RGB_TYPE(storage_depth), scrolling_options> layer_name(layer_name##Bitmap, width, height, \
+        layer_name##TextRun, sizeof(layer_name##TextRun))
 
 #define SMARTMATRIX_ALLOCATE_INDEXED_LAYER(layer_name, width, height, storage_depth, indexed_options) \
     typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
-    static uint8_t layer_name##Bitmap[2 * width * (height / 8)];                                              \
+    static uint8_t layer_name##Bitmap[2 * width * (height / 8) * SM_INDEXED_BITS_PER_PIXEL(indexed_options)]; \
     static SMLayerIndexed<RGB_TYPE(storage_depth), indexed_options> layer_name(layer_name##Bitmap, width, height)  
 
 #define SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(layer_name, width, height, storage_depth, background_options) \
     typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
-    static RGB_TYPE(storage_depth) backgroundBitmap[2*width*height];                                        \
+    static RGB_TYPE(storage_depth) backgroundBitmap[SM_BACKGROUND_BUFFER_COUNT(background_options)*width*height]; \
     static SMLayerBackground<RGB_TYPE(storage_depth), background_options> layer_name(backgroundBitmap, width, height)  
 
+// max_items is up to 255, see SMLayerDisplayList for the RAM used
+#define SMARTMATRIX_ALLOCATE_DISPLAY_LIST_LAYER(layer_name, width, height, storage_depth, max_items, display_list_options) \
+    typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+    static SMDisplayListItem<RGB_TYPE(storage_depth)> layer_name##Items[max_items];                          \
+    static displayListEntry layer_name##Entries[2 * max_items];                                              \
+    static uint8_t layer_name##Bins[2 * max_items * height];                                                 \
+    static uint16_t layer_name##BinStarts[2 * (height + 1)];                                                 \
+    static SMLayerDisplayList<RGB_TYPE(storage_depth), display_list_options> layer_name(layer_name##Items, layer_name##Entries, \
+        layer_name##Bins, layer_name##BinStarts, max_items, width, height)
+
+// max_sprites is up to SM_SPRITES_MAX_SPRITES
+#define SMARTMATRIX_ALLOCATE_SPRITE_LAYER(layer_name, width, height, storage_depth, max_sprites, sprite_options) \
+    static_assert(max_sprites <= SM_SPRITES_MAX_SPRITES, "max_sprites can't be more than SM_SPRITES_MAX_SPRITES"); \
+    typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+    static SMSprite<RGB_TYPE(storage_depth)> layer_name##Sprites[2 * max_sprites];                           \
+    static uint32_t layer_name##RowSprites[height];                                                          \
+    static SMLayerSprites<RGB_TYPE(storage_depth), sprite_options> layer_name(layer_name##Sprites,          \
+        layer_name##RowSprites, max_sprites, width, height)
+
+// map_width x map_height tiles of tile_size (8 or 16) pixels, tile indexes are the only RAM used for the canvas
+#define SMARTMATRIX_ALLOCATE_TILE_LAYER(layer_name, width, height, storage_depth, map_width, map_height, tile_size, tile_options) \
+    typedef RGB_TYPE(storage_depth) SM_RGB;                                                                 \
+    static uint8_t layer_name##TileMap[map_width * map_height];                                              \
+    static SMLayerTiles<RGB_TYPE(storage_depth), tile_options> layer_name(layer_name##TileMap, map_width,   \
+        map_height, tile_size, width, height)
+
+// 1bpp storage for text up to width x height pixels, see SMGlyphRun::layout()
+#define SMARTMATRIX_ALLOCATE_GLYPH_RUN(run_name, width, height)                                             \
+    static uint8_t run_name##Bitmap[((width + 7) / 8) * height];                                           \
+    static SMGlyphRun run_name(run_name##Bitmap, sizeof(run_name##Bitmap))
+
 
 #include "SmartMatrix_Impl.h"
 
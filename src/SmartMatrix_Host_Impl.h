@@ -0,0 +1,90 @@
+/*
+ * SmartMatrix Library - Simulated Refresh Hardware for Host (Linux) Builds
+ *
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Host counterpart to SmartMatrix_Teensy_Impl.h: drives SMHostRefresh (MatrixHost.h) instead of FTM1 and eDMA
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::restartRefreshHardware(void) {
+    smHostRefresh.stopTimer();
+
+    // point DMA addresses to the next buffer
+    int currentRow = cbGetNextRead(&dmaBuffer);
+    smHostRefresh.pointAtRow(matrixUpdateBlocks + (currentRow * latchesPerRow),
+        (uint8_t*)matrixUpdateData + (currentRow * dmaBufferBytesPerRow));
+
+    smHostRefresh.startTimer();
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::beginRefreshHardware(void) {
+    smHostRefresh.begin(latchesPerRow, PIXELS_PER_LATCH * DMA_UPDATES_PER_CLOCK + ADDX_UPDATE_BEFORE_LATCH_BYTES,
+        rowShiftCompleteISR<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>,
+        rowCalculationISR<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>);
+
+    smHostRefresh.pointAtRow(matrixUpdateBlocks, (uint8_t*)matrixUpdateData);
+    smHostRefresh.startTimer();
+}
+
+// nothing refreshes in the background on the host, so advance the simulation until the next ISR instead of sleeping
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::waitForRefreshInterrupt(void) {
+    smHostRefresh.runLatches(1);
+}
+
+// simulated DMA transfer done, set up for loading the next row
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+void rowShiftCompleteISR(void) {
+    if(optionFlags & SMARTMATRIX_OPTIONS_FULL_FRAME_BUFFER) {
+        // every row is always in the buffer, move on to the next row and only wake the calculation ISR once per frame
+        static int currentRow = 0;
+        if(++currentRow >= SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixRowsPerFrame)
+            currentRow = 0;
+
+        smHostRefresh.pointAtRow(SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow),
+            (uint8_t*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateData + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferBytesPerRow));
+
+        if(!currentRow)
+            smHostRefresh.pendRowCalculation();
+        return;
+    }
+
+    // done with previous row, mark it as read
+    cbRead(&dmaBuffer);
+
+    if(cbIsEmpty(&dmaBuffer)) {
+        // repeatedly load timerPairIdle until the buffer is ready
+        smHostRefresh.idle(SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerPairIdle);
+
+        // set flag so other ISR can enable DMA again when data is ready
+        SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = true;
+    } else {
+        // get next row to draw to display and update DMA pointers
+        int currentRow = cbGetNextRead(&dmaBuffer);
+        smHostRefresh.pointAtRow(SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow),
+            (uint8_t*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateData + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferBytesPerRow));
+    }
+
+    // trigger software interrupt
+    smHostRefresh.pendRowCalculation();
+}
@@ -23,14 +23,11 @@
 
 #include "SmartMatrix3.h"
 #include "CircularBuffer.h"
-#include "DMAChannel.h"
 
 #define INLINE __attribute__( ( always_inline ) ) inline
 
 #define MATRIX_STACK_HEIGHT (matrixHeight / matrixPanelHeight)
 
-#define ROW_CALCULATION_ISR_PRIORITY   0xFE // 0xFF = lowest priority
-
 // hardware-specific definitions
 // prescale of 1 is F_BUS/2
 #define LATCH_TIMER_PRESCALE  0x01
@@ -48,13 +45,6 @@
 
 #define TIMER_REGISTERS_TO_UPDATE   2
 
-#ifndef ADDX_UPDATE_ON_DATA_PINS
-    extern DMAChannel dmaOutputAddress;
-    extern DMAChannel dmaUpdateAddress;
-#endif
-extern DMAChannel dmaUpdateTimer;
-extern DMAChannel dmaClockOutData;
-
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 const int SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixPanelHeight = CONVERT_PANELTYPE_TO_MATRIXPANELHEIGHT(panelType);
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
@@ -77,6 +67,7 @@ SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>* S
 // must be minimum 2 rows so one can be updated while the other is refreshed
 // increase beyond two to give more time for the update routine to complete
 // (increase this number if non-DMA interrupts are causing display problems)
+// with SMARTMATRIX_OPTIONS_FULL_FRAME_BUFFER this is matrixRowsPerFrame and each row has a fixed place in the buffer
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 uint8_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferNumRows;
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
@@ -86,6 +77,24 @@ uint16_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, option
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 uint8_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::refreshRate = 120;
 
+// packedRows = bit per row, set when the buffer slot with the same index holds valid packed data for that row
+// only possible when dmaBufferNumRows == matrixRowsPerFrame, then rows that no layer changed are not repacked
+// frameDirtyRows = layer rows that changed this frame (see SM_Layer::getDirtyRows())
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::packedRows = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameDirtyRows = SM_ALL_ROWS_DIRTY;
+// counts frames for SMARTMATRIX_OPTIONS_TEMPORAL_DITHERING, each pixel steps through all dither thresholds every 256 frames
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+uint8_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::ditherFrame = 0;
+// frameCount = frames started since begin(), frameMicros = micros() when the last frame started
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+volatile uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameCount = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+volatile uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameMicros = 0;
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+frameCallbackFunction SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameCallback = NULL;
+
 
 // todo: just use a single buffer for Blocks/LUT/Data?
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
@@ -100,6 +109,9 @@ timerpair * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, opt
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 timerpair * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerPairIdle;
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+SMProfiler SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::profiler;
+
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 volatile bool SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = false;
 
@@ -138,18 +150,6 @@ bool SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlag
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 uint32_t * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateData;
 
-#ifndef ADDX_UPDATE_ON_DATA_PINS
-#define ADDRESS_ARRAY_REGISTERS_TO_UPDATE   2
-
-// 2x uint32_t to match size and spacing of values it is updating: GPIOx_PSOR and GPIOx_PCOR are 32-bit and adjacent to each other
-typedef struct gpiopair {
-    uint32_t  gpio_psor;
-    uint32_t  gpio_pcor;
-} gpiopair;
-
-static gpiopair gpiosync;
-#endif
-
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::SmartMatrix3(uint8_t bufferrows, uint32_t * dataBuffer, uint8_t * blockBuffer) {
     SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::globalinstance = this;
@@ -182,6 +182,9 @@ void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlag
     } else {
         baseLayer = newlayer;
     }
+    // dithering needs the full 16 bits per channel from layers
+    newlayer->setRefreshDepth(temporalDithering ? 48 : refreshDepth);
+    packedRows = 0;
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
@@ -203,6 +206,69 @@ void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlag
   }
 }
 
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+INLINE uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::profileStart(void) {
+    if(optionFlags & SMARTMATRIX_OPTIONS_PROFILING)
+        return profileCycleCount();
+    return 0;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+INLINE uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::profileRecord(uint8_t stage, uint32_t startCycles) {
+    if(optionFlags & SMARTMATRIX_OPTIONS_PROFILING)
+        return profiler.record(stage, startCycles);
+    return 0;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::resetProfile(void) {
+    noInterrupts();
+    profiler.reset();
+    interrupts();
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+bool SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getProfileStats(uint8_t stage, profileStats * stats) {
+    if(!(optionFlags & SMARTMATRIX_OPTIONS_PROFILING))
+        return false;
+
+    // copy with interrupts disabled so the stats all come from the same set of samples
+    noInterrupts();
+    bool valid = profiler.getStats(stage, stats);
+    interrupts();
+    return valid;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::setFrameCallback(frameCallbackFunction callback) {
+    frameCallback = callback;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameCount(void) {
+    return frameCount;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getFrameMicros(void) {
+    return frameMicros;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::waitForFrame(uint32_t lastFrame) {
+    // the refresh ISRs run several times per row, so there's always an interrupt to wake up from
+    while (frameCount == lastFrame)
+        waitForRefreshInterrupt();
+
+    return frameCount;
+}
+
+// CPU cycles available to calculate one row before the DMA runs out of data at the current refresh rate
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowBudgetCycles(void) {
+    return F_CPU / refreshRate / matrixRowsPerFrame;
+}
+
 #define MAX_MATRIXCALCULATIONS_LOOPS_WITHOUT_EXIT  5
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
@@ -210,6 +276,19 @@ INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, opt
     static unsigned char currentRow = 0;
     unsigned char numLoopsWithoutExit = 0;
 
+    // DMA walks the packed frame on its own and this is called once at the start of each frame,
+    // rows a layer changed are packed again while the frame is shown, so a changed row can show part old, part new data for one refresh
+    if(optionFlags & SMARTMATRIX_OPTIONS_FULL_FRAME_BUFFER) {
+        frameCalculations(profileStart());
+
+        for (currentRow = 0; currentRow < matrixRowsPerFrame; currentRow++) {
+            uint32_t rowStartCycles = profileStart();
+            loadMatrixBuffers(currentRow);
+            profileRecord(profileStageRow, rowStartCycles);
+        }
+        return;
+    }
+
     // only run the loop if there is free space, and fill the entire buffer before returning
     while (!cbIsFull(&dmaBuffer)) {
         // check to see if the refresh rate is too high, and the application doesn't have time to run
@@ -227,31 +306,11 @@ INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, opt
             numLoopsWithoutExit = 0;
         }
 
-        // do once-per-frame updates
-        if (!currentRow) {
-            if (rotationChange) {
-                SM_Layer * templayer = globalinstance->baseLayer;
-                while(templayer) {
-                    templayer->setRotation(rotation);
-                    templayer = templayer->nextLayer;
-                }
-                rotationChange = false;
-            }
+        uint32_t rowStartCycles = profileStart();
 
-            SM_Layer * templayer = globalinstance->baseLayer;
-            while(templayer) {
-                if(refreshRateChanged) {
-                    templayer->setRefreshRate(refreshRate);
-                }
-                templayer->frameRefreshCallback();
-                templayer = templayer->nextLayer;
-            }
-            refreshRateChanged = false;
-            if (brightnessChange) {
-                calculateTimerLut();
-                brightnessChange = false;
-            }
-        }
+        // do once-per-frame updates
+        if (!currentRow)
+            frameCalculations(rowStartCycles);
 
         // do once-per-line updates
         // none right now
@@ -259,6 +318,7 @@ INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, opt
         // enqueue row
         SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(currentRow);
         cbWrite(&dmaBuffer);
+        profileRecord(profileStageRow, rowStartCycles);
 
         if (++currentRow >= matrixRowsPerFrame)
             currentRow = 0;
@@ -272,30 +332,55 @@ INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, opt
                 refreshRateChanged = true;
             }
 
-            // stop timer
-            FTM1_SC = FTM_SC_CLKS(0) | FTM_SC_PS(LATCH_TIMER_PRESCALE);
-
-            // point DMA addresses to the next buffer
-            int currentRow = cbGetNextRead(&dmaBuffer);
-#ifndef ADDX_UPDATE_ON_DATA_PINS
-            dmaUpdateAddress.TCD->SADDR = &((matrixUpdateBlock*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow))->addressValues;
-#endif
-            dmaUpdateTimer.TCD->SADDR = &((matrixUpdateBlock*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow))->timerValues.timer_oe;
-            dmaClockOutData.TCD->SADDR = (uint8_t*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateData + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferBytesPerRow);
-
-            // enable channel-to-channel linking so data will be shifted out
-            dmaUpdateTimer.TCD->CSR &= ~(1 << 7);  // must clear DONE flag before enabling
-            dmaUpdateTimer.TCD->CSR |= (1 << 5);
-            // set timer increment back to read from matrixUpdateBlocks
-            dmaUpdateTimer.TCD->SLAST = sizeof(matrixUpdateBlock) - (TIMER_REGISTERS_TO_UPDATE * sizeof(uint16_t));
-
             dmaBufferUnderrunSinceLastCheck = true;
             dmaBufferUnderrun = false;
 
-            // start timer again - next timer period is MIN_BLOCK_PERIOD_TICKS with OE disabled, period after that will be loaded from matrixUpdateBlock
-            FTM1_SC = FTM_SC_CLKS(1) | FTM_SC_PS(LATCH_TIMER_PRESCALE);
+            // point DMA at the next row in the buffer and start shifting data again
+            restartRefreshHardware();
+        }
+    }
+}
+
+// once-per-frame updates, done before the first row of the frame is loaded
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::frameCalculations(uint32_t startCycles) {
+    if (rotationChange) {
+        SM_Layer * templayer = globalinstance->baseLayer;
+        while(templayer) {
+            templayer->setRotation(rotation);
+            templayer = templayer->nextLayer;
+        }
+        rotationChange = false;
+        packedRows = 0;
+    }
+
+    frameDirtyRows = 0;
+    SM_Layer * templayer = globalinstance->baseLayer;
+    while(templayer) {
+        if(refreshRateChanged) {
+            templayer->setRefreshRate(refreshRate);
         }
+        templayer->frameRefreshCallback();
+        frameDirtyRows |= templayer->getDirtyRows();
+        templayer = templayer->nextLayer;
+    }
+    refreshRateChanged = false;
+    if (brightnessChange) {
+        calculateTimerLut();
+        brightnessChange = false;
+    }
+
+    // dithered rows are different every frame even when no layer changed
+    if (temporalDithering) {
+        ditherFrame++;
+        frameDirtyRows = SM_ALL_ROWS_DIRTY;
     }
+
+    frameCount++;
+    frameMicros = micros();
+    if (frameCallback)
+        frameCallback(frameCount, frameMicros);
+    profileRecord(profileStageFrameUpdates, startCycles);
 }
 
 #define MSB_BLOCK_TICKS_ADJUSTMENT_INCREMENT    10
@@ -348,6 +433,13 @@ void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlag
         timerLUT[i].timer_period = period;
         timerLUT[i].timer_oe = ontime;
     }
+
+    // refresh rate sets the time available per row, keep histogram bins relative to it
+    if(optionFlags & SMARTMATRIX_OPTIONS_PROFILING)
+        profiler.setRowBudget(F_CPU / refreshRate / matrixRowsPerFrame);
+
+    // timer values are stored with each row, so all rows need to be loaded again
+    packedRows = 0;
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
@@ -431,6 +523,11 @@ void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlag
 {
     cbInit(&dmaBuffer, dmaBufferNumRows);
 
+    if(optionFlags & SMARTMATRIX_OPTIONS_PROFILING) {
+        profileCycleCounterEnable();
+        profiler.reset();
+    }
+
 #ifndef ADDX_UPDATE_ON_DATA_PINS
     int i;
     // fill addressLUT
@@ -460,486 +557,242 @@ void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlag
     // completely fill buffer with data before enabling DMA
     matrixCalculations(true);
 
-    // setup debug output
-#ifdef DEBUG_PINS_ENABLED
-    pinMode(DEBUG_PIN_1, OUTPUT);
-    digitalWriteFast(DEBUG_PIN_1, HIGH); // oscilloscope trigger
-    digitalWriteFast(DEBUG_PIN_1, LOW);
-    pinMode(DEBUG_PIN_2, OUTPUT);
-    digitalWriteFast(DEBUG_PIN_2, HIGH); // oscilloscope trigger
-    digitalWriteFast(DEBUG_PIN_2, LOW);
-    pinMode(DEBUG_PIN_3, OUTPUT);
-    digitalWriteFast(DEBUG_PIN_3, HIGH); // oscilloscope trigger
-    digitalWriteFast(DEBUG_PIN_3, LOW);
-#endif
+    // setup platform-specific timer and DMA, refresh starts at the end of this call
+    beginRefreshHardware();
+}
 
-    // configure the 7 output pins (one pin is left as input, though it can't be used as GPIO output)
-    pinMode(GPIO_PIN_CLK_TEENSY_PIN, OUTPUT);
-    pinMode(GPIO_PIN_B0_TEENSY_PIN, OUTPUT);
-    pinMode(GPIO_PIN_R0_TEENSY_PIN, OUTPUT);
-    pinMode(GPIO_PIN_R1_TEENSY_PIN, OUTPUT);
-    pinMode(GPIO_PIN_G0_TEENSY_PIN, OUTPUT);
-    pinMode(GPIO_PIN_G1_TEENSY_PIN, OUTPUT);
-    pinMode(GPIO_PIN_B1_TEENSY_PIN, OUTPUT);
-
-#ifdef ADDX_TEENSY_PIN_0
-    // configure the address pins
-    pinMode(ADDX_TEENSY_PIN_0, OUTPUT);
-#endif
-#ifdef ADDX_TEENSY_PIN_1
-    pinMode(ADDX_TEENSY_PIN_1, OUTPUT);
-#endif
-#ifdef ADDX_TEENSY_PIN_2
-    pinMode(ADDX_TEENSY_PIN_2, OUTPUT);
-#endif
-#ifdef ADDX_TEENSY_PIN_3
-    pinMode(ADDX_TEENSY_PIN_3, OUTPUT);
-#endif
+// gets the layer rows shown on a panel for the current row pair, panels counted in the order they are chained
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getPanelRows(unsigned char currentRow, int panel, int * row0, int * row1) {
+    // stacking options are template parameters, so these resolve at compile time:
+    // Z-shape bottom to top and C-shape top to bottom chain starts from the bottom panel, the others start from the top
+    const bool reverseStack = ((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) != 0) != ((optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING) != 0);
+
+    // first row of this panel in the layer's coordinates
+    int panelOffset = (reverseStack ? (MATRIX_STACK_HEIGHT-panel-1) : panel) * matrixPanelHeight;
+
+    // C-shape: every other panel is upside down, counting from the panel furthest along the chain
+    if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((MATRIX_STACK_HEIGHT-panel)%2)) {
+        // swap row order from top to bottom for this panel (row1 is in top half of panel, row0 is in bottom half)
+        *row0 = (matrixRowsPerFrame-currentRow-1) + matrixRowPairOffset + panelOffset;
+        *row1 = (matrixRowsPerFrame-currentRow-1) + panelOffset;
+    } else {
+        *row0 = currentRow + panelOffset;
+        *row1 = currentRow + matrixRowPairOffset + panelOffset;
+    }
+}
 
-    // setup FTM1
-    FTM1_SC = 0;
-    FTM1_CNT = 0;
-    FTM1_MOD = IDEAL_MSB_BLOCK_TICKS;
+// dirty row bits for every layer row that is shifted out with currentRow
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+INLINE uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::getRowSourceMask(unsigned char currentRow) {
+    int i, row0, row1;
+    uint32_t mask = 0;
 
-    // setup FTM1 compares:
-    // latch pulse width set based on max time to update address pins
-    FTM1_C0V = LATCH_TIMER_PULSE_WIDTH_TICKS;
-    // output OE signal - set to max at first to disable OE
-    FTM1_C1V = IDEAL_MSB_BLOCK_TICKS;
+    for(i=0; i<MATRIX_STACK_HEIGHT; i++) {
+        getPanelRows(currentRow, i, &row0, &row1);
+        mask |= SM_DIRTY_ROW(row0) | SM_DIRTY_ROW(row1);
+    }
+    return mask;
+}
 
-    // setup PWM outputs
-    ENABLE_LATCH_PWM_OUTPUT();
-    ENABLE_OE_PWM_OUTPUT();
+// composites a matrixWidth row from a translucent or non-normal blend mode layer onto refreshRow
+// layers only write the pixels they draw, so the layer fills two rows, one cleared and one set: pixels that match in both were drawn
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+template <typename RGB>
+INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::blendRefreshRow(SM_Layer * layer, uint16_t hardwareY, RGB refreshRow[]) {
+    int i;
 
-    // setup GPIO interrupts
-    ENABLE_LATCH_RISING_EDGE_GPIO_INT();
-    ENABLE_LATCH_FALLING_EDGE_GPIO_INT();
+    // static to avoid putting large buffer on the stack
+    static RGB layerRow[matrixWidth];
+    static RGB layerRowCheck[matrixWidth];
 
+    // rgb24 or rgb48 channels
+    const uint16_t channelMax = (sizeof(RGB) == sizeof(rgb48)) ? 0xFFFF : 0xFF;
 
-    // enable clocks to the DMA controller and DMAMUX
-    SIM_SCGC7 |= SIM_SCGC7_DMA;
-    SIM_SCGC6 |= SIM_SCGC6_DMAMUX;
+    for(i=0; i<matrixWidth; i++) {
+        layerRow[i] = RGB(0, 0, 0);
+        layerRowCheck[i] = RGB(channelMax, channelMax, channelMax);
+    }
+    layer->fillRefreshRow(hardwareY, layerRow);
+    layer->fillRefreshRow(hardwareY, layerRowCheck);
+
+    uint8_t opacity = layer->getOpacity();
+    int32_t layerAlpha = opacity + (opacity >> 7);
+
+    // one pixel loop per blend mode, so the mode is only checked once per row
+    switch(layer->getBlendMode()) {
+        case blendAdditive:
+            blendPixels<RGB, blendAdditive>(layerRow, layerRowCheck, layerAlpha, refreshRow);
+            break;
+        case blendMultiply:
+            blendPixels<RGB, blendMultiply>(layerRow, layerRowCheck, layerAlpha, refreshRow);
+            break;
+        default:
+            blendPixels<RGB, blendNormal>(layerRow, layerRowCheck, layerAlpha, refreshRow);
+            break;
+    }
+}
 
-    // enable minor loop mapping so addresses can get reset after minor loops
-    DMA_CR |= DMA_CR_EMLM;
+// blending is fixed point with alpha 0-256, pixels the layer didn't draw get alpha 0 instead of a branch
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+template <typename RGB, blendModes blendMode>
+INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::blendPixels(const RGB layerRow[],
+    const RGB layerRowCheck[], int32_t layerAlpha, RGB refreshRow[]) {
+    int i;
 
-    // allocate all DMA channels up front so channels can link to each other
-#ifndef ADDX_UPDATE_ON_DATA_PINS
-    dmaOutputAddress.begin(false);
-    dmaUpdateAddress.begin(false);
-#endif
-    dmaUpdateTimer.begin(false);
-    dmaClockOutData.begin(false);
+    // rgb24 or rgb48 channels
+    const int channelBits = (sizeof(RGB) == sizeof(rgb48)) ? 16 : 8;
+    const int channelMax = (1 << channelBits) - 1;
+
+    for(i=0; i<matrixWidth; i++) {
+        const RGB & src = layerRow[i];
+        RGB & dst = refreshRow[i];
+        int32_t drawn = (src.red == layerRowCheck[i].red) & (src.green == layerRowCheck[i].green) & (src.blue == layerRowCheck[i].blue);
+        int32_t alpha = layerAlpha & -drawn;
+        int32_t red, green, blue;
+
+        if(blendMode == blendAdditive) {
+            red = dst.red + ((src.red * alpha) >> 8);
+            green = dst.green + ((src.green * alpha) >> 8);
+            blue = dst.blue + ((src.blue * alpha) >> 8);
+            dst.red = red > channelMax ? channelMax : red;
+            dst.green = green > channelMax ? channelMax : green;
+            dst.blue = blue > channelMax ? channelMax : blue;
+        } else {
+            if(blendMode == blendMultiply) {
+                red = ((uint32_t)dst.red * (src.red + 1)) >> channelBits;
+                green = ((uint32_t)dst.green * (src.green + 1)) >> channelBits;
+                blue = ((uint32_t)dst.blue * (src.blue + 1)) >> channelBits;
+            } else {
+                red = src.red;
+                green = src.green;
+                blue = src.blue;
+            }
+            dst.red += ((red - dst.red) * alpha) >> 8;
+            dst.green += ((green - dst.green) * alpha) >> 8;
+            dst.blue += ((blue - dst.blue) * alpha) >> 8;
+        }
+    }
+}
 
-#ifndef ADDX_UPDATE_ON_DATA_PINS
-    // dmaOutputAddress - on latch rising edge, read address from fixed address temporary buffer, and output address on GPIO
-    // using combo of writes to set+clear registers, to only modify the address pins and not other GPIO pins
-    // address temporary buffer is refreshed before each DMA trigger (by DMA channel dmaUpdateAddress)
-    // only use single major loop, never disable channel
-    dmaOutputAddress.source(gpiosync.gpio_pcor);
-    dmaOutputAddress.TCD->SOFF = (int)&gpiosync.gpio_psor - (int)&gpiosync.gpio_pcor;
-    dmaOutputAddress.TCD->SLAST = (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * ((int)&ADDX_GPIO_CLEAR_REGISTER - (int)&ADDX_GPIO_SET_REGISTER));
-    dmaOutputAddress.TCD->ATTR = DMA_TCD_ATTR_SSIZE(2) | DMA_TCD_ATTR_DSIZE(2);
-    // Destination Minor Loop Offset Enabled - transfer appropriate number of bytes per minor loop, and put DADDR back to original value when minor loop is complete
-    // Source Minor Loop Offset Enabled - source buffer is same size and offset as destination so values reset after each minor loop
-    dmaOutputAddress.TCD->NBYTES_MLOFFYES = DMA_TCD_NBYTES_SMLOE | DMA_TCD_NBYTES_DMLOE |
-                               ((ADDRESS_ARRAY_REGISTERS_TO_UPDATE * ((int)&ADDX_GPIO_CLEAR_REGISTER - (int)&ADDX_GPIO_SET_REGISTER)) << 10) |
-                               (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * sizeof(gpiosync.gpio_psor));
-    // start on higher value of two registers, and make offset decrement to avoid negative number in NBYTES_MLOFFYES (TODO: can switch order by masking negative offset)
-    dmaOutputAddress.TCD->DADDR = &ADDX_GPIO_CLEAR_REGISTER;
-    // update destination address so the second update per minor loop is ADDX_GPIO_SET_REGISTER
-    dmaOutputAddress.TCD->DOFF = (int)&ADDX_GPIO_SET_REGISTER - (int)&ADDX_GPIO_CLEAR_REGISTER;
-    dmaOutputAddress.TCD->DLASTSGA = (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * ((int)&ADDX_GPIO_CLEAR_REGISTER - (int)&ADDX_GPIO_SET_REGISTER));
-    // single major loop
-    dmaOutputAddress.TCD->CITER_ELINKNO = 1;
-    dmaOutputAddress.TCD->BITER_ELINKNO = 1;
-    // link channel dmaUpdateAddress, enable major channel-to-channel linking, don't clear enable on major loop complete
-    dmaOutputAddress.TCD->CSR = (dmaUpdateAddress.channel << 8) | (1 << 5);
-    dmaOutputAddress.triggerAtHardwareEvent(DMAMUX_SOURCE_LATCH_RISING_EDGE);
-
-    // dmaUpdateAddress - copy address values from current position in array to buffer to temporarily hold row values for the next timer cycle
-    // only use single major loop, never disable channel
-    dmaUpdateAddress.TCD->SADDR = &((matrixUpdateBlock*)matrixUpdateBlocks)->addressValues;
-    dmaUpdateAddress.TCD->SOFF = sizeof(uint16_t);
-    dmaUpdateAddress.TCD->SLAST = sizeof(matrixUpdateBlock) - (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * sizeof(uint16_t));
-    dmaUpdateAddress.TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
-    // 16-bit = 2 bytes transferred
-    // transfer two 16-bit values, reset destination address back after each minor loop
-    dmaUpdateAddress.TCD->NBYTES_MLOFFNO = (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * sizeof(uint16_t));
-    // start with the register that's the highest location in memory and make offset decrement to avoid negative number in NBYTES_MLOFFYES register (TODO: can switch order by masking negative offset)
-    dmaUpdateAddress.TCD->DADDR = &gpiosync.gpio_pcor;
-    dmaUpdateAddress.TCD->DOFF = (int)&gpiosync.gpio_psor - (int)&gpiosync.gpio_pcor;
-    dmaUpdateAddress.TCD->DLASTSGA = (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * ((int)&gpiosync.gpio_pcor - (int)&gpiosync.gpio_psor));
-    // no minor loop linking, single major loop, single minor loop, don't clear enable after major loop complete
-    dmaUpdateAddress.TCD->CITER_ELINKNO = 1;
-    dmaUpdateAddress.TCD->BITER_ELINKNO = 1;
-    dmaUpdateAddress.TCD->CSR = 0;
-#endif
+// fills tempRow0 and tempRow1 with the row pair from each layer, one matrixWidth section per panel in the order the panels are chained
+// returns the cycle count at the end of the last layer so packing can be profiled from there
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+template <typename RGB>
+INLINE uint32_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::fillRefreshRows(unsigned char currentRow, RGB tempRow0[], RGB tempRow1[]) {
+    int i, row0, row1;
 
-    // dmaUpdateTimer - on latch falling edge, load FTM1_CV1 and FTM1_MOD with with next values from current block
-    // only use single major loop, never disable channel
-    // link to dmaClockOutData channel when complete
-    dmaUpdateTimer.TCD->SADDR = &((matrixUpdateBlock*)matrixUpdateBlocks)->timerValues.timer_oe;
-    dmaUpdateTimer.TCD->SOFF = sizeof(uint16_t);
-    dmaUpdateTimer.TCD->SLAST = sizeof(matrixUpdateBlock) - (TIMER_REGISTERS_TO_UPDATE * sizeof(uint16_t));
-    dmaUpdateTimer.TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
-    // 16-bit = 2 bytes transferred
-    dmaUpdateTimer.TCD->NBYTES_MLOFFNO = TIMER_REGISTERS_TO_UPDATE * sizeof(uint16_t);
-    dmaUpdateTimer.TCD->DADDR = &FTM1_C1V;
-    dmaUpdateTimer.TCD->DOFF = (int)&FTM1_MOD - (int)&FTM1_C1V;
-    dmaUpdateTimer.TCD->DLASTSGA = TIMER_REGISTERS_TO_UPDATE * ((int)&FTM1_C1V - (int)&FTM1_MOD);
-    // no minor loop linking, single major loop
-    dmaUpdateTimer.TCD->CITER_ELINKNO = 1;
-    dmaUpdateTimer.TCD->BITER_ELINKNO = 1;
-    // link dmaClockOutData channel, enable major channel-to-channel linking, don't clear enable after major loop complete
-    dmaUpdateTimer.TCD->CSR = (dmaClockOutData.channel << 8) | (1 << 5);
-    dmaUpdateTimer.triggerAtHardwareEvent(DMAMUX_SOURCE_LATCH_FALLING_EDGE);
-
-#define DMA_TCD_MLOFF_MASK  (0x3FFFFC00)
-
-    // dmaClockOutData - repeatedly load gpio_array into GPIOD_PDOR, stop and int on major loop complete
-    dmaClockOutData.TCD->SADDR = matrixUpdateData;
-    dmaClockOutData.TCD->SOFF = latchesPerRow;
-    // SADDR will get updated by ISR, no need to set SLAST
-    dmaClockOutData.TCD->SLAST = 0;
-    dmaClockOutData.TCD->ATTR = DMA_TCD_ATTR_SSIZE(0) | DMA_TCD_ATTR_DSIZE(0);
-    // after each minor loop, set source to point back to the beginning of this set of data,
-    // but advance by 1 byte to get the next significant bits data
-    dmaClockOutData.TCD->NBYTES_MLOFFYES = DMA_TCD_NBYTES_SMLOE |
-                               (((1 - (latchesPerRow * (PIXELS_PER_LATCH * DMA_UPDATES_PER_CLOCK + ADDX_UPDATE_BEFORE_LATCH_BYTES))) << 10) & DMA_TCD_MLOFF_MASK) |
-                               (PIXELS_PER_LATCH * DMA_UPDATES_PER_CLOCK + ADDX_UPDATE_BEFORE_LATCH_BYTES);
-    dmaClockOutData.TCD->DADDR = &GPIOD_PDOR;
-    dmaClockOutData.TCD->DOFF = 0;
-    dmaClockOutData.TCD->DLASTSGA = 0;
-    dmaClockOutData.TCD->CITER_ELINKNO = latchesPerRow;
-    dmaClockOutData.TCD->BITER_ELINKNO = latchesPerRow;
-    // int after major loop is complete
-    dmaClockOutData.TCD->CSR = DMA_TCD_CSR_INTMAJOR;
-    
-    // for debugging - enable bandwidth control (space out GPIO updates so they can be seen easier on a low-bandwidth logic analyzer)
-    // enable for now, until DMA sharing complications (brought to light by Teensy 3.6 SDIO) can be worked out - use bandwidth control to space out our DMA access and allow SD reads to not slow down shifting to the matrix
-    // also enable for now, until it can be selectively enabled for higher clock speeds (140MHz+) where the data rate is too high for the panel
-    dmaClockOutData.TCD->CSR |= (0x02 << 14);
+    SM_Layer * templayer = globalinstance->baseLayer;
+    uint8_t layerStage = profileStageLayer0;
+    uint32_t stageStartCycles = profileStart();
+    while(templayer) {
+        uint8_t opacity = templayer->getOpacity();
+        blendModes blendMode = templayer->getBlendMode();
 
-    // enable a done interrupt when all DMA operations are complete
-    dmaClockOutData.attachInterrupt(rowShiftCompleteISR<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>);
+        for(i=0; i<MATRIX_STACK_HEIGHT; i++) {
+            getPanelRows(currentRow, i, &row0, &row1);
+            if(opacity == 255 && blendMode == blendNormal) {
+                // opaque layer overwrites the pixels it draws
+                templayer->fillRefreshRow(row0, &tempRow0[i*matrixWidth]);
+                templayer->fillRefreshRow(row1, &tempRow1[i*matrixWidth]);
+            } else if(opacity) {
+                blendRefreshRow(templayer, row0, &tempRow0[i*matrixWidth]);
+                blendRefreshRow(templayer, row1, &tempRow1[i*matrixWidth]);
+            }
+        }
+        templayer = templayer->nextLayer;
+        stageStartCycles = profileRecord(layerStage++, stageStartCycles);
+    }
 
-    // enable additional dma interrupt used as software interrupt
-    NVIC_SET_PRIORITY(IRQ_DMA_CH0 + dmaUpdateTimer.channel, ROW_CALCULATION_ISR_PRIORITY);
-    dmaUpdateTimer.attachInterrupt(rowCalculationISR<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>);
+    return stageStartCycles;
+}
 
-#ifndef ADDX_UPDATE_ON_DATA_PINS
-    dmaOutputAddress.enable();
-    dmaUpdateAddress.enable();
-#endif
-    dmaUpdateTimer.enable();
-    dmaClockOutData.enable();
+// spread the low four bits of x to bit 0 of four consecutive bytes (bit n moves to bit 8n)
+// the multiply adds copies of x shifted by 0, 7, 14, and 21 bits, the mask keeps one bit from each copy
+#define SPREAD_NIBBLE_TO_BYTES(x)   ((((uint32_t)(x) & 0x0F) * 0x00204081) & 0x01010101)
+
+// transpose the six color channels for a pixel pair into bit planes, one byte per latch from LSB to MSB
+// instead of setting a bitfield per channel per bit plane, four bit planes of a channel are spread into a word at once,
+// then moved to the bit the channel uses in each byte: latchesPerRow/4 words with clock low, then the same words with clock high
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::packBitPlanes(uint32_t * wordptr,
+    uint16_t red0, uint16_t green0, uint16_t blue0, uint16_t red1, uint16_t green1, uint16_t blue1) {
+    unsigned int i;
 
-    // at the end after everything is set up: enable timer from system clock, with appropriate prescale
-    FTM1_SC = FTM_SC_CLKS(1) | FTM_SC_PS(LATCH_TIMER_PRESCALE);
+    // this technique is from Fadecandy, here the bitfields are only used to find each signal's position in the byte
+    union {
+        uint32_t word;
+        struct {
+            // order of bits in word matches how GPIO connects to the display
+            uint32_t GPIO_WORD_ORDER;
+        };
+    } r1, g1, b1, r2, g2, b2, clk;
+
+    r1.word = 0;
+    r1.p0r1 = 1;
+    g1.word = 0;
+    g1.p0g1 = 1;
+    b1.word = 0;
+    b1.p0b1 = 1;
+    r2.word = 0;
+    r2.p0r2 = 1;
+    g2.word = 0;
+    g2.p0g2 = 1;
+    b2.word = 0;
+    b2.p0b2 = 1;
+    clk.word = 0;
+    clk.p0clk = 1;
+
+    uint32_t clkset = SPREAD_NIBBLE_TO_BYTES(0x0F) * clk.word;
+
+    for (i = 0; i < latchesPerRow/sizeof(uint32_t); i++) {
+        int shift = i * sizeof(uint32_t);
+        uint32_t word = (SPREAD_NIBBLE_TO_BYTES(red0 >> shift) * r1.word) |
+            (SPREAD_NIBBLE_TO_BYTES(green0 >> shift) * g1.word) |
+            (SPREAD_NIBBLE_TO_BYTES(blue0 >> shift) * b1.word) |
+            (SPREAD_NIBBLE_TO_BYTES(red1 >> shift) * r2.word) |
+            (SPREAD_NIBBLE_TO_BYTES(green1 >> shift) * g2.word) |
+            (SPREAD_NIBBLE_TO_BYTES(blue1 >> shift) * b2.word);
+
+        // copy words to DMA buffer as a pair, one with clock set low, next with clock set high
+        wordptr[i] = word;
+        wordptr[i + latchesPerRow/sizeof(uint32_t)] = word | clkset;
+    }
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers48(unsigned char currentRow, unsigned char freeRowBuffer) {
-    int i;
+    int i, j, k;
 
     // static to avoid putting large buffer on the stack
     static rgb48 tempRow0[PIXELS_PER_LATCH];
     static rgb48 tempRow1[PIXELS_PER_LATCH];
 
     // clear buffer to prevent garbage data showing through transparent layers
-    memset(tempRow0, 0x00, sizeof(tempRow0));
-    memset(tempRow1, 0x00, sizeof(tempRow1));
+    memset((uint8_t *)tempRow0, 0x00, sizeof(tempRow0));
+    memset((uint8_t *)tempRow1, 0x00, sizeof(tempRow1));
 
     // get pixel data from layers
-    SM_Layer * templayer = globalinstance->baseLayer;
-    while(templayer) {
-        for(i=0; i<MATRIX_STACK_HEIGHT; i++) {
-            // Z-shape, bottom to top
-            if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                // fill data from bottom to top, so bottom panel is the one closest to Teensy
-                templayer->fillRefreshRow(currentRow + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                templayer->fillRefreshRow(currentRow + matrixRowPairOffset + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-            // Z-shape, top to bottom
-            } else if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                // fill data from top to bottom, so top panel is the one closest to Teensy
-                templayer->fillRefreshRow(currentRow + i*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                templayer->fillRefreshRow(currentRow + matrixRowPairOffset + i*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-            // C-shape, bottom to top
-            } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                // alternate direction of filling (or loading) for each matrixwidth
-                // swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half)
-                if((MATRIX_STACK_HEIGHT-i+1)%2) {
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + matrixRowPairOffset + (i)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + (i)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                } else {
-                    templayer->fillRefreshRow(currentRow + (i)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow(currentRow + matrixRowPairOffset + (i)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                }
-            // C-shape, top to bottom
-            } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && 
-                !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                if((MATRIX_STACK_HEIGHT-i)%2) {
-                    templayer->fillRefreshRow(currentRow + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow(currentRow + matrixRowPairOffset + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                } else {
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + matrixRowPairOffset + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                }
-            }
-        }
-        templayer = templayer->nextLayer;        
-    }
-
-    for (i = 0; i < PIXELS_PER_LATCH; i++) {
-        uint16_t temp0red,temp0green,temp0blue,temp1red,temp1green,temp1blue;
+    uint32_t stageStartCycles = fillRefreshRows(currentRow, tempRow0, tempRow1);
 
+    // loop over each panel in the chain so stacking options are resolved once per panel instead of once per pixel
+    for (j = 0; j < MATRIX_STACK_HEIGHT; j++) {
         // for upside down stacks, flip order
-        if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
-            int tempPosition = ((i/matrixWidth) * matrixWidth) + matrixWidth - i%matrixWidth - 1;
+        bool flipPanel = (optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !(j%2);
+
+        for (k = 0; k < matrixWidth; k++) {
+            uint16_t temp0red,temp0green,temp0blue,temp1red,temp1green,temp1blue;
+            i = j*matrixWidth + k;
+            int tempPosition = flipPanel ? (j*matrixWidth + matrixWidth - k - 1) : i;
             temp0red = tempRow0[tempPosition].red;
             temp0green = tempRow0[tempPosition].green;
             temp0blue = tempRow0[tempPosition].blue;
             temp1red = tempRow1[tempPosition].red;
             temp1green = tempRow1[tempPosition].green;
             temp1blue = tempRow1[tempPosition].blue;
-        } else {
-            temp0red = tempRow0[i].red;
-            temp0green = tempRow0[i].green;
-            temp0blue = tempRow0[i].blue;
-            temp1red = tempRow1[i].red;
-            temp1green = tempRow1[i].green;
-            temp1blue = tempRow1[i].blue;
-        }
-
-
-#if 0
-        if(latchesPerRow == 12) {
-            temp0red >>= 4;
-            temp0green >>= 4;
-            temp0blue >>= 4;
-
-            temp1red >>= 4;
-            temp1green >>= 4;
-            temp1blue >>= 4;
+            uint32_t * tempptr = (uint32_t*)matrixUpdateData + ((freeRowBuffer*dmaBufferBytesPerRow)/sizeof(uint32_t)) + ((i*dmaBufferBytesPerPixel)/sizeof(uint32_t));
+            packBitPlanes(tempptr, temp0red, temp0green, temp0blue, temp1red, temp1green, temp1blue);
         }
-
-        if(latchesPerRow == 8) {
-            temp0red >>= 8;
-            temp0green >>= 8;
-            temp0blue >>= 8;
-
-            temp1red >>= 8;
-            temp1green >>= 8;
-            temp1blue >>= 8;
-        }
-#endif
-
-        // this technique is from Fadecandy
-        union {
-            uint32_t word;
-            struct {
-                // order of bits in word matches how GPIO connects to the display
-                uint32_t GPIO_WORD_ORDER;
-            };
-        } o0, o1, clkset;
-
-        o0.word = 0;
-        // set bits starting from LSB brightness moving to MSB brightness with each byte across the word
-        // each word contains four brightness levels for single set of pixels above
-        // o0.p0clk = 0;
-        // o0.p0pad = 0;
-        o0.p0b1 = temp0blue    >> 0;
-        o0.p0r1 = temp0red     >> 0;
-        o0.p0r2 = temp1red     >> 0;
-        o0.p0g1 = temp0green   >> 0;
-        o0.p0g2 = temp1green   >> 0;
-        o0.p0b2 = temp1blue    >> 0;
-
-        // o0.p1clk = 0;
-        // o0.p1pad = 0;
-        o0.p1b1 = temp0blue    >> 1;
-        o0.p1r1 = temp0red     >> 1;
-        o0.p1r2 = temp1red     >> 1;
-        o0.p1g1 = temp0green   >> 1;
-        o0.p1g2 = temp1green   >> 1;
-        o0.p1b2 = temp1blue    >> 1;
-
-        // o0.p2clk = 0;
-        // o0.p2pad = 0;
-        o0.p2b1 = temp0blue    >> 2;
-        o0.p2r1 = temp0red     >> 2;
-        o0.p2r2 = temp1red     >> 2;
-        o0.p2g1 = temp0green   >> 2;
-        o0.p2g2 = temp1green   >> 2;
-        o0.p2b2 = temp1blue    >> 2;
-
-        // o0.p3clk = 0;
-        // o0.p3pad = 0;
-        o0.p3b1 = temp0blue    >> 3;
-        o0.p3r1 = temp0red     >> 3;
-        o0.p3r2 = temp1red     >> 3;
-        o0.p3g1 = temp0green   >> 3;
-        o0.p3g2 = temp1green   >> 3;
-        o0.p3b2 = temp1blue    >> 3;
-
-
-        // continue moving from LSB to MSB brightness with the next word
-        o1.word = 0;
-        // o1.p0clk = 0;
-        // o1.p0pad = 0;
-        o1.p0b1 = temp0blue    >> (0 + 1 * sizeof(uint32_t));
-        o1.p0r1 = temp0red     >> (0 + 1 * sizeof(uint32_t));
-        o1.p0r2 = temp1red     >> (0 + 1 * sizeof(uint32_t));
-        o1.p0g1 = temp0green   >> (0 + 1 * sizeof(uint32_t));
-        o1.p0g2 = temp1green   >> (0 + 1 * sizeof(uint32_t));
-        o1.p0b2 = temp1blue    >> (0 + 1 * sizeof(uint32_t));
-
-        // o1.p1clk = 0;
-        // o1.p1pad = 0;
-        o1.p1b1 = temp0blue    >> (1 + 1 * sizeof(uint32_t));
-        o1.p1r1 = temp0red     >> (1 + 1 * sizeof(uint32_t));
-        o1.p1r2 = temp1red     >> (1 + 1 * sizeof(uint32_t));
-        o1.p1g1 = temp0green   >> (1 + 1 * sizeof(uint32_t));
-        o1.p1g2 = temp1green   >> (1 + 1 * sizeof(uint32_t));
-        o1.p1b2 = temp1blue    >> (1 + 1 * sizeof(uint32_t));
-
-        // o1.p2clk = 0;
-        // o1.p2pad = 0;
-        o1.p2b1 = temp0blue    >> (2 + 1 * sizeof(uint32_t));
-        o1.p2r1 = temp0red     >> (2 + 1 * sizeof(uint32_t));
-        o1.p2r2 = temp1red     >> (2 + 1 * sizeof(uint32_t));
-        o1.p2g1 = temp0green   >> (2 + 1 * sizeof(uint32_t));
-        o1.p2g2 = temp1green   >> (2 + 1 * sizeof(uint32_t));
-        o1.p2b2 = temp1blue    >> (2 + 1 * sizeof(uint32_t));
-
-        // o1.p3clk = 0;
-        // o1.p3pad = 0;
-        o1.p3b1 = temp0blue    >> (3 + 1 * sizeof(uint32_t));
-        o1.p3r1 = temp0red     >> (3 + 1 * sizeof(uint32_t));
-        o1.p3r2 = temp1red     >> (3 + 1 * sizeof(uint32_t));
-        o1.p3g1 = temp0green   >> (3 + 1 * sizeof(uint32_t));
-        o1.p3g2 = temp1green   >> (3 + 1 * sizeof(uint32_t));
-        o1.p3b2 = temp1blue    >> (3 + 1 * sizeof(uint32_t));
-
-        clkset.word = 0x00;
-        clkset.p0clk = 1;
-        clkset.p1clk = 1;
-        clkset.p2clk = 1;
-        clkset.p3clk = 1;
-
-        // copy words to DMA buffer as a pair, one with clock set low, next with clock set high
-
-        uint32_t * tempptr = (uint32_t*)matrixUpdateData + ((freeRowBuffer*dmaBufferBytesPerRow)/sizeof(uint32_t)) + ((i*dmaBufferBytesPerPixel)/sizeof(uint32_t));
-        *tempptr = o0.word;
-        *(tempptr + latchesPerRow/sizeof(uint32_t)) = o0.word | clkset.word;
-        *(++tempptr) = o1.word;
-        *(tempptr + latchesPerRow/sizeof(uint32_t)) = o1.word | clkset.word;
-
-        //if(latchesPerRow >= 12) {
-            union {
-                uint32_t word;
-                struct {
-                    // order of bits in word matches how GPIO connects to the display
-                    uint32_t GPIO_WORD_ORDER;
-                };
-            } o2;
-
-            o2.word = 0;
-            //o2.p0clk = 0;
-            //o2.p0pad = 0;
-            o2.p0b1 = temp0blue    >> (0 + 2 * sizeof(uint32_t));
-            o2.p0r1 = temp0red     >> (0 + 2 * sizeof(uint32_t));
-            o2.p0r2 = temp1red     >> (0 + 2 * sizeof(uint32_t));
-            o2.p0g1 = temp0green   >> (0 + 2 * sizeof(uint32_t));
-            o2.p0g2 = temp1green   >> (0 + 2 * sizeof(uint32_t));
-            o2.p0b2 = temp1blue    >> (0 + 2 * sizeof(uint32_t));
-
-            //o2.p1clk = 0;
-            //o2.p1pad = 0;
-            o2.p1b1 = temp0blue    >> (1 + 2 * sizeof(uint32_t));
-            o2.p1r1 = temp0red     >> (1 + 2 * sizeof(uint32_t));
-            o2.p1r2 = temp1red     >> (1 + 2 * sizeof(uint32_t));
-            o2.p1g1 = temp0green   >> (1 + 2 * sizeof(uint32_t));
-            o2.p1g2 = temp1green   >> (1 + 2 * sizeof(uint32_t));
-            o2.p1b2 = temp1blue    >> (1 + 2 * sizeof(uint32_t));
-
-            //o2.p2clk = 0;
-            //o2.p2pad = 0;
-            o2.p2b1 = temp0blue    >> (2 + 2 * sizeof(uint32_t));
-            o2.p2r1 = temp0red     >> (2 + 2 * sizeof(uint32_t));
-            o2.p2r2 = temp1red     >> (2 + 2 * sizeof(uint32_t));
-            o2.p2g1 = temp0green   >> (2 + 2 * sizeof(uint32_t));
-            o2.p2g2 = temp1green   >> (2 + 2 * sizeof(uint32_t));
-            o2.p2b2 = temp1blue    >> (2 + 2 * sizeof(uint32_t));
-
-
-            //o2.p3clk = 0;
-            //o2.p3pad = 0;
-            o2.p3b1 = temp0blue    >> (3 + 2 * sizeof(uint32_t));
-            o2.p3r1 = temp0red     >> (3 + 2 * sizeof(uint32_t));
-            o2.p3r2 = temp1red     >> (3 + 2 * sizeof(uint32_t));
-            o2.p3g1 = temp0green   >> (3 + 2 * sizeof(uint32_t));
-            o2.p3g2 = temp1green   >> (3 + 2 * sizeof(uint32_t));
-            o2.p3b2 = temp1blue    >> (3 + 2 * sizeof(uint32_t));
-
-            *(++tempptr) = o2.word;
-            *(tempptr + latchesPerRow/sizeof(uint32_t)) = o2.word | clkset.word;
-        //}
-
-        //if(latchesPerRow == 16) {
-            union {
-                uint32_t word;
-                struct {
-                    // order of bits in word matches how GPIO connects to the display
-                    uint32_t GPIO_WORD_ORDER;
-                };
-            } o3;
-
-            o3.word = 0;
-            //o3.p0clk = 0;
-            //o3.p0pad = 0;
-            o3.p0b1 = temp0blue    >> (0 + 3 * sizeof(uint32_t));
-            o3.p0r1 = temp0red     >> (0 + 3 * sizeof(uint32_t));
-            o3.p0r2 = temp1red     >> (0 + 3 * sizeof(uint32_t));
-            o3.p0g1 = temp0green   >> (0 + 3 * sizeof(uint32_t));
-            o3.p0g2 = temp1green   >> (0 + 3 * sizeof(uint32_t));
-            o3.p0b2 = temp1blue    >> (0 + 3 * sizeof(uint32_t));
-
-            //o3.p1clk = 0;
-            //o3.p1pad = 0;
-            o3.p1b1 = temp0blue    >> (1 + 3 * sizeof(uint32_t));
-            o3.p1r1 = temp0red     >> (1 + 3 * sizeof(uint32_t));
-            o3.p1r2 = temp1red     >> (1 + 3 * sizeof(uint32_t));
-            o3.p1g1 = temp0green   >> (1 + 3 * sizeof(uint32_t));
-            o3.p1g2 = temp1green   >> (1 + 3 * sizeof(uint32_t));
-            o3.p1b2 = temp1blue    >> (1 + 3 * sizeof(uint32_t));
-
-            //o3.p2clk = 0;
-            //o3.p2pad = 0;
-            o3.p2b1 = temp0blue    >> (2 + 3 * sizeof(uint32_t));
-            o3.p2r1 = temp0red     >> (2 + 3 * sizeof(uint32_t));
-            o3.p2r2 = temp1red     >> (2 + 3 * sizeof(uint32_t));
-            o3.p2g1 = temp0green   >> (2 + 3 * sizeof(uint32_t));
-            o3.p2g2 = temp1green   >> (2 + 3 * sizeof(uint32_t));
-            o3.p2b2 = temp1blue    >> (2 + 3 * sizeof(uint32_t));
-
-
-            //o3.p3clk = 0;
-            //o3.p3pad = 0;
-            o3.p3b1 = temp0blue    >> (3 + 3 * sizeof(uint32_t));
-            o3.p3r1 = temp0red     >> (3 + 3 * sizeof(uint32_t));
-            o3.p3r2 = temp1red     >> (3 + 3 * sizeof(uint32_t));
-            o3.p3g1 = temp0green   >> (3 + 3 * sizeof(uint32_t));
-            o3.p3g2 = temp1green   >> (3 + 3 * sizeof(uint32_t));
-            o3.p3b2 = temp1blue    >> (3 + 3 * sizeof(uint32_t));
-
-            *(++tempptr) = o3.word;
-            *(tempptr + latchesPerRow/sizeof(uint32_t)) = o3.word | clkset.word;
-        //}
     }
 
 #if (ADDX_UPDATE_BEFORE_LATCH_BYTES > 0)
@@ -988,321 +841,61 @@ INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, opt
     *tempptr2 = o0.word;
     // stop after 4th word for 48 bit color
 #endif
+
+    profileRecord(profileStagePacking, stageStartCycles);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers36(unsigned char currentRow, unsigned char freeRowBuffer) {
-    int i;
+    int i, j, k;
 
     // static to avoid putting large buffer on the stack
     static rgb48 tempRow0[PIXELS_PER_LATCH];
     static rgb48 tempRow1[PIXELS_PER_LATCH];
 
     // clear buffer to prevent garbage data showing through transparent layers
-    memset(tempRow0, 0x00, sizeof(tempRow0));
-    memset(tempRow1, 0x00, sizeof(tempRow1));
+    memset((uint8_t *)tempRow0, 0x00, sizeof(tempRow0));
+    memset((uint8_t *)tempRow1, 0x00, sizeof(tempRow1));
 
     // get pixel data from layers
-    SM_Layer * templayer = globalinstance->baseLayer;
-    while(templayer) {
-        for(i=0; i<MATRIX_STACK_HEIGHT; i++) {
-            // Z-shape, bottom to top
-            if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                // fill data from bottom to top, so bottom panel is the one closest to Teensy
-                templayer->fillRefreshRow(currentRow + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                templayer->fillRefreshRow(currentRow + matrixRowPairOffset + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-            // Z-shape, top to bottom
-            } else if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                // fill data from top to bottom, so top panel is the one closest to Teensy
-                templayer->fillRefreshRow(currentRow + i*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                templayer->fillRefreshRow(currentRow + matrixRowPairOffset + i*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-            // C-shape, bottom to top
-            } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                // alternate direction of filling (or loading) for each matrixwidth
-                // swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half)
-                if((MATRIX_STACK_HEIGHT-i+1)%2) {
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + matrixRowPairOffset + (i)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + (i)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                } else {
-                    templayer->fillRefreshRow(currentRow + (i)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow(currentRow + matrixRowPairOffset + (i)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                }
-            // C-shape, top to bottom
-            } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && 
-                !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                if((MATRIX_STACK_HEIGHT-i)%2) {
-                    templayer->fillRefreshRow(currentRow + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow(currentRow + matrixRowPairOffset + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                } else {
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + matrixRowPairOffset + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                }
-            }
-        }
-        templayer = templayer->nextLayer;        
-    }
+    uint32_t stageStartCycles = fillRefreshRows(currentRow, tempRow0, tempRow1);
 
-    for (i = 0; i < PIXELS_PER_LATCH; i++) {
-        uint16_t temp0red,temp0green,temp0blue,temp1red,temp1green,temp1blue;
+    // loop over each panel in the chain so stacking options are resolved once per panel instead of once per pixel
+    for (j = 0; j < MATRIX_STACK_HEIGHT; j++) {
+        // for upside down stacks, flip order
+        bool flipPanel = (optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !(j%2);
+
+        for (k = 0; k < matrixWidth; k++) {
+            uint16_t temp0red,temp0green,temp0blue,temp1red,temp1green,temp1blue;
 
 #ifdef DEBUG_PINS_ENABLED
     digitalWriteFast(DEBUG_PIN_3, HIGH); // oscilloscope trigger
 #endif
-
-        // for upside down stacks, flip order
-        if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
-            int tempPosition = ((i/matrixWidth) * matrixWidth) + matrixWidth - i%matrixWidth - 1;
+            i = j*matrixWidth + k;
+            int tempPosition = flipPanel ? (j*matrixWidth + matrixWidth - k - 1) : i;
             temp0red = tempRow0[tempPosition].red;
             temp0green = tempRow0[tempPosition].green;
             temp0blue = tempRow0[tempPosition].blue;
             temp1red = tempRow1[tempPosition].red;
             temp1green = tempRow1[tempPosition].green;
             temp1blue = tempRow1[tempPosition].blue;
-        } else {
-            temp0red = tempRow0[i].red;
-            temp0green = tempRow0[i].green;
-            temp0blue = tempRow0[i].blue;
-            temp1red = tempRow1[i].red;
-            temp1green = tempRow1[i].green;
-            temp1blue = tempRow1[i].blue;
-        }
 
-        //if(latchesPerRow == 12) {
-            temp0red >>= 4;
-            temp0green >>= 4;
-            temp0blue >>= 4;
-
-            temp1red >>= 4;
-            temp1green >>= 4;
-            temp1blue >>= 4;
-        //}
-
-#if 0
-        if(latchesPerRow == 8) {
-            temp0red >>= 8;
-            temp0green >>= 8;
-            temp0blue >>= 8;
-
-            temp1red >>= 8;
-            temp1green >>= 8;
-            temp1blue >>= 8;
-        }
-#endif
+            //if(latchesPerRow == 12) {
+                temp0red >>= 4;
+                temp0green >>= 4;
+                temp0blue >>= 4;
 
-        // this technique is from Fadecandy
-        union {
-            uint32_t word;
-            struct {
-                // order of bits in word matches how GPIO connects to the display
-                uint32_t GPIO_WORD_ORDER;
-            };
-        } o0, o1, clkset;
-
-        o0.word = 0;
-        // set bits starting from LSB brightness moving to MSB brightness with each byte across the word
-        // each word contains four brightness levels for single set of pixels above
-        // o0.p0clk = 0;
-        // o0.p0pad = 0;
-        o0.p0b1 = temp0blue    >> 0;
-        o0.p0r1 = temp0red     >> 0;
-        o0.p0r2 = temp1red     >> 0;
-        o0.p0g1 = temp0green   >> 0;
-        o0.p0g2 = temp1green   >> 0;
-        o0.p0b2 = temp1blue    >> 0;
-
-        // o0.p1clk = 0;
-        // o0.p1pad = 0;
-        o0.p1b1 = temp0blue    >> 1;
-        o0.p1r1 = temp0red     >> 1;
-        o0.p1r2 = temp1red     >> 1;
-        o0.p1g1 = temp0green   >> 1;
-        o0.p1g2 = temp1green   >> 1;
-        o0.p1b2 = temp1blue    >> 1;
-
-        // o0.p2clk = 0;
-        // o0.p2pad = 0;
-        o0.p2b1 = temp0blue    >> 2;
-        o0.p2r1 = temp0red     >> 2;
-        o0.p2r2 = temp1red     >> 2;
-        o0.p2g1 = temp0green   >> 2;
-        o0.p2g2 = temp1green   >> 2;
-        o0.p2b2 = temp1blue    >> 2;
-
-        // o0.p3clk = 0;
-        // o0.p3pad = 0;
-        o0.p3b1 = temp0blue    >> 3;
-        o0.p3r1 = temp0red     >> 3;
-        o0.p3r2 = temp1red     >> 3;
-        o0.p3g1 = temp0green   >> 3;
-        o0.p3g2 = temp1green   >> 3;
-        o0.p3b2 = temp1blue    >> 3;
-
-
-        // continue moving from LSB to MSB brightness with the next word
-        o1.word = 0;
-        // o1.p0clk = 0;
-        // o1.p0pad = 0;
-        o1.p0b1 = temp0blue    >> (0 + 1 * sizeof(uint32_t));
-        o1.p0r1 = temp0red     >> (0 + 1 * sizeof(uint32_t));
-        o1.p0r2 = temp1red     >> (0 + 1 * sizeof(uint32_t));
-        o1.p0g1 = temp0green   >> (0 + 1 * sizeof(uint32_t));
-        o1.p0g2 = temp1green   >> (0 + 1 * sizeof(uint32_t));
-        o1.p0b2 = temp1blue    >> (0 + 1 * sizeof(uint32_t));
-
-        // o1.p1clk = 0;
-        // o1.p1pad = 0;
-        o1.p1b1 = temp0blue    >> (1 + 1 * sizeof(uint32_t));
-        o1.p1r1 = temp0red     >> (1 + 1 * sizeof(uint32_t));
-        o1.p1r2 = temp1red     >> (1 + 1 * sizeof(uint32_t));
-        o1.p1g1 = temp0green   >> (1 + 1 * sizeof(uint32_t));
-        o1.p1g2 = temp1green   >> (1 + 1 * sizeof(uint32_t));
-        o1.p1b2 = temp1blue    >> (1 + 1 * sizeof(uint32_t));
-
-        // o1.p2clk = 0;
-        // o1.p2pad = 0;
-        o1.p2b1 = temp0blue    >> (2 + 1 * sizeof(uint32_t));
-        o1.p2r1 = temp0red     >> (2 + 1 * sizeof(uint32_t));
-        o1.p2r2 = temp1red     >> (2 + 1 * sizeof(uint32_t));
-        o1.p2g1 = temp0green   >> (2 + 1 * sizeof(uint32_t));
-        o1.p2g2 = temp1green   >> (2 + 1 * sizeof(uint32_t));
-        o1.p2b2 = temp1blue    >> (2 + 1 * sizeof(uint32_t));
-
-        // o1.p3clk = 0;
-        // o1.p3pad = 0;
-        o1.p3b1 = temp0blue    >> (3 + 1 * sizeof(uint32_t));
-        o1.p3r1 = temp0red     >> (3 + 1 * sizeof(uint32_t));
-        o1.p3r2 = temp1red     >> (3 + 1 * sizeof(uint32_t));
-        o1.p3g1 = temp0green   >> (3 + 1 * sizeof(uint32_t));
-        o1.p3g2 = temp1green   >> (3 + 1 * sizeof(uint32_t));
-        o1.p3b2 = temp1blue    >> (3 + 1 * sizeof(uint32_t));
-
-        clkset.word = 0x00;
-        clkset.p0clk = 1;
-        clkset.p1clk = 1;
-        clkset.p2clk = 1;
-        clkset.p3clk = 1;
+                temp1red >>= 4;
+                temp1green >>= 4;
+                temp1blue >>= 4;
+            //}
 
-        // copy words to DMA buffer as a pair, one with clock set low, next with clock set high
-
-        uint32_t * tempptr = (uint32_t*)matrixUpdateData + ((freeRowBuffer*dmaBufferBytesPerRow)/sizeof(uint32_t)) + ((i*dmaBufferBytesPerPixel)/sizeof(uint32_t));
-        *tempptr = o0.word;
-
-        *(tempptr + latchesPerRow/sizeof(uint32_t)) = o0.word | clkset.word;
-
-        *(++tempptr) = o1.word;
-
-        *(tempptr + latchesPerRow/sizeof(uint32_t)) = o1.word | clkset.word;
- 
-        //if(latchesPerRow >= 12) {
-            union {
-                uint32_t word;
-                struct {
-                    // order of bits in word matches how GPIO connects to the display
-                    uint32_t GPIO_WORD_ORDER;
-                };
-            } o2;
-
-            o2.word = 0;
-            //o2.p0clk = 0;
-            //o2.p0pad = 0;
-            o2.p0b1 = temp0blue    >> (0 + 2 * sizeof(uint32_t));
-            o2.p0r1 = temp0red     >> (0 + 2 * sizeof(uint32_t));
-            o2.p0r2 = temp1red     >> (0 + 2 * sizeof(uint32_t));
-            o2.p0g1 = temp0green   >> (0 + 2 * sizeof(uint32_t));
-            o2.p0g2 = temp1green   >> (0 + 2 * sizeof(uint32_t));
-            o2.p0b2 = temp1blue    >> (0 + 2 * sizeof(uint32_t));
-
-            //o2.p1clk = 0;
-            //o2.p1pad = 0;
-            o2.p1b1 = temp0blue    >> (1 + 2 * sizeof(uint32_t));
-            o2.p1r1 = temp0red     >> (1 + 2 * sizeof(uint32_t));
-            o2.p1r2 = temp1red     >> (1 + 2 * sizeof(uint32_t));
-            o2.p1g1 = temp0green   >> (1 + 2 * sizeof(uint32_t));
-            o2.p1g2 = temp1green   >> (1 + 2 * sizeof(uint32_t));
-            o2.p1b2 = temp1blue    >> (1 + 2 * sizeof(uint32_t));
-
-            //o2.p2clk = 0;
-            //o2.p2pad = 0;
-            o2.p2b1 = temp0blue    >> (2 + 2 * sizeof(uint32_t));
-            o2.p2r1 = temp0red     >> (2 + 2 * sizeof(uint32_t));
-            o2.p2r2 = temp1red     >> (2 + 2 * sizeof(uint32_t));
-            o2.p2g1 = temp0green   >> (2 + 2 * sizeof(uint32_t));
-            o2.p2g2 = temp1green   >> (2 + 2 * sizeof(uint32_t));
-            o2.p2b2 = temp1blue    >> (2 + 2 * sizeof(uint32_t));
-
-
-            //o2.p3clk = 0;
-            //o2.p3pad = 0;
-            o2.p3b1 = temp0blue    >> (3 + 2 * sizeof(uint32_t));
-            o2.p3r1 = temp0red     >> (3 + 2 * sizeof(uint32_t));
-            o2.p3r2 = temp1red     >> (3 + 2 * sizeof(uint32_t));
-            o2.p3g1 = temp0green   >> (3 + 2 * sizeof(uint32_t));
-            o2.p3g2 = temp1green   >> (3 + 2 * sizeof(uint32_t));
-            o2.p3b2 = temp1blue    >> (3 + 2 * sizeof(uint32_t));
-
-            *(++tempptr) = o2.word;
-            
-            *(tempptr + latchesPerRow/sizeof(uint32_t)) = o2.word | clkset.word;
-        //}
+            uint32_t * tempptr = (uint32_t*)matrixUpdateData + ((freeRowBuffer*dmaBufferBytesPerRow)/sizeof(uint32_t)) + ((i*dmaBufferBytesPerPixel)/sizeof(uint32_t));
+            packBitPlanes(tempptr, temp0red, temp0green, temp0blue, temp1red, temp1green, temp1blue);
 #ifdef DEBUG_PINS_ENABLED
     digitalWriteFast(DEBUG_PIN_3, LOW); // oscilloscope trigger
 #endif
-
-#if 0
-        if(latchesPerRow == 16) {
-            union {
-                uint32_t word;
-                struct {
-                    // order of bits in word matches how GPIO connects to the display
-                    uint32_t GPIO_WORD_ORDER;
-                };
-            } o3;
-
-            o3.word = 0;
-            //o3.p0clk = 0;
-            //o3.p0pad = 0;
-            o3.p0b1 = temp0blue    >> (0 + 3 * sizeof(uint32_t));
-            o3.p0r1 = temp0red     >> (0 + 3 * sizeof(uint32_t));
-            o3.p0r2 = temp1red     >> (0 + 3 * sizeof(uint32_t));
-            o3.p0g1 = temp0green   >> (0 + 3 * sizeof(uint32_t));
-            o3.p0g2 = temp1green   >> (0 + 3 * sizeof(uint32_t));
-            o3.p0b2 = temp1blue    >> (0 + 3 * sizeof(uint32_t));
-
-            //o3.p1clk = 0;
-            //o3.p1pad = 0;
-            o3.p1b1 = temp0blue    >> (1 + 3 * sizeof(uint32_t));
-            o3.p1r1 = temp0red     >> (1 + 3 * sizeof(uint32_t));
-            o3.p1r2 = temp1red     >> (1 + 3 * sizeof(uint32_t));
-            o3.p1g1 = temp0green   >> (1 + 3 * sizeof(uint32_t));
-            o3.p1g2 = temp1green   >> (1 + 3 * sizeof(uint32_t));
-            o3.p1b2 = temp1blue    >> (1 + 3 * sizeof(uint32_t));
-
-            //o3.p2clk = 0;
-            //o3.p2pad = 0;
-            o3.p2b1 = temp0blue    >> (2 + 3 * sizeof(uint32_t));
-            o3.p2r1 = temp0red     >> (2 + 3 * sizeof(uint32_t));
-            o3.p2r2 = temp1red     >> (2 + 3 * sizeof(uint32_t));
-            o3.p2g1 = temp0green   >> (2 + 3 * sizeof(uint32_t));
-            o3.p2g2 = temp1green   >> (2 + 3 * sizeof(uint32_t));
-            o3.p2b2 = temp1blue    >> (2 + 3 * sizeof(uint32_t));
-
-
-            //o3.p3clk = 0;
-            //o3.p3pad = 0;
-            o3.p3b1 = temp0blue    >> (3 + 3 * sizeof(uint32_t));
-            o3.p3r1 = temp0red     >> (3 + 3 * sizeof(uint32_t));
-            o3.p3r2 = temp1red     >> (3 + 3 * sizeof(uint32_t));
-            o3.p3g1 = temp0green   >> (3 + 3 * sizeof(uint32_t));
-            o3.p3g2 = temp1green   >> (3 + 3 * sizeof(uint32_t));
-            o3.p3b2 = temp1blue    >> (3 + 3 * sizeof(uint32_t));
-
-            *(++tempptr) = o3.word;
-            *(tempptr + latchesPerRow/sizeof(uint32_t)) = o3.word | clkset.word;
         }
-#endif
     }
 
 #if (ADDX_UPDATE_BEFORE_LATCH_BYTES > 0)
@@ -1349,184 +942,43 @@ INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, opt
     *tempptr2 = o0.word;
     // stop after 3rd word for 36 bit color
 #endif
+
+    profileRecord(profileStagePacking, stageStartCycles);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers24(unsigned char currentRow, unsigned char freeRowBuffer) {
-    int i;
+    int i, j, k;
 
     // static to avoid putting large buffer on the stack
     static rgb24 tempRow0[PIXELS_PER_LATCH];
     static rgb24 tempRow1[PIXELS_PER_LATCH];
 
     // clear buffer to prevent garbage data showing through transparent layers
-    memset(tempRow0, 0x00, sizeof(tempRow0));
-    memset(tempRow1, 0x00, sizeof(tempRow1));
+    memset((uint8_t *)tempRow0, 0x00, sizeof(tempRow0));
+    memset((uint8_t *)tempRow1, 0x00, sizeof(tempRow1));
 
     // get pixel data from layers
-    SM_Layer * templayer = globalinstance->baseLayer;
-    while(templayer) {
-        for(i=0; i<MATRIX_STACK_HEIGHT; i++) {
-            // Z-shape, bottom to top
-            if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                // fill data from bottom to top, so bottom panel is the one closest to Teensy
-                templayer->fillRefreshRow(currentRow + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                templayer->fillRefreshRow(currentRow + matrixRowPairOffset + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-            // Z-shape, top to bottom
-            } else if(!(optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                // fill data from top to bottom, so top panel is the one closest to Teensy
-                templayer->fillRefreshRow(currentRow + i*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                templayer->fillRefreshRow(currentRow + matrixRowPairOffset + i*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-            // C-shape, bottom to top
-            } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) &&
-                (optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                // alternate direction of filling (or loading) for each matrixwidth
-                // swap row order from top to bottom for each stack (tempRow1 filled with top half of panel, tempRow0 filled with bottom half)
-                if((MATRIX_STACK_HEIGHT-i+1)%2) {
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + matrixRowPairOffset + (i)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + (i)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                } else {
-                    templayer->fillRefreshRow(currentRow + (i)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow(currentRow + matrixRowPairOffset + (i)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                }
-            // C-shape, top to bottom
-            } else if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && 
-                !(optionFlags & SMARTMATRIX_OPTIONS_BOTTOM_TO_TOP_STACKING)) {
-                if((MATRIX_STACK_HEIGHT-i)%2) {
-                    templayer->fillRefreshRow(currentRow + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow(currentRow + matrixRowPairOffset + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                } else {
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + matrixRowPairOffset + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow0[i*matrixWidth]);
-                    templayer->fillRefreshRow((matrixRowsPerFrame-currentRow-1) + (MATRIX_STACK_HEIGHT-i-1)*matrixPanelHeight, &tempRow1[i*matrixWidth]);
-                }
-            }
-        }
-        templayer = templayer->nextLayer;        
-    }
-
-    for (i = 0; i < PIXELS_PER_LATCH; i++) {
-        uint8_t temp0red,temp0green,temp0blue,temp1red,temp1green,temp1blue;
+    uint32_t stageStartCycles = fillRefreshRows(currentRow, tempRow0, tempRow1);
 
+    // loop over each panel in the chain so stacking options are resolved once per panel instead of once per pixel
+    for (j = 0; j < MATRIX_STACK_HEIGHT; j++) {
         // for upside down stacks, flip order
-        if((optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !((i/matrixWidth)%2)) {
-            int tempPosition = ((i/matrixWidth) * matrixWidth) + matrixWidth - i%matrixWidth - 1;
+        bool flipPanel = (optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !(j%2);
+
+        for (k = 0; k < matrixWidth; k++) {
+            uint8_t temp0red,temp0green,temp0blue,temp1red,temp1green,temp1blue;
+            i = j*matrixWidth + k;
+            int tempPosition = flipPanel ? (j*matrixWidth + matrixWidth - k - 1) : i;
             temp0red = tempRow0[tempPosition].red;
             temp0green = tempRow0[tempPosition].green;
             temp0blue = tempRow0[tempPosition].blue;
             temp1red = tempRow1[tempPosition].red;
             temp1green = tempRow1[tempPosition].green;
             temp1blue = tempRow1[tempPosition].blue;
-        } else {
-            temp0red = tempRow0[i].red;
-            temp0green = tempRow0[i].green;
-            temp0blue = tempRow0[i].blue;
-            temp1red = tempRow1[i].red;
-            temp1green = tempRow1[i].green;
-            temp1blue = tempRow1[i].blue;
+            uint32_t * tempptr = (uint32_t*)matrixUpdateData + ((freeRowBuffer*dmaBufferBytesPerRow)/sizeof(uint32_t)) + ((i*dmaBufferBytesPerPixel)/sizeof(uint32_t));
+            packBitPlanes(tempptr, temp0red, temp0green, temp0blue, temp1red, temp1green, temp1blue);
         }
-
-        // this technique is from Fadecandy
-        union {
-            uint32_t word;
-            struct {
-                // order of bits in word matches how GPIO connects to the display
-                uint32_t GPIO_WORD_ORDER;
-            };
-        } o0, o1, clkset;
-
-        o0.word = 0;
-        // set bits starting from LSB brightness moving to MSB brightness with each byte across the word
-        // each word contains four brightness levels for single set of pixels above
-        // o0.p0clk = 0;
-        // o0.p0pad = 0;
-        o0.p0b1 = temp0blue    >> 0;
-        o0.p0r1 = temp0red     >> 0;
-        o0.p0r2 = temp1red     >> 0;
-        o0.p0g1 = temp0green   >> 0;
-        o0.p0g2 = temp1green   >> 0;
-        o0.p0b2 = temp1blue    >> 0;
-
-        // o0.p1clk = 0;
-        // o0.p1pad = 0;
-        o0.p1b1 = temp0blue    >> 1;
-        o0.p1r1 = temp0red     >> 1;
-        o0.p1r2 = temp1red     >> 1;
-        o0.p1g1 = temp0green   >> 1;
-        o0.p1g2 = temp1green   >> 1;
-        o0.p1b2 = temp1blue    >> 1;
-
-        // o0.p2clk = 0;
-        // o0.p2pad = 0;
-        o0.p2b1 = temp0blue    >> 2;
-        o0.p2r1 = temp0red     >> 2;
-        o0.p2r2 = temp1red     >> 2;
-        o0.p2g1 = temp0green   >> 2;
-        o0.p2g2 = temp1green   >> 2;
-        o0.p2b2 = temp1blue    >> 2;
-
-        // o0.p3clk = 0;
-        // o0.p3pad = 0;
-        o0.p3b1 = temp0blue    >> 3;
-        o0.p3r1 = temp0red     >> 3;
-        o0.p3r2 = temp1red     >> 3;
-        o0.p3g1 = temp0green   >> 3;
-        o0.p3g2 = temp1green   >> 3;
-        o0.p3b2 = temp1blue    >> 3;
-
-
-        // continue moving from LSB to MSB brightness with the next word
-        o1.word = 0;
-        // o1.p0clk = 0;
-        // o1.p0pad = 0;
-        o1.p0b1 = temp0blue    >> (0 + 1 * sizeof(uint32_t));
-        o1.p0r1 = temp0red     >> (0 + 1 * sizeof(uint32_t));
-        o1.p0r2 = temp1red     >> (0 + 1 * sizeof(uint32_t));
-        o1.p0g1 = temp0green   >> (0 + 1 * sizeof(uint32_t));
-        o1.p0g2 = temp1green   >> (0 + 1 * sizeof(uint32_t));
-        o1.p0b2 = temp1blue    >> (0 + 1 * sizeof(uint32_t));
-
-        // o1.p1clk = 0;
-        // o1.p1pad = 0;
-        o1.p1b1 = temp0blue    >> (1 + 1 * sizeof(uint32_t));
-        o1.p1r1 = temp0red     >> (1 + 1 * sizeof(uint32_t));
-        o1.p1r2 = temp1red     >> (1 + 1 * sizeof(uint32_t));
-        o1.p1g1 = temp0green   >> (1 + 1 * sizeof(uint32_t));
-        o1.p1g2 = temp1green   >> (1 + 1 * sizeof(uint32_t));
-        o1.p1b2 = temp1blue    >> (1 + 1 * sizeof(uint32_t));
-
-        // o1.p2clk = 0;
-        // o1.p2pad = 0;
-        o1.p2b1 = temp0blue    >> (2 + 1 * sizeof(uint32_t));
-        o1.p2r1 = temp0red     >> (2 + 1 * sizeof(uint32_t));
-        o1.p2r2 = temp1red     >> (2 + 1 * sizeof(uint32_t));
-        o1.p2g1 = temp0green   >> (2 + 1 * sizeof(uint32_t));
-        o1.p2g2 = temp1green   >> (2 + 1 * sizeof(uint32_t));
-        o1.p2b2 = temp1blue    >> (2 + 1 * sizeof(uint32_t));
-
-        // o1.p3clk = 0;
-        // o1.p3pad = 0;
-        o1.p3b1 = temp0blue    >> (3 + 1 * sizeof(uint32_t));
-        o1.p3r1 = temp0red     >> (3 + 1 * sizeof(uint32_t));
-        o1.p3r2 = temp1red     >> (3 + 1 * sizeof(uint32_t));
-        o1.p3g1 = temp0green   >> (3 + 1 * sizeof(uint32_t));
-        o1.p3g2 = temp1green   >> (3 + 1 * sizeof(uint32_t));
-        o1.p3b2 = temp1blue    >> (3 + 1 * sizeof(uint32_t));
-
-        clkset.word = 0x00;
-        clkset.p0clk = 1;
-        clkset.p1clk = 1;
-        clkset.p2clk = 1;
-        clkset.p3clk = 1;
-
-        // copy words to DMA buffer as a pair, one with clock set low, next with clock set high
-
-        uint32_t * tempptr = (uint32_t*)matrixUpdateData + ((freeRowBuffer*dmaBufferBytesPerRow)/sizeof(uint32_t)) + ((i*dmaBufferBytesPerPixel)/sizeof(uint32_t));
-        *tempptr = o0.word;
-        *(tempptr + latchesPerRow/sizeof(uint32_t)) = o0.word | clkset.word;
-        *(++tempptr) = o1.word;
-        *(tempptr + latchesPerRow/sizeof(uint32_t)) = o1.word | clkset.word;
     }
 
 #if (ADDX_UPDATE_BEFORE_LATCH_BYTES > 0)
@@ -1571,21 +1023,152 @@ INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, opt
     *tempptr2 = o0.word;
     // stop after 2nd word for 24 bit color
 #endif
+
+    profileRecord(profileStagePacking, stageStartCycles);
+}
+
+// 4x4 ordered dither pattern, neighbouring pixels start at different points in the frame sequence
+static const uint8_t ditherPatternOffsets[16] = {
+    0, 8, 2, 10,
+    12, 4, 14, 6,
+    3, 11, 1, 9,
+    15, 7, 13, 5
+};
+
+// the sequence of thresholds a pixel sees is the frame count with its bits reversed, so every 2^n frames
+// (n = bits dropped) it sees each threshold once and the average of the refreshed values matches the 16-bit value
+#define DITHER_THRESHOLD(frame, x, y)   (bitReverse8((uint8_t)((frame) + ditherPatternOffsets[(((y) & 0x03) << 2) | ((x) & 0x03)])))
+
+static inline uint8_t bitReverse8(uint8_t x) {
+    x = ((x & 0xF0) >> 4) | ((x & 0x0F) << 4);
+    x = ((x & 0xCC) >> 2) | ((x & 0x33) << 2);
+    x = ((x & 0xAA) >> 1) | ((x & 0x55) << 1);
+    return x;
+}
+
+// returns the top latchesPerRow bits of value, rounded up when the dropped bits plus threshold carry over
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+INLINE uint16_t SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::ditherChannel(uint16_t value, uint8_t threshold) {
+    const uint8_t droppedBits = 16 - latchesPerRow;
+    const uint16_t maxValue = (1 << latchesPerRow) - 1;
+
+    uint32_t dithered = ((uint32_t)value + (threshold >> (8 - droppedBits))) >> droppedBits;
+    return (dithered > maxValue) ? maxValue : dithered;
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffersDithered(unsigned char currentRow, unsigned char freeRowBuffer) {
+    int i, j, k;
+
+    // static to avoid putting large buffer on the stack
+    static rgb48 tempRow0[PIXELS_PER_LATCH];
+    static rgb48 tempRow1[PIXELS_PER_LATCH];
+
+    // clear buffer to prevent garbage data showing through transparent layers
+    for (i = 0; i < PIXELS_PER_LATCH; i++) {
+        tempRow0[i] = rgb48(0, 0, 0);
+        tempRow1[i] = rgb48(0, 0, 0);
+    }
+
+    // get pixel data from layers
+    uint32_t stageStartCycles = fillRefreshRows(currentRow, tempRow0, tempRow1);
+
+    // loop over each panel in the chain so stacking options are resolved once per panel instead of once per pixel
+    for (j = 0; j < MATRIX_STACK_HEIGHT; j++) {
+        // for upside down stacks, flip order
+        bool flipPanel = (optionFlags & SMARTMATRIX_OPTIONS_C_SHAPE_STACKING) && !(j%2);
+
+        for (k = 0; k < matrixWidth; k++) {
+            i = j*matrixWidth + k;
+            int tempPosition = flipPanel ? (j*matrixWidth + matrixWidth - k - 1) : i;
+
+            // the two rows shifted together get different thresholds, all three channels of a pixel share one
+            uint8_t threshold0 = DITHER_THRESHOLD(ditherFrame, i, currentRow);
+            uint8_t threshold1 = DITHER_THRESHOLD(ditherFrame, i, currentRow + 2);
+
+            uint32_t * tempptr = (uint32_t*)matrixUpdateData + ((freeRowBuffer*dmaBufferBytesPerRow)/sizeof(uint32_t)) + ((i*dmaBufferBytesPerPixel)/sizeof(uint32_t));
+            packBitPlanes(tempptr,
+                ditherChannel(tempRow0[tempPosition].red, threshold0),
+                ditherChannel(tempRow0[tempPosition].green, threshold0),
+                ditherChannel(tempRow0[tempPosition].blue, threshold0),
+                ditherChannel(tempRow1[tempPosition].red, threshold1),
+                ditherChannel(tempRow1[tempPosition].green, threshold1),
+                ditherChannel(tempRow1[tempPosition].blue, threshold1));
+        }
+    }
+
+#if (ADDX_UPDATE_BEFORE_LATCH_BYTES > 0)
+    union {
+        uint32_t word;
+        struct {
+            // order of bits in word matches how GPIO connects to the display
+            uint32_t GPIO_WORD_ORDER;
+        };
+    } o0;
+
+    o0.word = 0x00000000;
+
+    o0.p0r1 = (currentRow & 0x01) ? 1 : 0;
+    o0.p0g1 = (currentRow & 0x02) ? 1 : 0;
+    o0.p0b1 = (currentRow & 0x04) ? 1 : 0;
+    o0.p0r2 = (currentRow & 0x08) ? 1 : 0;
+    o0.p0g2 = (currentRow & 0x10) ? 1 : 0;
+
+    o0.p1r1 = (currentRow & 0x01) ? 1 : 0;
+    o0.p1g1 = (currentRow & 0x02) ? 1 : 0;
+    o0.p1b1 = (currentRow & 0x04) ? 1 : 0;
+    o0.p1r2 = (currentRow & 0x08) ? 1 : 0;
+    o0.p1g2 = (currentRow & 0x10) ? 1 : 0;
+
+    o0.p2r1 = (currentRow & 0x01) ? 1 : 0;
+    o0.p2g1 = (currentRow & 0x02) ? 1 : 0;
+    o0.p2b1 = (currentRow & 0x04) ? 1 : 0;
+    o0.p2r2 = (currentRow & 0x08) ? 1 : 0;
+    o0.p2g2 = (currentRow & 0x10) ? 1 : 0;
+
+    o0.p3r1 = (currentRow & 0x01) ? 1 : 0;
+    o0.p3g1 = (currentRow & 0x02) ? 1 : 0;
+    o0.p3b1 = (currentRow & 0x04) ? 1 : 0;
+    o0.p3r2 = (currentRow & 0x08) ? 1 : 0;
+    o0.p3g2 = (currentRow & 0x10) ? 1 : 0;
+
+    // set pointer to the byte past the end of the pixel data to shift, and write the currentRow address
+    // one word per four latches, matching loadMatrixBuffers24/36
+    uint32_t * tempptr2 = (uint32_t*)matrixUpdateData + ((freeRowBuffer*dmaBufferBytesPerRow)/sizeof(uint32_t)) + (((PIXELS_PER_LATCH)*dmaBufferBytesPerPixel)/sizeof(uint32_t));
+    for (i = 0; i < (int)(latchesPerRow/sizeof(uint32_t)); i++)
+        tempptr2[i] = o0.word;
+#endif
+
+    profileRecord(profileStagePacking, stageStartCycles);
 }
 
 template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
 INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::loadMatrixBuffers(unsigned char currentRow) {
     int i;
 
-    addresspair rowAddressPair;
+    // only set below when the address isn't sent on the data pins, otherwise the blocks get zeros instead of garbage
+    addresspair rowAddressPair = { 0, 0 };
 
 #ifndef ADDX_UPDATE_ON_DATA_PINS
     rowAddressPair.bits_to_set = addressLUT[currentRow].bits_to_set;
     rowAddressPair.bits_to_clear = addressLUT[currentRow].bits_to_clear;
 #endif
     
-    unsigned char freeRowBuffer = cbGetNextWrite(&dmaBuffer);
+    unsigned char freeRowBuffer = (optionFlags & SMARTMATRIX_OPTIONS_FULL_FRAME_BUFFER) ? currentRow : cbGetNextWrite(&dmaBuffer);
+
+    if(dmaBufferNumRows == matrixRowsPerFrame) {
+        if(freeRowBuffer == currentRow) {
+            // the buffer slot still holds this row from an earlier frame, and none of the layer rows it shows have changed
+            if((packedRows & ((uint32_t)1 << currentRow)) && !(frameDirtyRows & getRowSourceMask(currentRow)))
+                return;
+            packedRows |= ((uint32_t)1 << currentRow);
+        } else {
+            // slot is out of step with the row counter (e.g. after an underrun), it no longer holds its own row
+            packedRows &= ~((uint32_t)1 << freeRowBuffer);
+        }
+    }
 
+    uint32_t blockFillStartCycles = profileStart();
     for (i = 0; i < latchesPerRow; i++) {
         matrixUpdateBlock* tempptr = (matrixUpdateBlock*)matrixUpdateBlocks + (freeRowBuffer * latchesPerRow) + i;
         // copy bits to set and clear to generate address for current block
@@ -1595,8 +1178,11 @@ INLINE void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, opt
         tempptr->timerValues.timer_period = timerLUT[i].timer_period;
         tempptr->timerValues.timer_oe = timerLUT[i].timer_oe;
     }
+    profileRecord(profileStageBlockFill, blockFillStartCycles);
 
-    if(latchesPerRow == 16)
+    if(temporalDithering)
+        loadMatrixBuffersDithered(currentRow, freeRowBuffer);
+    else if(latchesPerRow == 16)
         loadMatrixBuffers48(currentRow, freeRowBuffer);
     else if(latchesPerRow == 12)
         loadMatrixBuffers36(currentRow, freeRowBuffer);
@@ -1618,50 +1204,8 @@ void rowCalculationISR(void) {
 #endif
 }
 
-// DMA transfer done (meaning data was shifted and timer value for MSB on current row just got loaded)
-// set DMA up for loading the next row, triggered from the next timer latch
-template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
-void rowShiftCompleteISR(void) {
-#ifdef DEBUG_PINS_ENABLED
-    digitalWriteFast(DEBUG_PIN_1, HIGH); // oscilloscope trigger
+#if defined(SMARTMATRIX_HOST_BUILD)
+    #include "SmartMatrix_Host_Impl.h"
+#else
+    #include "SmartMatrix_Teensy_Impl.h"
 #endif
-    // done with previous row, mark it as read
-    cbRead(&dmaBuffer);
-
-    if(cbIsEmpty(&dmaBuffer)) {
-#ifdef DEBUG_PINS_ENABLED
-    digitalWriteFast(DEBUG_PIN_1, LOW); // oscilloscope trigger
-#endif
-        // point dmaUpdateTimer to repeatedly load from values that set mod to MIN_BLOCK_PERIOD_TICKS and disable OE
-        dmaUpdateTimer.TCD->SADDR = SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerPairIdle;
-        // set timer increment to repeat timerPairIdle
-        dmaUpdateTimer.TCD->SLAST = -(TIMER_REGISTERS_TO_UPDATE*sizeof(uint16_t));
-        // disable channel-to-channel linking - don't link dmaClockOutData until buffer is ready
-        dmaUpdateTimer.TCD->CSR &= ~(1 << 5);
-
-        // set flag so other ISR can enable DMA again when data is ready
-        SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = true;
-
-#ifdef DEBUG_PINS_ENABLED
-    digitalWriteFast(DEBUG_PIN_1, HIGH); // oscilloscope trigger
-#endif
-    } else {
-        // get next row to draw to display and update DMA pointers
-        int currentRow = cbGetNextRead(&dmaBuffer);
-#ifndef ADDX_UPDATE_ON_DATA_PINS
-        dmaUpdateAddress.TCD->SADDR = &((matrixUpdateBlock*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow))->addressValues;
-#endif
-        dmaUpdateTimer.TCD->SADDR = &((matrixUpdateBlock*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow))->timerValues.timer_oe;
-        dmaClockOutData.TCD->SADDR = (uint8_t*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateData + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferBytesPerRow);
-    }
-
-    // trigger software interrupt (DMA channel interrupt used instead of actual softint)
-    NVIC_SET_PENDING(IRQ_DMA_CH0 + dmaUpdateTimer.channel);
-
-    // clear pending int
-    dmaClockOutData.clearInterrupt();
-
-#ifdef DEBUG_PINS_ENABLED
-    digitalWriteFast(DEBUG_PIN_1, LOW); // oscilloscope trigger
-#endif
-}
@@ -0,0 +1,330 @@
+/*
+ * SmartMatrix Library - Teensy 3.x Refresh Hardware (FTM1 timer + eDMA)
+ *
+ * Copyright (c) 2015 Louis Beaudoin (Pixelmatix)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Teensy-specific half of the refresh code: configures FTM1 and the eDMA channels that shift matrixUpdateData out to the panel,
+// and services the DMA interrupts.  Platform-independent refresh code is in SmartMatrix_Impl.h
+
+#include "DMAChannel.h"
+
+#define ROW_CALCULATION_ISR_PRIORITY   0xFE // 0xFF = lowest priority
+
+#ifndef ADDX_UPDATE_ON_DATA_PINS
+    extern DMAChannel dmaOutputAddress;
+    extern DMAChannel dmaUpdateAddress;
+#endif
+extern DMAChannel dmaUpdateTimer;
+extern DMAChannel dmaClockOutData;
+
+#ifndef ADDX_UPDATE_ON_DATA_PINS
+#define ADDRESS_ARRAY_REGISTERS_TO_UPDATE   2
+
+// 2x uint32_t to match size and spacing of values it is updating: GPIOx_PSOR and GPIOx_PCOR are 32-bit and adjacent to each other
+typedef struct gpiopair {
+    uint32_t  gpio_psor;
+    uint32_t  gpio_pcor;
+} gpiopair;
+
+static gpiopair gpiosync;
+#endif
+
+// called from matrixCalculations() with the refresh stopped on an underrun, after the buffer has been refilled
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::restartRefreshHardware(void) {
+    // stop timer
+    FTM1_SC = FTM_SC_CLKS(0) | FTM_SC_PS(LATCH_TIMER_PRESCALE);
+
+    // point DMA addresses to the next buffer
+    int currentRow = cbGetNextRead(&dmaBuffer);
+#ifndef ADDX_UPDATE_ON_DATA_PINS
+    dmaUpdateAddress.TCD->SADDR = &((matrixUpdateBlock*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow))->addressValues;
+#endif
+    dmaUpdateTimer.TCD->SADDR = &((matrixUpdateBlock*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow))->timerValues.timer_oe;
+    dmaClockOutData.TCD->SADDR = (uint8_t*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateData + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferBytesPerRow);
+
+    // enable channel-to-channel linking so data will be shifted out
+    dmaUpdateTimer.TCD->CSR &= ~(1 << 7);  // must clear DONE flag before enabling
+    dmaUpdateTimer.TCD->CSR |= (1 << 5);
+    // set timer increment back to read from matrixUpdateBlocks
+    dmaUpdateTimer.TCD->SLAST = sizeof(matrixUpdateBlock) - (TIMER_REGISTERS_TO_UPDATE * sizeof(uint16_t));
+
+    // start timer again - next timer period is MIN_BLOCK_PERIOD_TICKS with OE disabled, period after that will be loaded from matrixUpdateBlock
+    FTM1_SC = FTM_SC_CLKS(1) | FTM_SC_PS(LATCH_TIMER_PRESCALE);
+}
+
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::beginRefreshHardware(void) {
+    // setup debug output
+#ifdef DEBUG_PINS_ENABLED
+    pinMode(DEBUG_PIN_1, OUTPUT);
+    digitalWriteFast(DEBUG_PIN_1, HIGH); // oscilloscope trigger
+    digitalWriteFast(DEBUG_PIN_1, LOW);
+    pinMode(DEBUG_PIN_2, OUTPUT);
+    digitalWriteFast(DEBUG_PIN_2, HIGH); // oscilloscope trigger
+    digitalWriteFast(DEBUG_PIN_2, LOW);
+    pinMode(DEBUG_PIN_3, OUTPUT);
+    digitalWriteFast(DEBUG_PIN_3, HIGH); // oscilloscope trigger
+    digitalWriteFast(DEBUG_PIN_3, LOW);
+#endif
+
+    // configure the 7 output pins (one pin is left as input, though it can't be used as GPIO output)
+    pinMode(GPIO_PIN_CLK_TEENSY_PIN, OUTPUT);
+    pinMode(GPIO_PIN_B0_TEENSY_PIN, OUTPUT);
+    pinMode(GPIO_PIN_R0_TEENSY_PIN, OUTPUT);
+    pinMode(GPIO_PIN_R1_TEENSY_PIN, OUTPUT);
+    pinMode(GPIO_PIN_G0_TEENSY_PIN, OUTPUT);
+    pinMode(GPIO_PIN_G1_TEENSY_PIN, OUTPUT);
+    pinMode(GPIO_PIN_B1_TEENSY_PIN, OUTPUT);
+
+#ifdef ADDX_TEENSY_PIN_0
+    // configure the address pins
+    pinMode(ADDX_TEENSY_PIN_0, OUTPUT);
+#endif
+#ifdef ADDX_TEENSY_PIN_1
+    pinMode(ADDX_TEENSY_PIN_1, OUTPUT);
+#endif
+#ifdef ADDX_TEENSY_PIN_2
+    pinMode(ADDX_TEENSY_PIN_2, OUTPUT);
+#endif
+#ifdef ADDX_TEENSY_PIN_3
+    pinMode(ADDX_TEENSY_PIN_3, OUTPUT);
+#endif
+
+    // setup FTM1
+    FTM1_SC = 0;
+    FTM1_CNT = 0;
+    FTM1_MOD = IDEAL_MSB_BLOCK_TICKS;
+
+    // setup FTM1 compares:
+    // latch pulse width set based on max time to update address pins
+    FTM1_C0V = LATCH_TIMER_PULSE_WIDTH_TICKS;
+    // output OE signal - set to max at first to disable OE
+    FTM1_C1V = IDEAL_MSB_BLOCK_TICKS;
+
+    // setup PWM outputs
+    ENABLE_LATCH_PWM_OUTPUT();
+    ENABLE_OE_PWM_OUTPUT();
+
+    // setup GPIO interrupts
+    ENABLE_LATCH_RISING_EDGE_GPIO_INT();
+    ENABLE_LATCH_FALLING_EDGE_GPIO_INT();
+
+
+    // enable clocks to the DMA controller and DMAMUX
+    SIM_SCGC7 |= SIM_SCGC7_DMA;
+    SIM_SCGC6 |= SIM_SCGC6_DMAMUX;
+
+    // enable minor loop mapping so addresses can get reset after minor loops
+    DMA_CR |= DMA_CR_EMLM;
+
+    // allocate all DMA channels up front so channels can link to each other
+#ifndef ADDX_UPDATE_ON_DATA_PINS
+    dmaOutputAddress.begin(false);
+    dmaUpdateAddress.begin(false);
+#endif
+    dmaUpdateTimer.begin(false);
+    dmaClockOutData.begin(false);
+
+#ifndef ADDX_UPDATE_ON_DATA_PINS
+    // dmaOutputAddress - on latch rising edge, read address from fixed address temporary buffer, and output address on GPIO
+    // using combo of writes to set+clear registers, to only modify the address pins and not other GPIO pins
+    // address temporary buffer is refreshed before each DMA trigger (by DMA channel dmaUpdateAddress)
+    // only use single major loop, never disable channel
+    dmaOutputAddress.source(gpiosync.gpio_pcor);
+    dmaOutputAddress.TCD->SOFF = (int)&gpiosync.gpio_psor - (int)&gpiosync.gpio_pcor;
+    dmaOutputAddress.TCD->SLAST = (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * ((int)&ADDX_GPIO_CLEAR_REGISTER - (int)&ADDX_GPIO_SET_REGISTER));
+    dmaOutputAddress.TCD->ATTR = DMA_TCD_ATTR_SSIZE(2) | DMA_TCD_ATTR_DSIZE(2);
+    // Destination Minor Loop Offset Enabled - transfer appropriate number of bytes per minor loop, and put DADDR back to original value when minor loop is complete
+    // Source Minor Loop Offset Enabled - source buffer is same size and offset as destination so values reset after each minor loop
+    dmaOutputAddress.TCD->NBYTES_MLOFFYES = DMA_TCD_NBYTES_SMLOE | DMA_TCD_NBYTES_DMLOE |
+                               ((ADDRESS_ARRAY_REGISTERS_TO_UPDATE * ((int)&ADDX_GPIO_CLEAR_REGISTER - (int)&ADDX_GPIO_SET_REGISTER)) << 10) |
+                               (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * sizeof(gpiosync.gpio_psor));
+    // start on higher value of two registers, and make offset decrement to avoid negative number in NBYTES_MLOFFYES (TODO: can switch order by masking negative offset)
+    dmaOutputAddress.TCD->DADDR = &ADDX_GPIO_CLEAR_REGISTER;
+    // update destination address so the second update per minor loop is ADDX_GPIO_SET_REGISTER
+    dmaOutputAddress.TCD->DOFF = (int)&ADDX_GPIO_SET_REGISTER - (int)&ADDX_GPIO_CLEAR_REGISTER;
+    dmaOutputAddress.TCD->DLASTSGA = (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * ((int)&ADDX_GPIO_CLEAR_REGISTER - (int)&ADDX_GPIO_SET_REGISTER));
+    // single major loop
+    dmaOutputAddress.TCD->CITER_ELINKNO = 1;
+    dmaOutputAddress.TCD->BITER_ELINKNO = 1;
+    // link channel dmaUpdateAddress, enable major channel-to-channel linking, don't clear enable on major loop complete
+    dmaOutputAddress.TCD->CSR = (dmaUpdateAddress.channel << 8) | (1 << 5);
+    dmaOutputAddress.triggerAtHardwareEvent(DMAMUX_SOURCE_LATCH_RISING_EDGE);
+
+    // dmaUpdateAddress - copy address values from current position in array to buffer to temporarily hold row values for the next timer cycle
+    // only use single major loop, never disable channel
+    dmaUpdateAddress.TCD->SADDR = &((matrixUpdateBlock*)matrixUpdateBlocks)->addressValues;
+    dmaUpdateAddress.TCD->SOFF = sizeof(uint16_t);
+    dmaUpdateAddress.TCD->SLAST = sizeof(matrixUpdateBlock) - (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * sizeof(uint16_t));
+    dmaUpdateAddress.TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
+    // 16-bit = 2 bytes transferred
+    // transfer two 16-bit values, reset destination address back after each minor loop
+    dmaUpdateAddress.TCD->NBYTES_MLOFFNO = (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * sizeof(uint16_t));
+    // start with the register that's the highest location in memory and make offset decrement to avoid negative number in NBYTES_MLOFFYES register (TODO: can switch order by masking negative offset)
+    dmaUpdateAddress.TCD->DADDR = &gpiosync.gpio_pcor;
+    dmaUpdateAddress.TCD->DOFF = (int)&gpiosync.gpio_psor - (int)&gpiosync.gpio_pcor;
+    dmaUpdateAddress.TCD->DLASTSGA = (ADDRESS_ARRAY_REGISTERS_TO_UPDATE * ((int)&gpiosync.gpio_pcor - (int)&gpiosync.gpio_psor));
+    // no minor loop linking, single major loop, single minor loop, don't clear enable after major loop complete
+    dmaUpdateAddress.TCD->CITER_ELINKNO = 1;
+    dmaUpdateAddress.TCD->BITER_ELINKNO = 1;
+    dmaUpdateAddress.TCD->CSR = 0;
+#endif
+
+    // dmaUpdateTimer - on latch falling edge, load FTM1_CV1 and FTM1_MOD with with next values from current block
+    // only use single major loop, never disable channel
+    // link to dmaClockOutData channel when complete
+    dmaUpdateTimer.TCD->SADDR = &((matrixUpdateBlock*)matrixUpdateBlocks)->timerValues.timer_oe;
+    dmaUpdateTimer.TCD->SOFF = sizeof(uint16_t);
+    dmaUpdateTimer.TCD->SLAST = sizeof(matrixUpdateBlock) - (TIMER_REGISTERS_TO_UPDATE * sizeof(uint16_t));
+    dmaUpdateTimer.TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
+    // 16-bit = 2 bytes transferred
+    dmaUpdateTimer.TCD->NBYTES_MLOFFNO = TIMER_REGISTERS_TO_UPDATE * sizeof(uint16_t);
+    dmaUpdateTimer.TCD->DADDR = &FTM1_C1V;
+    dmaUpdateTimer.TCD->DOFF = (int)&FTM1_MOD - (int)&FTM1_C1V;
+    dmaUpdateTimer.TCD->DLASTSGA = TIMER_REGISTERS_TO_UPDATE * ((int)&FTM1_C1V - (int)&FTM1_MOD);
+    // no minor loop linking, single major loop
+    dmaUpdateTimer.TCD->CITER_ELINKNO = 1;
+    dmaUpdateTimer.TCD->BITER_ELINKNO = 1;
+    // link dmaClockOutData channel, enable major channel-to-channel linking, don't clear enable after major loop complete
+    dmaUpdateTimer.TCD->CSR = (dmaClockOutData.channel << 8) | (1 << 5);
+    dmaUpdateTimer.triggerAtHardwareEvent(DMAMUX_SOURCE_LATCH_FALLING_EDGE);
+
+#define DMA_TCD_MLOFF_MASK  (0x3FFFFC00)
+
+    // dmaClockOutData - repeatedly load gpio_array into GPIOD_PDOR, stop and int on major loop complete
+    dmaClockOutData.TCD->SADDR = matrixUpdateData;
+    dmaClockOutData.TCD->SOFF = latchesPerRow;
+    // SADDR will get updated by ISR, no need to set SLAST
+    dmaClockOutData.TCD->SLAST = 0;
+    dmaClockOutData.TCD->ATTR = DMA_TCD_ATTR_SSIZE(0) | DMA_TCD_ATTR_DSIZE(0);
+    // after each minor loop, set source to point back to the beginning of this set of data,
+    // but advance by 1 byte to get the next significant bits data
+    dmaClockOutData.TCD->NBYTES_MLOFFYES = DMA_TCD_NBYTES_SMLOE |
+                               (((1 - (latchesPerRow * (PIXELS_PER_LATCH * DMA_UPDATES_PER_CLOCK + ADDX_UPDATE_BEFORE_LATCH_BYTES))) << 10) & DMA_TCD_MLOFF_MASK) |
+                               (PIXELS_PER_LATCH * DMA_UPDATES_PER_CLOCK + ADDX_UPDATE_BEFORE_LATCH_BYTES);
+    dmaClockOutData.TCD->DADDR = &GPIOD_PDOR;
+    dmaClockOutData.TCD->DOFF = 0;
+    dmaClockOutData.TCD->DLASTSGA = 0;
+    dmaClockOutData.TCD->CITER_ELINKNO = latchesPerRow;
+    dmaClockOutData.TCD->BITER_ELINKNO = latchesPerRow;
+    // int after major loop is complete
+    dmaClockOutData.TCD->CSR = DMA_TCD_CSR_INTMAJOR;
+    
+    // for debugging - enable bandwidth control (space out GPIO updates so they can be seen easier on a low-bandwidth logic analyzer)
+    // enable for now, until DMA sharing complications (brought to light by Teensy 3.6 SDIO) can be worked out - use bandwidth control to space out our DMA access and allow SD reads to not slow down shifting to the matrix
+    // also enable for now, until it can be selectively enabled for higher clock speeds (140MHz+) where the data rate is too high for the panel
+    dmaClockOutData.TCD->CSR |= (0x02 << 14);
+
+    // enable a done interrupt when all DMA operations are complete
+    dmaClockOutData.attachInterrupt(rowShiftCompleteISR<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>);
+
+    // enable additional dma interrupt used as software interrupt
+    NVIC_SET_PRIORITY(IRQ_DMA_CH0 + dmaUpdateTimer.channel, ROW_CALCULATION_ISR_PRIORITY);
+    dmaUpdateTimer.attachInterrupt(rowCalculationISR<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>);
+
+#ifndef ADDX_UPDATE_ON_DATA_PINS
+    dmaOutputAddress.enable();
+    dmaUpdateAddress.enable();
+#endif
+    dmaUpdateTimer.enable();
+    dmaClockOutData.enable();
+
+    // at the end after everything is set up: enable timer from system clock, with appropriate prescale
+    FTM1_SC = FTM_SC_CLKS(1) | FTM_SC_PS(LATCH_TIMER_PRESCALE);
+}
+
+// sleep until the next interrupt, the refresh ISRs wake the CPU several times per row
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+void SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::waitForRefreshInterrupt(void) {
+    asm volatile("wfi");
+}
+
+// DMA transfer done (meaning data was shifted and timer value for MSB on current row just got loaded)
+// set DMA up for loading the next row, triggered from the next timer latch
+template <int refreshDepth, int matrixWidth, int matrixHeight, unsigned char panelType, unsigned char optionFlags>
+void rowShiftCompleteISR(void) {
+#ifdef DEBUG_PINS_ENABLED
+    digitalWriteFast(DEBUG_PIN_1, HIGH); // oscilloscope trigger
+#endif
+    if(optionFlags & SMARTMATRIX_OPTIONS_FULL_FRAME_BUFFER) {
+        // every row is always in the buffer, move on to the next row and only wake the calculation ISR once per frame
+        static int currentRow = 0;
+        if(++currentRow >= SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixRowsPerFrame)
+            currentRow = 0;
+
+#ifndef ADDX_UPDATE_ON_DATA_PINS
+        dmaUpdateAddress.TCD->SADDR = &((matrixUpdateBlock*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow))->addressValues;
+#endif
+        dmaUpdateTimer.TCD->SADDR = &((matrixUpdateBlock*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow))->timerValues.timer_oe;
+        dmaClockOutData.TCD->SADDR = (uint8_t*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateData + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferBytesPerRow);
+
+        if(!currentRow)
+            NVIC_SET_PENDING(IRQ_DMA_CH0 + dmaUpdateTimer.channel);
+
+        dmaClockOutData.clearInterrupt();
+
+#ifdef DEBUG_PINS_ENABLED
+    digitalWriteFast(DEBUG_PIN_1, LOW); // oscilloscope trigger
+#endif
+        return;
+    }
+
+    // done with previous row, mark it as read
+    cbRead(&dmaBuffer);
+
+    if(cbIsEmpty(&dmaBuffer)) {
+#ifdef DEBUG_PINS_ENABLED
+    digitalWriteFast(DEBUG_PIN_1, LOW); // oscilloscope trigger
+#endif
+        // point dmaUpdateTimer to repeatedly load from values that set mod to MIN_BLOCK_PERIOD_TICKS and disable OE
+        dmaUpdateTimer.TCD->SADDR = SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::timerPairIdle;
+        // set timer increment to repeat timerPairIdle
+        dmaUpdateTimer.TCD->SLAST = -(TIMER_REGISTERS_TO_UPDATE*sizeof(uint16_t));
+        // disable channel-to-channel linking - don't link dmaClockOutData until buffer is ready
+        dmaUpdateTimer.TCD->CSR &= ~(1 << 5);
+
+        // set flag so other ISR can enable DMA again when data is ready
+        SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferUnderrun = true;
+
+#ifdef DEBUG_PINS_ENABLED
+    digitalWriteFast(DEBUG_PIN_1, HIGH); // oscilloscope trigger
+#endif
+    } else {
+        // get next row to draw to display and update DMA pointers
+        int currentRow = cbGetNextRead(&dmaBuffer);
+#ifndef ADDX_UPDATE_ON_DATA_PINS
+        dmaUpdateAddress.TCD->SADDR = &((matrixUpdateBlock*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow))->addressValues;
+#endif
+        dmaUpdateTimer.TCD->SADDR = &((matrixUpdateBlock*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateBlocks + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::latchesPerRow))->timerValues.timer_oe;
+        dmaClockOutData.TCD->SADDR = (uint8_t*)SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::matrixUpdateData + (currentRow * SmartMatrix3<refreshDepth, matrixWidth, matrixHeight, panelType, optionFlags>::dmaBufferBytesPerRow);
+    }
+
+    // trigger software interrupt (DMA channel interrupt used instead of actual softint)
+    NVIC_SET_PENDING(IRQ_DMA_CH0 + dmaUpdateTimer.channel);
+
+    // clear pending int
+    dmaClockOutData.clearInterrupt();
+
+#ifdef DEBUG_PINS_ENABLED
+    digitalWriteFast(DEBUG_PIN_1, LOW); // oscilloscope trigger
+#endif
+}